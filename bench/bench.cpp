@@ -0,0 +1,514 @@
+// Benchmarks for the storage engine: inserts (sequential, random, Zipfian,
+// split-heavy), point lookups, range scans, insert/delete churn,
+// whole-table aggregates and inserts next to snapshot scans over a table
+// of --rows rows.
+// Each workload runs against a fresh table file and prints one result line
+// (JSON, or CSV with --format csv) on stdout:
+//
+//   ops/s, p50/p99/p999 latency, and data file pages read/written per op
+//   (pages written include the checkpoint that closes the run)
+//
+// Keys and values come from DatasetGenerator, so a given --seed produces
+// the same workload on every commit.
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "pages/table.hpp"
+#include "bench/dataset.hpp"
+
+using bench_clock = std::chrono::steady_clock;
+
+
+struct BenchConfig {
+    uint32_t rows = 100000;         // table size (and insert count for insert workloads)
+    uint32_t ops = 100000;          // lookups/scans measured on the loaded table
+    uint32_t value_size = 32;
+    uint32_t scan_length = 100;     // rows read by each scan
+    uint32_t threads = 0;           // parallel scan workers (0 = one per core)
+    uint64_t seed = 42;
+    std::string dir = ".";
+    std::string format = "json";
+    bool dump_stats = false;        // engine metrics on stderr after each workload
+    TableOptions table_options;     // --memtable-mb turns on buffered writes, --mmap mapped reads, ...
+    std::vector<std::string> workloads;
+};
+
+struct BenchResult {
+    std::string workload;
+    uint64_t ops = 0;
+    uint32_t value_size = 0;
+    double seconds = 0;
+    std::vector<uint64_t> latencies_ns;
+    uint64_t pages_read = 0;
+    uint64_t pages_written = 0;
+    std::string io_backend;
+};
+
+
+// Table files of one workload: removed before and after the run
+static std::string table_path(const BenchConfig& config, const std::string& workload) {
+    return config.dir + "/bench_" + workload;
+}
+
+static void remove_table(const std::string& path) {
+    std::remove((path + ".db").c_str());
+    std::remove((path + ".db.wal").c_str());
+    std::remove((path + ".db.mem").c_str());
+}
+
+
+// Runs op(i) for i in [0, ops), timing each call. Rows a buffered table
+// still holds in its memtable are flushed within the timed run. The
+// checkpoint at the end is not part of the latency figures but its page
+// writes are counted.
+static void measure(Table& table, uint64_t ops, const std::function<void(uint64_t)>& op, BenchResult& result) {
+    MetricsSnapshot before = metrics_snapshot();
+
+    result.ops = ops;
+    result.latencies_ns.reserve(ops);
+
+    auto start = bench_clock::now();
+    for (uint64_t i = 0; i < ops; i++) {
+        auto op_start = bench_clock::now();
+        op(i);
+        result.latencies_ns.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            bench_clock::now() - op_start).count());
+    }
+    table.flush_memtable();
+    result.seconds = std::chrono::duration<double>(bench_clock::now() - start).count();
+
+    table.checkpoint();
+    MetricsSnapshot after = metrics_snapshot();
+    result.pages_read = after.get(METRIC_PAGE_READS) - before.get(METRIC_PAGE_READS);
+    result.pages_written = after.get(METRIC_PAGE_WRITES) - before.get(METRIC_PAGE_WRITES);
+    result.io_backend = table.get_pager()->get_io_backend_name();
+}
+
+
+static BenchResult run_inserts(const BenchConfig& config, const std::string& workload,
+                               const std::vector<uint32_t>& keys, uint32_t value_size) {
+    BenchResult result;
+    result.workload = workload;
+    result.value_size = value_size;
+
+    std::string path = table_path(config, workload);
+    remove_table(path);
+    {
+        Table table(path, config.table_options);
+        std::string value;
+        measure(table, keys.size(), [&](uint64_t i) {
+            DatasetGenerator::make_value(keys[i], value_size, value);
+            table.insert(keys[i], value.data(), value.size());
+        }, result);
+
+        if (table.get_total_count() != keys.size()) {
+            throw std::runtime_error(workload + ": row count does not match the inserts");
+        }
+    }
+    remove_table(path);
+    return result;
+}
+
+
+// Lookups and scans run over rows 0 .. rows - 1, bulk loaded (untimed)
+static void load_table(Table& table, const BenchConfig& config) {
+    std::vector<std::pair<uint32_t, std::string>> rows(config.rows);
+    for (uint32_t key = 0; key < config.rows; key++) {
+        rows[key].first = key;
+        DatasetGenerator::make_value(key, config.value_size, rows[key].second);
+    }
+    table.bulk_load(rows.begin(), rows.end(), 0.9);
+    table.checkpoint();
+}
+
+
+static BenchResult run_lookups(const BenchConfig& config, const std::string& workload, bool zipfian) {
+    BenchResult result;
+    result.workload = workload;
+    result.value_size = config.value_size;
+
+    // Hot ranks land all over the key space, not just at its start
+    DatasetGenerator source(config.seed);
+    std::vector<uint32_t> keys(config.ops);
+    if (zipfian) {
+        ZipfianGenerator popularity(config.rows);
+        for (uint32_t& key : keys) {
+            uint64_t rank = popularity.next(source);
+            key = (uint32_t) ((rank * 0x9E3779B97F4A7C15ull) % config.rows);
+        }
+    } else {
+        for (uint32_t& key : keys) {
+            key = (uint32_t) source.next_below(config.rows);
+        }
+    }
+
+    std::string path = table_path(config, workload);
+    remove_table(path);
+    {
+        Table table(path, config.table_options);
+        load_table(table, config);
+
+        // The zero-copy lookup, the way a server would answer a get
+        uint64_t misses = 0;
+        measure(table, keys.size(), [&](uint64_t i) {
+            misses += !table.find(keys[i]);
+        }, result);
+
+        if (misses > 0) {
+            throw std::runtime_error(workload + ": lookups missed loaded keys");
+        }
+    }
+    remove_table(path);
+    return result;
+}
+
+
+static BenchResult run_scans(const BenchConfig& config) {
+    BenchResult result;
+    result.workload = "scan";
+    result.value_size = config.value_size;
+
+    DatasetGenerator source(config.seed);
+    std::vector<uint32_t> starts(config.ops);
+    for (uint32_t& start : starts) {
+        start = (uint32_t) source.next_below(config.rows);
+    }
+
+    std::string path = table_path(config, result.workload);
+    remove_table(path);
+    {
+        Table table(path, config.table_options);
+        load_table(table, config);
+
+        uint64_t checksum = 0;
+        measure(table, starts.size(), [&](uint64_t i) {
+            Cursor cursor = table.scan(starts[i], UINT32_MAX);
+            for (uint32_t n = 0; n < config.scan_length && cursor.is_valid(); n++, cursor.next()) {
+                checksum += cursor.get_key() + cursor.get_value_size();
+            }
+        }, result);
+
+        // Keeps the loop from being optimized away
+        if (checksum == 0 && config.rows > 0) {
+            std::cerr << "scan: read nothing" << std::endl;
+        }
+    }
+    remove_table(path);
+    return result;
+}
+
+
+// Count/sum/min/max over a byte of every value, one whole-table parallel
+// scan per op (at most AGGREGATE_MAX_PASSES of them, each one reads every row)
+static const uint32_t AGGREGATE_MAX_PASSES = 20;
+
+static BenchResult run_aggregates(const BenchConfig& config) {
+    BenchResult result;
+    result.workload = "aggregate";
+    result.value_size = config.value_size;
+
+    std::string path = table_path(config, result.workload);
+    remove_table(path);
+    {
+        Table table(path, config.table_options);
+        load_table(table, config);
+
+        uint64_t rows = 0;
+        uint32_t passes = std::min(config.ops, AGGREGATE_MAX_PASSES);
+        measure(table, passes, [&](uint64_t) {
+            rows += table.aggregate<uint8_t>(0, UINT32_MAX, 0, config.threads).rows;
+        }, result);
+
+        if (rows != (uint64_t) passes * config.rows) {
+            throw std::runtime_error("aggregate: rows missing from the scan");
+        }
+    }
+    remove_table(path);
+    return result;
+}
+
+
+// A sliding window of TTL'd rows: each op inserts the next key and deletes
+// the oldest one, so the table keeps --rows rows and should keep its size
+static BenchResult run_churn(const BenchConfig& config) {
+    BenchResult result;
+    result.workload = "churn";
+    result.value_size = config.value_size;
+
+    std::string path = table_path(config, result.workload);
+    remove_table(path);
+    {
+        Table table(path, config.table_options);
+        load_table(table, config);
+
+        std::string value;
+        uint64_t misses = 0;
+        measure(table, config.ops, [&](uint64_t i) {
+            uint32_t key = (uint32_t) (config.rows + i);
+            DatasetGenerator::make_value(key, config.value_size, value);
+            table.insert(key, value.data(), value.size());
+            misses += !table.erase((uint32_t) i);
+        }, result);
+
+        if (misses > 0 || table.get_total_count() != config.rows) {
+            throw std::runtime_error("churn: deletes missed inserted keys");
+        }
+    }
+    remove_table(path);
+    return result;
+}
+
+
+// Random inserts (the measured ops) while another thread keeps reading the
+// whole table, each pass from a fresh snapshot: what a long analytic scan
+// costs the writers next to it
+static BenchResult run_snapshot_scans(const BenchConfig& config) {
+    BenchResult result;
+    result.workload = "snapshot_scan";
+    result.value_size = config.value_size;
+
+    DatasetGenerator source(config.seed);
+    std::vector<uint32_t> keys = source.random_keys(config.ops);
+
+    std::string path = table_path(config, result.workload);
+    remove_table(path);
+    {
+        Table table(path, config.table_options);
+        load_table(table, config);
+
+        std::atomic<bool> done{false};
+        uint64_t passes = 0;
+        uint64_t short_passes = 0;
+        std::thread scanner([&] {
+            while (!done) {
+                Snapshot snapshot = table.snapshot();
+                uint64_t rows = 0;
+                for (SnapshotCursor cursor = snapshot.scan(0, UINT32_MAX); cursor.is_valid(); cursor.next()) {
+                    rows++;
+                }
+                short_passes += rows < config.rows;
+                passes++;
+            }
+        });
+
+        // Keys above the loaded ones, so every insert adds a row
+        std::string value;
+        measure(table, keys.size(), [&](uint64_t i) {
+            uint32_t key = config.rows + keys[i];
+            DatasetGenerator::make_value(key, config.value_size, value);
+            table.insert(key, value.data(), value.size());
+        }, result);
+
+        done = true;
+        scanner.join();
+        if (short_passes > 0) {
+            throw std::runtime_error("snapshot_scan: rows missing from a snapshot");
+        }
+        if (passes == 0) {
+            std::cerr << "snapshot_scan: no scan finished during the inserts" << std::endl;
+        }
+    }
+    remove_table(path);
+    return result;
+}
+
+
+static BenchResult run_workload(const BenchConfig& config, const std::string& workload) {
+    DatasetGenerator source(config.seed);
+
+    if (workload == "insert_sequential") {
+        return run_inserts(config, workload, DatasetGenerator::sequential_keys(config.rows), config.value_size);
+    }
+    if (workload == "insert_random") {
+        return run_inserts(config, workload, source.random_keys(config.rows), config.value_size);
+    }
+    if (workload == "insert_zipfian") {
+        return run_inserts(config, workload, source.zipfian_keys(config.rows), config.value_size);
+    }
+    if (workload == "split_heavy") {
+        // Values at the inline limit fit a handful per leaf: nearly every
+        // few inserts split a leaf, and the internal levels grow quickly
+        return run_inserts(config, workload, source.random_keys(config.rows),
+                           DefaultLayout::LEAF_NODE_MAX_INLINE_VALUE);
+    }
+    if (workload == "lookup_random") {
+        return run_lookups(config, workload, false);
+    }
+    if (workload == "lookup_zipfian") {
+        return run_lookups(config, workload, true);
+    }
+    if (workload == "scan") {
+        return run_scans(config);
+    }
+    if (workload == "aggregate") {
+        return run_aggregates(config);
+    }
+    if (workload == "churn") {
+        return run_churn(config);
+    }
+    if (workload == "snapshot_scan") {
+        return run_snapshot_scans(config);
+    }
+    throw std::runtime_error("unknown workload: " + workload);
+}
+
+
+static double percentile_us(std::vector<uint64_t>& sorted_ns, double p) {
+    if (sorted_ns.empty()) return 0;
+    size_t idx = std::min(sorted_ns.size() - 1, (size_t) (p * sorted_ns.size()));
+    return sorted_ns[idx] / 1000.0;
+}
+
+
+static void print_result(std::ostream& out, const BenchConfig& config, BenchResult& result, bool first) {
+    std::sort(result.latencies_ns.begin(), result.latencies_ns.end());
+
+    double ops = result.ops > 0 ? (double) result.ops : 1.0;
+    double ops_per_sec = result.seconds > 0 ? result.ops / result.seconds : 0;
+    double p50 = percentile_us(result.latencies_ns, 0.50);
+    double p99 = percentile_us(result.latencies_ns, 0.99);
+    double p999 = percentile_us(result.latencies_ns, 0.999);
+
+    char line[1024];
+    if (config.format == "csv") {
+        if (first) {
+            out << "workload,rows,ops,value_size,seed,io_backend,seconds,ops_per_sec,"
+                   "p50_us,p99_us,p999_us,pages_read_per_op,pages_written_per_op\n";
+        }
+        std::snprintf(line, sizeof(line), "%s,%u,%lu,%u,%lu,%s,%.6f,%.1f,%.3f,%.3f,%.3f,%.4f,%.4f\n",
+                      result.workload.c_str(), config.rows, (unsigned long) result.ops, result.value_size,
+                      (unsigned long) config.seed, result.io_backend.c_str(), result.seconds, ops_per_sec,
+                      p50, p99, p999, result.pages_read / ops, result.pages_written / ops);
+    } else {
+        std::snprintf(line, sizeof(line),
+                      "{\"workload\":\"%s\",\"rows\":%u,\"ops\":%lu,\"value_size\":%u,\"seed\":%lu,"
+                      "\"io_backend\":\"%s\",\"seconds\":%.6f,\"ops_per_sec\":%.1f,"
+                      "\"p50_us\":%.3f,\"p99_us\":%.3f,\"p999_us\":%.3f,"
+                      "\"pages_read_per_op\":%.4f,\"pages_written_per_op\":%.4f}\n",
+                      result.workload.c_str(), config.rows, (unsigned long) result.ops, result.value_size,
+                      (unsigned long) config.seed, result.io_backend.c_str(), result.seconds, ops_per_sec,
+                      p50, p99, p999, result.pages_read / ops, result.pages_written / ops);
+    }
+    out << line << std::flush;
+}
+
+
+static const char* ALL_WORKLOADS[] = {
+    "insert_sequential", "insert_random", "insert_zipfian", "split_heavy",
+    "lookup_random", "lookup_zipfian", "scan", "churn", "aggregate",
+    "snapshot_scan"
+};
+
+static void usage() {
+    std::cerr << "usage: rdbms_bench [--rows N] [--ops N] [--value-size BYTES] [--scan-length N]\n"
+                 "                   [--seed N] [--dir PATH] [--format json|csv] [--workloads a,b,...] [--stats]\n"
+                 "                   [--memtable-mb N] [--mmap] [--checksums off|write|read] [--threads N]\n"
+                 "                   [--hash-index SLOTS] [--direct] [--async-commit]\n"
+                 "workloads:";
+    for (const char* name : ALL_WORKLOADS) {
+        std::cerr << " " << name;
+    }
+    std::cerr << std::endl;
+}
+
+
+int main(int argc, char** argv) {
+    BenchConfig config;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            usage();
+            return 0;
+        }
+        if (arg == "--stats") {
+            config.dump_stats = true;
+            continue;
+        }
+        if (arg == "--mmap") {
+            config.table_options.map_reads = true;
+            continue;
+        }
+        if (arg == "--direct") {
+            config.table_options.direct_io = true;
+            continue;
+        }
+        if (arg == "--async-commit") {
+            config.table_options.async_commit = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            usage();
+            return 1;
+        }
+        std::string value = argv[++i];
+
+        if (arg == "--rows") config.rows = std::strtoul(value.c_str(), nullptr, 10);
+        else if (arg == "--ops") config.ops = std::strtoul(value.c_str(), nullptr, 10);
+        else if (arg == "--value-size") config.value_size = std::strtoul(value.c_str(), nullptr, 10);
+        else if (arg == "--scan-length") config.scan_length = std::strtoul(value.c_str(), nullptr, 10);
+        else if (arg == "--threads") config.threads = std::strtoul(value.c_str(), nullptr, 10);
+        else if (arg == "--hash-index") config.table_options.hash_index_slots = std::strtoul(value.c_str(), nullptr, 10);
+        else if (arg == "--seed") config.seed = std::strtoull(value.c_str(), nullptr, 10);
+        else if (arg == "--dir") config.dir = value;
+        else if (arg == "--format") config.format = value;
+        else if (arg == "--memtable-mb") {
+            uint64_t megabytes = std::strtoull(value.c_str(), nullptr, 10);
+            config.table_options.buffered_writes = megabytes > 0;
+            config.table_options.memtable_bytes = megabytes << 20;
+        }
+        else if (arg == "--checksums") {
+            if (value == "off") config.table_options.checksums = CHECKSUM_OFF;
+            else if (value == "write") config.table_options.checksums = CHECKSUM_ON_WRITE;
+            else if (value == "read") config.table_options.checksums = CHECKSUM_ON_READ;
+            else {
+                usage();
+                return 1;
+            }
+        }
+        else if (arg == "--workloads") {
+            std::stringstream list(value);
+            std::string name;
+            while (std::getline(list, name, ',')) {
+                if (!name.empty()) config.workloads.push_back(name);
+            }
+        } else {
+            usage();
+            return 1;
+        }
+    }
+    if (config.workloads.empty()) {
+        config.workloads.assign(std::begin(ALL_WORKLOADS), std::end(ALL_WORKLOADS));
+    }
+
+    // The pager reports page faults and opened files on std::cout: keep
+    // stdout for the results alone
+    std::ostream results(std::cout.rdbuf());
+    std::cout.rdbuf(nullptr);
+
+    bool first = true;
+    for (const std::string& workload : config.workloads) {
+        try {
+            BenchResult result = run_workload(config, workload);
+            print_result(results, config, result, first);
+            first = false;
+            if (config.dump_stats) {
+                std::cerr << "# " << workload << "\n" << metrics_snapshot().to_text();
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "rdbms_bench: " << e.what() << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
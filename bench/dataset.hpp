@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstdint>
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+// Deterministic workload data for the benchmarks.
+// Everything comes from one seeded splitmix64 stream and our own
+// distributions (not <random>'s, whose output differs between standard
+// libraries), so the same seed gives the same keys on every machine and
+// every commit.
+
+
+class DatasetGenerator {
+    private:
+        uint64_t state;
+
+    public:
+        explicit DatasetGenerator(uint64_t seed): state(seed) {};
+
+        uint64_t next() {
+            uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            return z ^ (z >> 31);
+        }
+
+        // Uniform in [0, bound)
+        uint64_t next_below(uint64_t bound) {
+            return (uint64_t) (((unsigned __int128) next() * bound) >> 64);
+        }
+
+        // Uniform in [0, 1)
+        double next_double() {
+            return (next() >> 11) * 0x1.0p-53;
+        }
+
+        // 0, 1, 2, ... n - 1
+        static std::vector<uint32_t> sequential_keys(uint32_t n) {
+            std::vector<uint32_t> keys(n);
+            for (uint32_t i = 0; i < n; i++) {
+                keys[i] = i;
+            }
+            return keys;
+        }
+
+        // The same keys in a random order (Fisher-Yates)
+        std::vector<uint32_t> random_keys(uint32_t n) {
+            std::vector<uint32_t> keys = sequential_keys(n);
+            for (uint32_t i = n; i > 1; i--) {
+                std::swap(keys[i - 1], keys[next_below(i)]);
+            }
+            return keys;
+        }
+
+        // n distinct keys whose insert positions are skewed: the key space is
+        // cut into ranges, each insert picks a range by a Zipfian draw and
+        // appends to it, so a few ranges take most of the inserts
+        std::vector<uint32_t> zipfian_keys(uint32_t n, double theta = 0.99);
+
+        // Value bytes derived from the key alone
+        static void make_value(uint32_t key, uint32_t size, std::string& out) {
+            out.resize(size);
+            uint64_t x = key * 0x9E3779B97F4A7C15ull + 1;
+            for (uint32_t i = 0; i < size; i++) {
+                x ^= x << 13;
+                x ^= x >> 7;
+                x ^= x << 17;
+                out[i] = (char) ('a' + (x % 26));
+            }
+        }
+};
+
+
+// Zipfian ranks in [0, items), rank 0 the most popular
+// (Gray et al., "Quickly generating billion-record synthetic databases")
+class ZipfianGenerator {
+    private:
+        uint64_t items;
+        double theta;
+        double alpha;
+        double zeta_n;
+        double eta;
+
+        static double zeta(uint64_t n, double theta) {
+            double sum = 0;
+            for (uint64_t i = 1; i <= n; i++) {
+                sum += 1.0 / std::pow((double) i, theta);
+            }
+            return sum;
+        }
+
+    public:
+        ZipfianGenerator(uint64_t n, double skew = 0.99): items(n), theta(skew) {
+            alpha = 1.0 / (1.0 - theta);
+            zeta_n = zeta(items, theta);
+            eta = (1.0 - std::pow(2.0 / items, 1.0 - theta)) / (1.0 - zeta(2, theta) / zeta_n);
+        }
+
+        uint64_t next(DatasetGenerator& source) {
+            double u = source.next_double();
+            double uz = u * zeta_n;
+            if (uz < 1.0) return 0;
+            if (uz < 1.0 + std::pow(0.5, theta)) return 1;
+            uint64_t rank = (uint64_t) (items * std::pow(eta * u - eta + 1.0, alpha));
+            return rank < items ? rank : items - 1;
+        }
+};
+
+
+inline std::vector<uint32_t> DatasetGenerator::zipfian_keys(uint32_t n, double theta) {
+    // Ranges are n keys wide so none of them can run out
+    uint64_t ranges = std::max<uint64_t>(2, std::min<uint64_t>(1024, UINT32_MAX / std::max<uint32_t>(n, 1)));
+    ZipfianGenerator popularity(ranges, theta);
+    std::vector<uint32_t> next_in_range(ranges, 0);
+
+    std::vector<uint32_t> keys(n);
+    for (uint32_t i = 0; i < n; i++) {
+        uint64_t range = popularity.next(*this);
+        keys[i] = (uint32_t) (range * n + next_in_range[range]++);
+    }
+    return keys;
+}
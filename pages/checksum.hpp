@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "page.hpp"
+
+// CRC32C (Castagnoli), the checksum every data page carries in its last
+// four bytes. With SSE4.2 (RDBMS_NATIVE on x86) it runs on the crc32
+// instruction; anywhere else on slicing-by-8 tables.
+
+// How the pager uses page checksums
+enum ChecksumMode {
+    CHECKSUM_OFF = 0,       // neither written nor checked
+    CHECKSUM_ON_WRITE = 1,  // written with every page, only checked by Table::verify
+    CHECKSUM_ON_READ = 2    // also checked on every read from disk and when a clean page is evicted
+};
+
+uint32_t crc32c(const void* data, size_t length, uint32_t crc = 0);
+
+// "sse4.2" or "slicing-by-8"
+const char* crc32c_implementation();
+
+
+// Over everything but the trailer itself
+inline uint32_t page_checksum(const Page& page) {
+    return crc32c(page.data, PAGE_CHECKSUM_OFFSET);
+}
+
+inline uint32_t get_page_checksum(const Page& page) {
+    uint32_t checksum;
+    std::memcpy(&checksum, page.data + PAGE_CHECKSUM_OFFSET, sizeof(uint32_t));
+    return checksum;
+}
+
+inline void stamp_page_checksum(Page& page) {
+    uint32_t checksum = page_checksum(page);
+    std::memcpy(page.data + PAGE_CHECKSUM_OFFSET, &checksum, sizeof(uint32_t));
+}
+
+// A page the file has room for but nobody ever wrote (a hole) reads back
+// as zeros, trailer included
+inline bool page_is_blank(const Page& page) {
+    for (uint32_t i = 0; i < PAGE_SIZE; i += sizeof(uint64_t)) {
+        uint64_t word;
+        std::memcpy(&word, page.data + i, sizeof(uint64_t));
+        if (word != 0) return false;
+    }
+    return true;
+}
+
+// Stored checksum matches, or the page was never written
+inline bool page_checksum_ok(const Page& page) {
+    uint32_t stored = get_page_checksum(page);
+    return stored == page_checksum(page) || (stored == 0 && page_is_blank(page));
+}
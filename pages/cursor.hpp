@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+#include <shared_mutex>
+#include "pager.hpp"
+#include "leaf_node.hpp"
+#include "tree_layout.hpp"
+
+// Leaf pages hinted to the kernel ahead of the scan position
+const uint32_t DEFAULT_SCAN_READAHEAD = 16;
+
+template <typename Layout>
+class BasicTable;
+
+// Forward iterator over [lo, hi] along the leaf chain. Descends once, then
+// follows the next-page links while keeping the next few leaves (taken from
+// the parent node) in flight.
+//
+//   for (Cursor c = table.scan(lo, hi); c.is_valid(); c.next()) { ... }
+//
+// The current leaf stays pinned and latched shared for the lifetime of the
+// cursor position. Moving to the next leaf lets go of the current one
+// first, so a scan never holds two leaves (or a leaf and an ancestor).
+//
+// Rows of a buffered table that are still in the memtable are copied when
+// the cursor opens and merged in; where a key is in both, the tree's rows
+// come first.
+template <typename Layout>
+class BasicCursor {
+    public:
+        using KeyType = typename Layout::KeyType;
+        using Traits = typename Layout::Traits;
+        using LeafNode = BasicLeafNode<Layout>;
+
+    private:
+        BasicTable<Layout>* table;
+        Pager* pager;
+        std::shared_lock<std::shared_mutex> tree_guard;
+        PageHandle leaf_handle;
+        uint32_t cell = 0;
+        KeyType high_key;
+        KeyType last_key;                   // last key of the leaves left behind
+        bool valid = false;
+        bool in_tree = false;               // leaf_handle and cell point at a row in range
+
+        std::vector<std::pair<KeyType, std::string>> buffered;
+        size_t buffered_pos = 0;
+        bool from_buffer = false;           // the current row is buffered[buffered_pos]
+
+        uint32_t readahead_pages;
+        uint32_t leaves_hinted = 0;         // size of the last readahead window
+        uint32_t leaves_since_hint = 0;     // leaves consumed out of it
+
+        void load_leaf(uint32_t page_id);
+        void skip_exhausted_leaves();
+        void finish();
+        void issue_readahead(const KeyType& key, bool leftmost = false);
+        void pick_row();
+
+        LeafNode current_leaf() {
+            return LeafNode(leaf_handle.get(), leaf_handle.get_page_id());
+        }
+
+    public:
+        BasicCursor(BasicTable<Layout>* t, Pager* p, const KeyType& low_key, const KeyType& high,
+                    uint32_t readahead);
+
+        BasicCursor(BasicCursor&&) = default;
+        BasicCursor& operator=(BasicCursor&&) = default;
+
+        bool is_valid() const { return valid; }
+
+        KeyType get_key() {
+            return from_buffer ? buffered[buffered_pos].first : current_leaf().get_key(cell);
+        }
+
+        uint32_t get_value_size() {
+            return from_buffer ? buffered[buffered_pos].second.size() : current_leaf().get_value_size(cell);
+        }
+
+        // Points into the pinned leaf, valid until the cursor moves. Only the
+        // inline bytes: large values need read_value.
+        char* get_value() {
+            return from_buffer ? buffered[buffered_pos].second.data() : current_leaf().get_value(cell);
+        }
+        bool value_is_inline() { return from_buffer || !current_leaf().is_overflow(cell); }
+
+        // The value in place, same lifetime as get_value (empty for a large
+        // value, which is not in one piece: read_value it)
+        std::span<const char> get_value_span() {
+            if (!value_is_inline()) return {};
+            return std::span<const char>(get_value(), get_value_size());
+        }
+
+        // Copies the whole value, following overflow pages
+        void read_value(std::string& out) {
+            if (from_buffer) {
+                out = buffered[buffered_pos].second;
+            } else {
+                current_leaf().read_value(cell, *pager, out);
+            }
+        }
+
+        void next();
+};
+
+
+extern template class BasicCursor<DefaultLayout>;
+extern template class BasicCursor<Layout64>;
+extern template class BasicCursor<CompositeLayout>;
+extern template class BasicCursor<UuidLayout>;
+extern template class BasicCursor<NameLayout>;
+extern template class BasicCursor<PackedLayout>;
+
+using Cursor = BasicCursor<DefaultLayout>;
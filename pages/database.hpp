@@ -4,21 +4,104 @@
 #include <string>
 #include <unordered_map>
 #include <memory>
+#include <mutex>
+#include <vector>
 #include "table.hpp"
+#include "metrics.hpp"
 
+
+// Buffer pool of a database unless told otherwise (64 MB)
+const uint64_t DEFAULT_DATABASE_MEMORY_BYTES = 64ull << 20;
+
+// Smallest pool a database runs with, whatever the limit says
+const uint32_t MIN_DATABASE_POOL_FRAMES = 64;
+
+
+struct DatabaseOptions {
+    // The buffer pool every table shares, in bytes (whole pages). Tables
+    // that are read take frames from tables that are not, so this is the
+    // page cache of the whole database. Memtables and hash indexes are
+    // per table and come on top.
+    uint64_t memory_limit_bytes = DEFAULT_DATABASE_MEMORY_BYTES;
+
+    // How each table is opened. The file-level settings in it (map_reads,
+    // direct_io, checksums, async_commit) apply to the whole database file.
+    TableOptions table_options;
+};
+
+
+struct TableStats {
+    std::string name;
+    uint32_t tree_height;
+    uint64_t row_count;
+};
+
+// What Database::stats() returns: the engine-wide counters and latency
+// histograms plus a line per open table
+struct DatabaseStats {
+    MetricsSnapshot engine;
+    uint32_t file_pages = 0;
+    uint32_t pool_frames = 0;
+    std::vector<TableStats> tables;
+
+    // The metrics dump followed by
+    //   database pages=P pool_frames=F
+    //   table <name> tree_height=H rows=N
+    std::string to_text() const {
+        std::string out = engine.to_text();
+        out += "database pages=" + std::to_string(file_pages)
+             + " pool_frames=" + std::to_string(pool_frames) + "\n";
+        for (const TableStats& table : tables) {
+            out += "table " + table.name
+                 + " tree_height=" + std::to_string(table.tree_height)
+                 + " rows=" + std::to_string(table.row_count) + "\n";
+        }
+        return out;
+    }
+};
+
+
+// Any number of tables in one file, path (and its log, path + ".wal").
+// Page 0 is the superblock of a catalog B+tree that maps each table name
+// to the page holding that table's own superblock. Every table allocates
+// from the one free list and caches its pages in the one buffer pool, so
+// opening a table is a catalog lookup rather than a file open.
+//
+// Tables with buffered writes log them to path + "." + name + ".mem".
 class Database {
     private:
-        std::string db_directory;
-        std::unordered_map<std::string, std::unique_ptr<Table>> open_tables; 
+        using CatalogKey = NameTable::KeyType;
+
+        std::string path;
+        DatabaseOptions options;
+
+        // Declared in this order so the tables go first and the pager's
+        // final checkpoint comes last
+        std::shared_ptr<Pager> pager;
+        std::unique_ptr<NameTable> catalog;
+        std::unordered_map<std::string, std::unique_ptr<Table>> open_tables;
+        std::mutex tables_mutex;    // tables may be opened from any thread
+
+        static CatalogKey catalog_key(const std::string& table_name);
 
     public:
-        Table* get_table(std::string table_name) {
-            if(open_tables.find(table_name) == open_tables.end()) {
-                open_tables[table_name] = std::make_unique<Table>(table_name + ".bin");
-            }
-            return open_tables[table_name].get();
-        }
+        explicit Database(const std::string& path, const DatabaseOptions& options = DatabaseOptions());
+
+        // Opens the table, creating it on first use. Names are 1 to
+        // MAX_NAME_KEY_BYTES bytes without zero bytes. The table stays open
+        // until the database is closed.
+        Table* get_table(const std::string& table_name);
+
+        // Every table in the catalog, in name order
+        std::vector<std::string> list_tables();
+
+        // For tooling that wants the pool size or the I/O backend
+        Pager* get_pager() { return pager.get(); }
+
+        // Cheap enough to poll: sums the per-thread counters, the table
+        // numbers are all kept in memory
+        DatabaseStats stats();
 };
 
 
-#endif
\ No newline at end of file
+#endif
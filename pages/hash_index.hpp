@@ -0,0 +1,134 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include "page.hpp"
+#include "pager.hpp"
+
+// Slots in a table's hash index (TableOptions::hash_index_slots), 512 KB
+const uint32_t DEFAULT_HASH_INDEX_SLOTS = 1u << 16;
+
+// One lookup in this many always uses the index, even while it is off, so
+// the hit rate is known either way. Every HASH_INDEX_WINDOW of them the
+// index is turned on or off by that rate.
+const uint32_t HASH_INDEX_SAMPLE_EVERY = 16;
+const uint32_t HASH_INDEX_WINDOW = 1024;
+const uint32_t HASH_INDEX_MIN_HIT_PERCENT = 20;
+
+
+// What a lookup got from the hash index
+struct HashProbe {
+    uint64_t hash = 0;
+    uint32_t leaf_id = INVALID_PAGE_ID;     // the leaf key was last found in, if remembered
+    bool use = false;                       // the index is used (and kept up) for this lookup
+    bool sample = false;                    // counts towards the hit rate
+};
+
+
+// Adaptive hash index for point lookups, in the spirit of InnoDB's: maps
+// keys that were found recently straight to their leaf, so a hot key skips
+// the descent from the root. Each slot holds a leaf id and a tag from the
+// key's hash, nothing else. A slot is never trusted: the lookup latches the
+// leaf it names and only takes the row if the key is in it. So a split that
+// moves the key, an erase or a tag collision just costs one leaf visit
+// before the usual descent, which then puts the new leaf in the slot.
+//
+// Only freeing a leaf could make a slot name a page that holds stale rows,
+// so the table clears the whole index when a merge frees a node (with the
+// tree latch held exclusively, so no lookup is in flight).
+//
+// Uniform traffic over a large table would mostly miss and only pay for
+// the probes, so the index watches its hit rate over a sample of lookups
+// and stays out of the way while it is low.
+template <typename Traits>
+class BasicHashIndex {
+    public:
+        using Key = typename Traits::Key;
+
+    private:
+        // (tag << 32) | leaf id; 0 is empty (page 0 is never a leaf)
+        std::unique_ptr<std::atomic<uint64_t>[]> slots;
+        uint64_t mask = 0;
+
+        std::atomic<bool> active{true};
+        std::atomic<uint32_t> sampled{0};
+        std::atomic<uint32_t> sampled_hits{0};
+
+        static uint64_t hash(const Key& key) {
+            char bytes[Traits::SIZE];
+            Traits::store(key, bytes);
+            uint64_t h = 0x9E3779B97F4A7C15ull;
+            for (uint32_t i = 0; i < Traits::SIZE; i += 8) {
+                uint64_t word = 0;
+                std::memcpy(&word, bytes + i, std::min<uint32_t>(8, Traits::SIZE - i));
+                h = (h ^ word) * 0xFF51AFD7ED558CCDull;
+                h ^= h >> 32;
+            }
+            return h;
+        }
+
+    public:
+        // Rounded up to a power of two; 0 turns the index off
+        explicit BasicHashIndex(uint32_t slot_count) {
+            if (slot_count == 0) return;
+            uint64_t size = 1;
+            while (size < slot_count) size <<= 1;
+            slots.reset(new std::atomic<uint64_t>[size]);
+            mask = size - 1;
+            clear();
+        }
+
+        bool enabled() const { return slots != nullptr; }
+        bool is_active() const { return active.load(std::memory_order_relaxed); }
+
+        HashProbe probe(const Key& key) {
+            HashProbe probe;
+            if (!slots) return probe;
+
+            thread_local uint32_t lookups = 0;
+            probe.sample = ++lookups % HASH_INDEX_SAMPLE_EVERY == 0;
+            probe.use = probe.sample || active.load(std::memory_order_relaxed);
+            if (!probe.use) return probe;
+
+            probe.hash = hash(key);
+            uint64_t slot = slots[probe.hash & mask].load(std::memory_order_relaxed);
+            if (slot != 0 && (slot >> 32) == (probe.hash >> 32)) {
+                probe.leaf_id = (uint32_t) slot;
+            }
+            return probe;
+        }
+
+        // Whether the leaf the probe named held the key
+        void record(const HashProbe& probe, bool hit) {
+            if (!probe.sample) return;
+            if (hit) {
+                sampled_hits.fetch_add(1, std::memory_order_relaxed);
+            }
+            if (sampled.fetch_add(1, std::memory_order_relaxed) + 1 == HASH_INDEX_WINDOW) {
+                uint32_t hits = sampled_hits.exchange(0, std::memory_order_relaxed);
+                sampled.store(0, std::memory_order_relaxed);
+                active.store(hits * 100 >= HASH_INDEX_MIN_HIT_PERCENT * HASH_INDEX_WINDOW,
+                             std::memory_order_relaxed);
+            }
+        }
+
+        // The descent found the probed key in leaf_id
+        void remember(const HashProbe& probe, uint32_t leaf_id) {
+            if (!probe.use) return;
+            uint64_t slot = (probe.hash >> 32 << 32) | leaf_id;
+            std::atomic<uint64_t>& target = slots[probe.hash & mask];
+            if (target.load(std::memory_order_relaxed) != slot) {
+                target.store(slot, std::memory_order_relaxed);
+            }
+        }
+
+        // Forgets every leaf (caller has the tree to itself)
+        void clear() {
+            for (uint64_t i = 0; i <= mask && slots; i++) {
+                slots[i].store(0, std::memory_order_relaxed);
+            }
+        }
+};
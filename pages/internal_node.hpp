@@ -1,31 +1,52 @@
+#pragma once
+
 #include <cstdint>
 #include "node.hpp"
+#include "node_search.hpp"
+#include "tree_layout.hpp"
+
+// Keys and child pointers live in two separate arrays so the search layer
+// can load keys contiguously: [Header][Key 0..MAX-1][Child 0..MAX-1]
+// (sizes come from the TreeLayout the node is instantiated with)
+template <typename Layout>
+class BasicInternalNode : public Node {
+public:
+    using KeyType = typename Layout::KeyType;
+    using Traits = typename Layout::Traits;
+    using SplitResult = BasicSplitResult<KeyType>;
 
-// We define this to ensure we skip the Right Child pointer and Table Count
-const uint32_t INTERNAL_NODE_CELLS_START = 20; 
+    static constexpr uint32_t KEY_SIZE = Layout::KEY_SIZE;
+    static constexpr uint32_t MAX_CELLS = Layout::INTERNAL_NODE_MAX_CELLS;
 
+    BasicInternalNode(Page *p, uint32_t id) : Node(p, id) {};
 
-enum NodeType {
-    NODE_INTERNAL = 0,
-    NODE_LEAF = 1
-};
+    // Child i holds keys < key i, the right child holds the rest, so this
+    // is the index of the child to follow (key count for the right child)
+    uint32_t child_index_for_key(const KeyType& key) {
+        return Traits::upper_bound(key_area(), get_key_count(), key);
+    }
 
-class InternalNode : public Node {
-public:
-    InternalNode(Page *p, uint32_t id) : Node(p, id) {};
+    // Leftmost child that can hold key. Equal keys may sit on both sides
+    // of a divider (a run of duplicates splits like anything else), so a
+    // range start follows this one and not child_index_for_key.
+    uint32_t first_child_index_for_key(const KeyType& key) {
+        return Traits::lower_bound(key_area(), get_key_count(), key);
+    }
 
     // Navigation: Which child should we follow?
-    uint32_t get_child_for_key(uint32_t key) {
+    uint32_t get_child_for_key(const KeyType& key) {
         uint32_t num_keys = get_key_count();
+        uint32_t idx = child_index_for_key(key);
+        return (idx < num_keys) ? get_child(idx) : get_right_child();
+    }
 
-        // Sequential scan through divider keys
-        for (uint32_t i = 0; i < num_keys; i++) {
-            uint32_t key_at_index = get_key(i);
-            if (key <= key_at_index) {
-                return get_child(i);
-            }
-        }
-        return get_right_child();
+    // Contiguous view of the divider keys
+    char* key_area() {
+        return page->data + Layout::INTERNAL_NODE_KEYS_START;
+    }
+
+    uint32_t* children() {
+        return (uint32_t*)(page->data + Layout::INTERNAL_NODE_CHILDREN_START);
     }
 
     Page* get_page() {
@@ -37,15 +58,10 @@ public:
         return *(uint32_t*)(page->data + PARENT_POINTER_OFFSET);
     };
 
-    bool is_root() const {
-        return (uint8_t) *(page->data + IS_ROOT_OFFSET) == 1;
-    };
-
-    // --- Memory Accessors using 8-byte steps ---
+    // --- Memory Accessors into the key / child arrays ---
 
     uint32_t get_child(uint32_t child_idx) {
-        // Starts at 20. Each cell is [ChildID(4b)][Key(4b)]
-        char* addr = page->data + INTERNAL_NODE_CELLS_START + (child_idx * 8);
+        char* addr = page->data + Layout::INTERNAL_NODE_CHILDREN_START + (child_idx * 4);
         return deserialize_uint32(addr);
     }
 
@@ -54,87 +70,97 @@ public:
         *(page->data + 0) = value; 
     }
 
-    SplitResult split_and_insert(SplitResult result, Pager& pager) {
-        char* cell_start = this->page->data + INTERNAL_NODE_CELLS_START;
+    // Splits this node while adding the divider for split_child's split.
+    // Works on the page itself, with the new divider and child only placed
+    // virtually: key i of the node as it would be after the insert is
+    // virtual_key(i), child j is virtual_child(j) (the right child counting
+    // as child key_count, as in child_at).
+    SplitResult split_and_insert(SplitResult result, uint32_t split_child, Pager& pager) {
+        metrics_count(METRIC_INTERNAL_SPLITS);
         uint32_t key_count = this->get_key_count();
 
-        char virtual_buffer[PAGE_SIZE] = {0};
-        std::memcpy(virtual_buffer, cell_start, key_count * 8);
-
-        uint32_t insertion_index = 0;
-        while(insertion_index < key_count) {
-            // Use your existing get_key logic but on the buffer
-            uint32_t existing_key = *(uint32_t*) (virtual_buffer + (insertion_index * 8) + 4);
-            if (existing_key > result.split_key) break;
-            insertion_index++;
-
+        // 1. Same slot search as insert_child
+        uint32_t insertion_index = child_index_for_key(result.split_key);
+        while (insertion_index > 0 && child_at(insertion_index) != split_child
+               && Traits::equal(get_key(insertion_index - 1), result.split_key)) {
+            insertion_index--;
         }
 
-        uint32_t cells_to_move = key_count - insertion_index;
-        std::memmove(
-            virtual_buffer + ((insertion_index + 1) * 8),
-            virtual_buffer + (insertion_index * 8),
-            cells_to_move * 8
-        );
-
-        *(uint32_t*)(virtual_buffer + (insertion_index * 8)) = result.new_page_id;
-        *(uint32_t*)(virtual_buffer + (insertion_index * 8) + 4) = result.split_key;
-
+        // The child that split keeps its slot in front of the new divider,
+        // the new sibling takes over the pointer right after it
+        auto virtual_key = [&](uint32_t i) {
+            if (i == insertion_index) return result.split_key;
+            return get_key(i < insertion_index ? i : i - 1);
+        };
+        auto virtual_child = [&](uint32_t j) {
+            if (j == insertion_index + 1) return result.new_page_id;
+            return child_at(j <= insertion_index ? j : j - 1);
+        };
+
+        // Appends keep this node full and move only the last key (and the
+        // new child) to the sibling, like the leaf below did
         uint32_t total_keys = key_count + 1;
-        uint32_t midpoint = total_keys / 2; 
-
-        uint32_t sibling_page_id = pager.get_unused_page_number();
-        
-        auto sibling_page_ptr = pager.read_page(sibling_page_id);
-        InternalNode sibling_node(sibling_page_ptr.get(), sibling_page_id);
-        
-        sibling_node.set_node_type(NODE_INTERNAL);
-        sibling_node.set_key_count(0);
+        bool at_right_edge = result.at_right_edge && insertion_index == key_count;
+        uint32_t midpoint = at_right_edge ? total_keys - 2 : total_keys / 2;
 
         SplitResult promotion;
-        promotion.split_key = *(uint32_t*)(virtual_buffer + (midpoint * 8) + 4);
+        promotion.split_key = virtual_key(midpoint);
+        promotion.at_right_edge = at_right_edge;
+        uint32_t left_right_child = virtual_child(midpoint);
+
+        // 2. Right half: keys after the promoted one plus the trailing child.
+        //    It only reads slots from midpoint on, which the left half keeps.
+        uint32_t sibling_page_id = pager.allocate_page();
         promotion.new_page_id = sibling_page_id;
 
-        // FIX 3: Save the OLD right child before overwriting it
-        uint32_t old_right_child = this->get_right_child();
+        auto sibling_page_ptr = pager.read_page(sibling_page_id);
+        BasicInternalNode sibling_node(sibling_page_ptr.get(), sibling_page_id);
 
-        uint32_t new_left_right_child = *(uint32_t*)(virtual_buffer + (midpoint * 8));
-        
-        this->set_key_count(midpoint);
-        this->set_right_child(new_left_right_child);
-        std::memcpy(cell_start, virtual_buffer, midpoint * 8);
+        sibling_node.set_node_type(NODE_INTERNAL);
+        sibling_node.set_is_root(0);
 
         uint32_t right_key_count = total_keys - midpoint - 1;
+        for (uint32_t i = 0; i < right_key_count; i++) {
+            sibling_node.set_key(i, virtual_key(midpoint + 1 + i));
+            sibling_node.set_child(i, virtual_child(midpoint + 1 + i));
+        }
         sibling_node.set_key_count(right_key_count);
-        
-        // The sibling inherits the original node's old Right Child
-        sibling_node.set_right_child(old_right_child);
-
-        char* sibling_cell_start = sibling_node.page->data + INTERNAL_NODE_CELLS_START;
-        std::memcpy(sibling_cell_start, virtual_buffer + ((midpoint + 1) * 8), right_key_count * 8);
+        sibling_node.set_right_child(virtual_child(total_keys));
+
+        // 3. Left half: keys [0, midpoint), the child left of the promoted
+        //    key becomes its right child. Only an insert left of the
+        //    midpoint changes anything below it.
+        if (insertion_index < midpoint) {
+            std::memmove(key_area() + (insertion_index + 1) * KEY_SIZE, key_area() + insertion_index * KEY_SIZE,
+                         (midpoint - 1 - insertion_index) * KEY_SIZE);
+            set_key(insertion_index, result.split_key);
+            if (insertion_index + 1 < midpoint) {
+                std::memmove(children() + insertion_index + 2, children() + insertion_index + 1,
+                             (midpoint - 2 - insertion_index) * 4);
+                set_child(insertion_index + 1, result.new_page_id);
+            }
+        }
+        this->set_key_count(midpoint);
+        this->set_right_child(left_right_child);
 
-        // FIX 4: Write the new sibling page back to the pager
-        pager.write_page(sibling_page_id, *sibling_page_ptr);
-        pager.write_page(this->page_id, *(this->page));
+        sibling_page_ptr.mark_dirty();
+        pager.mark_dirty(this->page_id);
         return promotion;
     }
 
 
 
     void set_child(uint32_t child_idx, uint32_t child_id) {
-        char* addr = page->data + INTERNAL_NODE_CELLS_START + (child_idx * 8);
+        char* addr = page->data + Layout::INTERNAL_NODE_CHILDREN_START + (child_idx * 4);
         serialize_uint32(child_id, addr);
     }
 
-    uint32_t get_key(uint32_t key_idx) {
-        // The key is the second half of the 8-byte cell (+4 offset)
-        char* addr = page->data + INTERNAL_NODE_CELLS_START + (key_idx * 8) + 4;
-        return deserialize_uint32(addr);
+    KeyType get_key(uint32_t key_idx) {
+        return Traits::load(key_area() + (key_idx * KEY_SIZE));
     }
 
-    void set_key(uint32_t key_idx, uint32_t key) {
-        char* addr = page->data + INTERNAL_NODE_CELLS_START + (key_idx * 8) + 4;
-        serialize_uint32(key, addr);
+    void set_key(uint32_t key_idx, const KeyType& key) {
+        Traits::store(key, key_area() + (key_idx * KEY_SIZE));
     }
 
     // --- Special Right Child (The "Else" Pointer) ---
@@ -154,37 +180,120 @@ public:
         *addr = new_root_id;
     }
 
+    // Children by position, the right child counting as child key_count
+    uint32_t child_at(uint32_t idx) {
+        return (idx < get_key_count()) ? get_child(idx) : get_right_child();
+    }
+
+    // Folds the right sibling into this node, pulling down the divider
+    // that sat between them. The caller checked that everything fits.
+    void absorb(BasicInternalNode& right, const KeyType& divider) {
+        uint32_t left_keys = get_key_count();
+        uint32_t right_keys = right.get_key_count();
 
-    void insert_child(uint32_t split_key, uint32_t new_child_page_id) {
+        // Our right child becomes an ordinary child in front of the divider
+        set_child(left_keys, get_right_child());
+        set_key(left_keys, divider);
+        std::memcpy(key_area() + (left_keys + 1) * KEY_SIZE, right.key_area(), right_keys * KEY_SIZE);
+        std::memcpy(children() + left_keys + 1, right.children(), right_keys * 4);
+
+        set_key_count(left_keys + 1 + right_keys);
+        set_right_child(right.get_right_child());
+    }
+
+    // Evens out the keys of this node and its right sibling. Returns the
+    // divider that now goes between them.
+    KeyType redistribute(BasicInternalNode& right, const KeyType& divider) {
+        uint32_t left_keys = get_key_count();
+        uint32_t right_keys = right.get_key_count();
+        uint32_t total_keys = left_keys + 1 + right_keys;
+
+        // Both nodes plus the divider laid out as one node
+        char key_buffer[(2 * MAX_CELLS + 1) * KEY_SIZE];
+        uint32_t child_buffer[2 * MAX_CELLS + 2];
+        std::memcpy(key_buffer, key_area(), left_keys * KEY_SIZE);
+        Traits::store(divider, key_buffer + left_keys * KEY_SIZE);
+        std::memcpy(key_buffer + (left_keys + 1) * KEY_SIZE, right.key_area(), right_keys * KEY_SIZE);
+        std::memcpy(child_buffer, children(), left_keys * 4);
+        child_buffer[left_keys] = get_right_child();
+        std::memcpy(child_buffer + left_keys + 1, right.children(), right_keys * 4);
+        child_buffer[total_keys] = right.get_right_child();
+
+        // Cut it in two around the middle key, like a split
+        uint32_t midpoint = total_keys / 2;
+        set_key_count(midpoint);
+        std::memcpy(key_area(), key_buffer, midpoint * KEY_SIZE);
+        std::memcpy(children(), child_buffer, midpoint * 4);
+        set_right_child(child_buffer[midpoint]);
+
+        uint32_t new_right_keys = total_keys - midpoint - 1;
+        right.set_key_count(new_right_keys);
+        std::memcpy(right.key_area(), key_buffer + (midpoint + 1) * KEY_SIZE, new_right_keys * KEY_SIZE);
+        std::memcpy(right.children(), child_buffer + midpoint + 1, new_right_keys * 4);
+        right.set_right_child(child_buffer[total_keys]);
+
+        return Traits::load(key_buffer + midpoint * KEY_SIZE);
+    }
+
+    // Called after the child right of key_idx was merged into the one left
+    // of it: drops the divider and that child
+    void remove_entry(uint32_t key_idx) {
+        uint32_t num_keys = get_key_count();
+
+        // Same trick as a split: the right child goes at the end of a
+        // scratch array so it shifts like the others
+        uint32_t child_buffer[MAX_CELLS + 1];
+        std::memcpy(child_buffer, children(), num_keys * 4);
+        child_buffer[num_keys] = get_right_child();
+
+        std::memmove(child_buffer + key_idx + 1, child_buffer + key_idx + 2, (num_keys - key_idx - 1) * 4);
+        std::memmove(key_area() + key_idx * KEY_SIZE, key_area() + (key_idx + 1) * KEY_SIZE,
+                     (num_keys - key_idx - 1) * KEY_SIZE);
+
+        set_key_count(num_keys - 1);
+        std::memcpy(children(), child_buffer, (num_keys - 1) * 4);
+        set_right_child(child_buffer[num_keys - 1]);
+    }
+
+
+    // Called after split_child split in two: it keeps everything below
+    // split_key, new_child_page_id takes the rest
+    void insert_child(const KeyType& split_key, uint32_t new_child_page_id, uint32_t split_child) {
         uint32_t num_keys = get_key_count();
-        uint32_t target_idx = num_keys;
 
         // 1. Find the correct slot for the new divider key
-        // We want to keep keys in ascending order
-        for(uint32_t i = 0; i < num_keys; i++) {
-            if(split_key < get_key(i)) {
-                target_idx = i;
-                break;
-            }
+        // We want to keep keys in ascending order. With a key repeated
+        // across several leaves the child that split may sit left of
+        // dividers equal to split_key, so look for it by id.
+        uint32_t target_idx = child_index_for_key(split_key);
+        while (target_idx > 0 && child_at(target_idx) != split_child
+               && Traits::equal(get_key(target_idx - 1), split_key)) {
+            target_idx--;
         }
 
-        // 2. Shift existing entires to the right by 8 bytes
-        // Each entry is: [4b Child ID][4b Key]
-        char* src = page->data + INTERNAL_NODE_CELLS_START + (target_idx * 8);
-        char* dest = src + 8;
-        uint32_t bytes_to_move = (num_keys - target_idx) * 8;
-
+        // 2. Shift existing keys and children one slot to the right
         if (num_keys > target_idx) {
-            std::memmove(dest, src, bytes_to_move);
+            std::memmove(key_area() + (target_idx + 1) * KEY_SIZE, key_area() + target_idx * KEY_SIZE,
+                         (num_keys - target_idx) * KEY_SIZE);
+            std::memmove(children() + target_idx + 1, children() + target_idx,
+                         (num_keys - target_idx) * 4);
         }
 
         // 3. Insert the new data
-        // The key from the SplitResult becomes the divider
-        // The new_page_id becomes the child pointer for that divider
-        set_child(target_idx, new_child_page_id);
+        // The key from the SplitResult becomes the divider, the split child
+        // sits in front of it and the new page right behind it
+        set_child(target_idx, split_child);
         set_key(target_idx, split_key);
+        if (target_idx < num_keys) {
+            set_child(target_idx + 1, new_child_page_id);
+        } else {
+            set_right_child(new_child_page_id);
+        }
 
         // 4. Increment the count
         set_key_count(num_keys + 1);
     }
-};
\ No newline at end of file
+};
+
+
+using InternalNode = BasicInternalNode<DefaultLayout>;
@@ -0,0 +1,155 @@
+#ifndef IO_BACKEND_HPP
+#define IO_BACKEND_HPP
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <sys/uio.h>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define RDBMS_HAVE_IO_URING 1
+#endif
+
+
+enum IoBackendKind {
+    IO_BACKEND_AUTO = 0,    // io_uring when the kernel allows it, pread/pwrite otherwise
+    IO_BACKEND_POSIX = 1,   // one pread/pwrite(v) system call per request
+    IO_BACKEND_URING = 2    // batches submitted through an io_uring
+};
+
+struct IoOptions {
+    IoBackendKind backend = IO_BACKEND_AUTO;
+    uint32_t queue_depth = 64;      // requests kept in flight by one submit_batch
+
+    // Serve clean pages for readers straight out of an mmap of the file
+    // instead of copying them into the pool (writes still use the backend)
+    bool map_reads = false;
+
+    // Open the data file with O_DIRECT: pages go between the pool and the
+    // device without a second copy in the OS page cache, so the pool is the
+    // only cache there is (and must be sized for it). Every transfer is
+    // page aligned. Rules out map_reads; the WAL stays buffered.
+    bool direct_io = false;
+
+    // Back the pool's frames with huge pages where the system has them (PageArena)
+    bool huge_pages = true;
+};
+
+enum IoOp {
+    IO_READ = 0,
+    IO_WRITE = 1
+};
+
+// One positioned transfer. The buffers listed in iov are filled (or
+// written) back to back starting at offset, so adjacent pages go out as a
+// single vectored request. iov must stay valid until submit_batch returns.
+struct IoRequest {
+    IoOp op = IO_READ;
+    uint64_t offset = 0;
+    const struct iovec* iov = nullptr;
+    uint32_t iov_count = 0;
+    int64_t result = 0;             // bytes transferred, or -errno
+};
+
+
+// Where the Pager's data file I/O goes. read/write are synchronous single
+// page transfers and may be called from any number of threads at once;
+// submit_batch keeps many requests in flight and returns once all of them
+// completed.
+class IoBackend {
+    protected:
+        int fd;
+
+        // Finishes a request with plain preadv/pwritev (also resumes short transfers)
+        static int64_t transfer_sync(int fd, IoRequest& request, uint64_t already_done = 0);
+
+    public:
+        explicit IoBackend(int file): fd(file) {};
+        virtual ~IoBackend() = default;
+
+        virtual const char* name() const = 0;
+
+        // True when submit_batch really overlaps requests
+        virtual bool is_async() const = 0;
+
+        virtual int64_t read(uint64_t offset, char* buffer, uint32_t length);
+        virtual int64_t write(uint64_t offset, const char* buffer, uint32_t length);
+
+        virtual void submit_batch(std::vector<IoRequest>& requests) = 0;
+};
+
+
+class PosixIoBackend : public IoBackend {
+    public:
+        explicit PosixIoBackend(int file): IoBackend(file) {};
+
+        const char* name() const override { return "pread/pwrite"; }
+        bool is_async() const override { return false; }
+
+        void submit_batch(std::vector<IoRequest>& requests) override;
+};
+
+
+#if defined(RDBMS_HAVE_IO_URING)
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+// Talks to the kernel through the raw io_uring_setup/io_uring_enter system
+// calls (no liburing). Single page reads and writes stay on pread/pwrite:
+// a lone synchronous page gains nothing from the ring, and leaving them
+// alone lets readers miss in parallel instead of queueing on the ring.
+class UringIoBackend : public IoBackend {
+    private:
+        int ring_fd = -1;
+        uint32_t queue_depth = 0;
+
+        // Submission queue ring
+        void* sq_ring = nullptr;
+        size_t sq_ring_size = 0;
+        unsigned* sq_head = nullptr;
+        unsigned* sq_tail = nullptr;
+        unsigned* sq_mask = nullptr;
+        unsigned* sq_array = nullptr;
+        struct io_uring_sqe* sqes = nullptr;
+        size_t sqes_size = 0;
+
+        // Completion queue ring (may share the mapping with the SQ ring)
+        void* cq_ring = nullptr;
+        size_t cq_ring_size = 0;
+        unsigned* cq_head = nullptr;
+        unsigned* cq_tail = nullptr;
+        unsigned* cq_mask = nullptr;
+        struct io_uring_cqe* cqes = nullptr;
+
+        // One batch owns the ring at a time
+        std::mutex ring_mutex;
+
+        void close_ring();
+
+    public:
+        UringIoBackend(int file, uint32_t depth);
+        ~UringIoBackend() override;
+
+        // False when the kernel refused to set the ring up
+        bool is_ready() const { return ring_fd >= 0; }
+
+        const char* name() const override { return "io_uring"; }
+        bool is_async() const override { return true; }
+
+        void submit_batch(std::vector<IoRequest>& requests) override;
+};
+
+#endif
+
+
+// fsync (or fdatasync) that shows up in the engine metrics
+int sync_file(int fd, bool data_only = false);
+
+
+// Builds the backend asked for, falling back to pread/pwrite (with a
+// warning when io_uring was explicitly requested) if it is unavailable
+std::unique_ptr<IoBackend> make_io_backend(int fd, const IoOptions& options);
+
+#endif
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include "node_search.hpp"
+
+// Compile-time description of a key type: its on-page width, how to move it
+// in and out of a page, its order, and the searches the nodes run over it.
+// Everything is a static inline function so each tree instantiation gets
+// its comparator inlined into the descent.
+template <typename K>
+struct KeyTraits {
+    using Key = K;
+    static constexpr uint32_t SIZE = sizeof(K);
+
+    static Key load(const char* source) {
+        Key key;
+        std::memcpy(&key, source, SIZE);
+        return key;
+    }
+
+    static void store(const Key& key, char* destination) {
+        std::memcpy(destination, &key, SIZE);
+    }
+
+    static bool less(const Key& a, const Key& b) { return a < b; }
+    static bool equal(const Key& a, const Key& b) { return !(a < b) && !(b < a); }
+
+    // Over keys stored back to back
+    static uint32_t lower_bound(const char* keys, uint32_t n, const Key& key) {
+        return generic_lower_bound<KeyTraits>(keys, SIZE, n, key);
+    }
+
+    static uint32_t upper_bound(const char* keys, uint32_t n, const Key& key) {
+        return generic_upper_bound<KeyTraits>(keys, SIZE, n, key);
+    }
+
+    // Over keys embedded in fixed-size slots
+    static uint32_t lower_bound_strided(const char* slots, uint32_t stride, uint32_t n, const Key& key) {
+        return generic_lower_bound<KeyTraits>(slots, stride, n, key);
+    }
+};
+
+
+// Integer keys get the SIMD searches for contiguous arrays
+template <>
+inline uint32_t KeyTraits<uint32_t>::lower_bound(const char* keys, uint32_t n, const uint32_t& key) {
+    return search_lower_bound((const uint32_t*) keys, n, key);
+}
+
+template <>
+inline uint32_t KeyTraits<uint32_t>::upper_bound(const char* keys, uint32_t n, const uint32_t& key) {
+    return search_upper_bound((const uint32_t*) keys, n, key);
+}
+
+template <>
+inline uint32_t KeyTraits<uint32_t>::lower_bound_strided(const char* slots, uint32_t stride, uint32_t n, const uint32_t& key) {
+    return search_lower_bound_strided(slots, stride, n, key);
+}
+
+template <>
+inline uint32_t KeyTraits<uint64_t>::lower_bound(const char* keys, uint32_t n, const uint64_t& key) {
+    return search_lower_bound((const uint64_t*) keys, n, key);
+}
+
+template <>
+inline uint32_t KeyTraits<uint64_t>::upper_bound(const char* keys, uint32_t n, const uint64_t& key) {
+    return search_upper_bound((const uint64_t*) keys, n, key);
+}
+
+
+// Fixed-width binary key (UUIDs, hashes, ...) ordered like memcmp. The
+// width is a compile-time constant, so the compare unrolls into big-endian
+// 8-byte word compares instead of a memcmp call.
+template <size_t N>
+struct FixedBytesKey {
+    std::array<uint8_t, N> bytes{};
+
+    friend bool operator<(const FixedBytesKey& a, const FixedBytesKey& b) {
+        size_t i = 0;
+        for (; i + 8 <= N; i += 8) {
+            uint64_t x;
+            uint64_t y;
+            std::memcpy(&x, a.bytes.data() + i, 8);
+            std::memcpy(&y, b.bytes.data() + i, 8);
+            if (x != y) {
+                return __builtin_bswap64(x) < __builtin_bswap64(y);
+            }
+        }
+        for (; i < N; i++) {
+            if (a.bytes[i] != b.bytes[i]) {
+                return a.bytes[i] < b.bytes[i];
+            }
+        }
+        return false;
+    }
+
+    friend bool operator==(const FixedBytesKey& a, const FixedBytesKey& b) {
+        return a.bytes == b.bytes;
+    }
+};
+
+
+// Two-column key ordered by (first, second), e.g. (tenant id, row id).
+// Stored packed, without the padding the struct itself may carry.
+template <typename A, typename B>
+struct CompositeKey {
+    A first{};
+    B second{};
+
+    friend bool operator<(const CompositeKey& a, const CompositeKey& b) {
+        return a.first < b.first || (!(b.first < a.first) && a.second < b.second);
+    }
+
+    friend bool operator==(const CompositeKey& a, const CompositeKey& b) {
+        return a.first == b.first && a.second == b.second;
+    }
+};
+
+template <typename A, typename B>
+struct KeyTraits<CompositeKey<A, B>> {
+    using Key = CompositeKey<A, B>;
+    static constexpr uint32_t SIZE = sizeof(A) + sizeof(B);
+
+    static Key load(const char* source) {
+        Key key;
+        std::memcpy(&key.first, source, sizeof(A));
+        std::memcpy(&key.second, source + sizeof(A), sizeof(B));
+        return key;
+    }
+
+    static void store(const Key& key, char* destination) {
+        std::memcpy(destination, &key.first, sizeof(A));
+        std::memcpy(destination + sizeof(A), &key.second, sizeof(B));
+    }
+
+    static bool less(const Key& a, const Key& b) { return a < b; }
+    static bool equal(const Key& a, const Key& b) { return a == b; }
+
+    static uint32_t lower_bound(const char* keys, uint32_t n, const Key& key) {
+        return generic_lower_bound<KeyTraits>(keys, SIZE, n, key);
+    }
+
+    static uint32_t upper_bound(const char* keys, uint32_t n, const Key& key) {
+        return generic_upper_bound<KeyTraits>(keys, SIZE, n, key);
+    }
+
+    static uint32_t lower_bound_strided(const char* slots, uint32_t stride, uint32_t n, const Key& key) {
+        return generic_lower_bound<KeyTraits>(slots, stride, n, key);
+    }
+};
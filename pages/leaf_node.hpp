@@ -1,27 +1,135 @@
 #pragma once
 
 #include <cstdint>
+#include <string>
+#include <vector>
+#include <functional>
 #include "page.hpp"
 #include "node.hpp"
+#include "node_search.hpp"
+#include "tree_layout.hpp"
+#include "packed_keys.hpp"
+#include "overflow_page.hpp"
 
-const uint32_t LEAF_NODE_CELL_SIZE = 36;
-const uint32_t LEAF_NODE_SPACE_FOR_CELLS = PAGE_SIZE - LEAF_NODE_CELLS_START;
-const uint32_t LEAF_NODE_MAX_CELLS = LEAF_NODE_SPACE_FOR_CELLS / LEAF_NODE_CELL_SIZE;
+// Value width of the old fixed-size rows (two-argument Table::insert)
+const uint32_t LEAF_NODE_LEGACY_VALUE_SIZE = 32;
 
 
+// Slotted leaf page (layout in tree_layout.hpp). Slot width, cell count
+// and the inline value limit come from the TreeLayout. In a packed leaf
+// (LEAF_KEYS_PACKED) the slots lose their keys to the key column, which is
+// always framed as tightly as its keys allow: the base is the first key
+// and the width fits the last one. Inserts and removals re-pack the keys
+// behind the one they touch, or all of them when the frame changes.
+template <typename Layout>
+class BasicLeafNode: public Node {
+    public:
+        using KeyType = typename Layout::KeyType;
+        using Traits = typename Layout::Traits;
+        using SplitResult = BasicSplitResult<KeyType>;
+
+        static constexpr bool PACKED = Layout::LEAF_KEYS == LEAF_KEYS_PACKED;
+        static constexpr uint32_t SLOT_SIZE = PACKED ? PACKED_LEAF_SLOT_SIZE : Layout::LEAF_NODE_SLOT_SIZE;
+        static constexpr uint32_t KEY_SIZE = Layout::KEY_SIZE;
+
+        // Where offset and length start within a slot
+        static constexpr uint32_t SLOT_KEY_SIZE = PACKED ? 0 : KEY_SIZE;
+
+    private:
+        uint16_t read_u16(uint32_t offset) {
+            uint16_t value;
+            std::memcpy(&value, page->data + offset, sizeof(uint16_t));
+            return value;
+        }
+
+        void write_u16(uint32_t offset, uint16_t value) {
+            std::memcpy(page->data + offset, &value, sizeof(uint16_t));
+        }
+
+        // --- Key column (packed leaves) ---
+
+        uint32_t get_packed_width() { return (uint8_t) page->data[PACKED_LEAF_WIDTH_OFFSET]; }
+        uint32_t get_packed_base() { return deserialize_uint32(page->data + PACKED_LEAF_BASE_OFFSET); }
+
+        void set_packing(uint32_t base, uint32_t width) {
+            page->data[PACKED_LEAF_WIDTH_OFFSET] = (char) width;
+            serialize_uint32(base, page->data + PACKED_LEAF_BASE_OFFSET);
+        }
+
+        // The column sits right behind the slots, so it moves with the count
+        char* key_column() {
+            return slot_address(get_key_count());
+        }
+
+        // Where the slots (and the key column) end
+        uint32_t directory_end() {
+            uint32_t num_cells = get_key_count();
+            uint32_t end = LEAF_NODE_SLOTS_START + (num_cells * SLOT_SIZE);
+            if constexpr (PACKED) {
+                end += packed_key_bytes(num_cells, get_packed_width());
+            }
+            return end;
+        }
+
+        // Writes the column of a leaf about to hold num_cells cells: keys
+        // are the ones from index first on. The ones before first are still
+        // packed in the old column, moved bytes before the new one, and are
+        // carried over as they are (the frame must not have changed).
+        void repack_keys(uint32_t num_cells, uint32_t base, uint32_t width, uint32_t first, const uint32_t* keys,
+                         int32_t moved) {
+            char* column = page->data + LEAF_NODE_SLOTS_START + (num_cells * SLOT_SIZE);
+            if (first > 0 && moved != 0) {
+                std::memmove(column, column - moved, packed_key_bytes(first, width));
+            }
+            set_packing(base, width);
+            pack_keys(column, width, base, first, num_cells - first, keys);
+        }
 
-class LeafNode: public Node {
     public:
-        LeafNode(Page* p, uint32_t id): Node(p, id) {};
+        BasicLeafNode(Page* p, uint32_t id): Node(p, id) {};
+
+        // Formats an empty leaf, leaving the rest of the header alone
+        void initialize() {
+            set_node_type(NODE_LEAF);
+            clear_cells();
+        }
+
+        void clear_cells() {
+            set_key_count(0);
+            set_content_start(LEAF_NODE_CONTENT_END);
+            write_u16(LEAF_NODE_FRAGMENTED_OFFSET, 0);
+            if constexpr (PACKED) {
+                set_packing(0, 0);
+            }
+        }
 
-        // Helper to find the exact memory address of the specific slot (cell)
-        char* cell_address(uint32_t cell_num) {
-            return page->data + LEAF_NODE_CELLS_START + (cell_num * LEAF_NODE_CELL_SIZE);
+        // Helper to find the exact memory address of the specific slot
+        char* slot_address(uint32_t cell_num) {
+            return page->data + LEAF_NODE_SLOTS_START + (cell_num * SLOT_SIZE);
         }
 
         // Accessors for the key of a specific cell
-        uint32_t get_key(uint32_t cell_num) {
-            return deserialize_uint32(cell_address(cell_num));
+        KeyType get_key(uint32_t cell_num) {
+            if constexpr (PACKED) {
+                return get_packed_base() + packed_delta_at(key_column(), get_packed_width(), cell_num);
+            } else {
+                return Traits::load(slot_address(cell_num));
+            }
+        }
+
+        // Slotted leaves only: a packed key may not fit the column's frame
+        void set_key(uint32_t cell_num, const KeyType& key) {
+            static_assert(!PACKED, "packed leaf keys change through insert_cell and remove_cell");
+            Traits::store(key, slot_address(cell_num));
+        }
+
+        // Index of the first cell whose key is >= key (key_count if none)
+        uint32_t find_cell(const KeyType& key) {
+            if constexpr (PACKED) {
+                return packed_lower_bound(key_column(), get_packed_width(), get_packed_base(), get_key_count(), key);
+            } else {
+                return Traits::lower_bound_strided(slot_address(0), SLOT_SIZE, get_key_count(), key);
+            }
         }
 
         uint32_t get_next_page() {
@@ -33,97 +141,490 @@ class LeafNode: public Node {
             serialize_uint32(page_id, page->data + NEXT_PAGE_OFFSET);
         }
 
-        void set_key(uint32_t cell_num, uint32_t key) {
-            serialize_uint32(key, cell_address(cell_num));
+        // --- Cell content ---
+
+        uint16_t get_cell_offset(uint32_t cell_num) {
+            uint16_t offset;
+            std::memcpy(&offset, slot_address(cell_num) + SLOT_KEY_SIZE, sizeof(uint16_t));
+            return offset;
+        }
+
+        // Slot length including the overflow flag
+        uint16_t get_cell_length_raw(uint32_t cell_num) {
+            uint16_t length;
+            std::memcpy(&length, slot_address(cell_num) + SLOT_KEY_SIZE + 2, sizeof(uint16_t));
+            return length;
+        }
+
+        uint32_t get_cell_length(uint32_t cell_num) {
+            return get_cell_length_raw(cell_num) & ~LEAF_SLOT_OVERFLOW_FLAG;
         }
 
+        char* cell_content(uint32_t cell_num) {
+            return page->data + get_cell_offset(cell_num);
+        }
+
+        bool is_overflow(uint32_t cell_num) {
+            return (get_cell_length_raw(cell_num) & LEAF_SLOT_OVERFLOW_FLAG) != 0;
+        }
+
+        uint32_t get_value_size(uint32_t cell_num) {
+            if (is_overflow(cell_num)) {
+                return deserialize_uint32(cell_content(cell_num));
+            }
+            return get_cell_length(cell_num);
+        }
+
+        // The inline value bytes (the overflow stub for large values)
         char* get_value(uint32_t cell_num) {
-            // The value starts right after the 4-byte key
-            return cell_address(cell_num) + sizeof(uint32_t);
+            return cell_content(cell_num);
         }
 
-        void set_value(uint32_t cell_num, const char* value_ptr) {
-            // We assume the value size is (LEAF_NODE-CELL_SIZE -4)
-            uint32_t value_size = LEAF_NODE_CELL_SIZE - sizeof(uint32_t);
-            std::memcpy(get_value(cell_num), value_ptr, value_size);
+        // Hands the whole value to sink, following the overflow chain if any
+        void stream_value(uint32_t cell_num, Pager& pager, const std::function<void(const char*, uint32_t)>& sink) {
+            if (is_overflow(cell_num)) {
+                stream_overflow_chain(pager, deserialize_uint32(cell_content(cell_num) + 4), sink);
+            } else {
+                sink(cell_content(cell_num), get_cell_length(cell_num));
+            }
         }
 
+        void read_value(uint32_t cell_num, Pager& pager, std::string& out) {
+            out.clear();
+            out.reserve(get_value_size(cell_num));
+            stream_value(cell_num, pager, [&out](const char* data, uint32_t size) {
+                out.append(data, size);
+            });
+        }
 
-        SplitResult split_and_insert(uint32_t key, const char* value, Pager& pager) {
-            // 1. Create a new page for the right side
-            uint32_t new_page_num = pager.get_unused_page_number();
-            auto new_page = pager.read_page(new_page_num);
-            LeafNode right_node(new_page.get(), new_page_num);
+        // --- Free space management ---
 
-            // Initialize the new right node
-            right_node.set_node_type(1); 
-            right_node.set_is_root(0);   // The new sibling is never the root
-            right_node.set_key_count(0);
-            right_node.set_next_page(this->get_next_page());
-            this->set_next_page(new_page_num);
+        uint32_t get_content_start() {
+            // A zeroed page is an empty leaf
+            uint16_t start = read_u16(LEAF_NODE_CONTENT_START_OFFSET);
+            return start == 0 ? LEAF_NODE_CONTENT_END : start;
+        }
+
+        void set_content_start(uint32_t offset) {
+            write_u16(LEAF_NODE_CONTENT_START_OFFSET, (uint16_t) offset);
+        }
+
+        uint32_t get_fragmented_bytes() {
+            return read_u16(LEAF_NODE_FRAGMENTED_OFFSET);
+        }
+
+        // Free bytes in the gap plus holes left by removed cells
+        uint32_t get_free_space() {
+            return get_content_start() - directory_end() + get_fragmented_bytes();
+        }
 
-            // 2. Move half the cells
-            uint32_t total_cells = get_key_count();
-            uint32_t left_count = total_cells / 2;
-            uint32_t right_count = total_cells - left_count;
+        // Whether a cell for key with content_length bytes fits without a
+        // split (in a packed leaf the key may widen the whole column)
+        bool has_room(uint32_t content_length, const KeyType& key) {
+            uint32_t needed = SLOT_SIZE + content_length;
+            if constexpr (PACKED) {
+                uint32_t num_cells = get_key_count();
+                uint32_t width = 0;
+                if (num_cells > 0) {
+                    uint32_t first = std::min(get_key(0), key);
+                    uint32_t last = std::max(get_key(num_cells - 1), key);
+                    width = packed_key_width(last - first);
+                }
+                needed += packed_key_bytes(num_cells + 1, width) - packed_key_bytes(num_cells, get_packed_width());
+            }
+            return get_free_space() >= needed;
+        }
 
-            for (uint32_t i = 0; i < right_count; i++) {
-                uint32_t old_index = left_count + i;
-                right_node.set_key(i, this->get_key(old_index));
-                right_node.set_value(i, this->get_value(old_index));
+        // What count cells from first_key to last_key with content_bytes of
+        // content take up in a leaf of their own, slots included
+        static uint32_t cells_bytes(uint32_t count, uint32_t content_bytes, const KeyType& first_key,
+                                    const KeyType& last_key) {
+            uint32_t bytes = count * SLOT_SIZE + content_bytes;
+            if constexpr (PACKED) {
+                bytes += count == 0 ? 0 : packed_key_bytes(count, packed_key_width(last_key - first_key));
             }
+            return bytes;
+        }
 
-            this->set_key_count(left_count);
-            right_node.set_key_count(right_count);
+        // Roughly what removing a cell gives back (a packed column may
+        // shrink a little more)
+        uint32_t get_cell_bytes(uint32_t cell_num) {
+            return SLOT_SIZE + get_cell_length(cell_num);
+        }
 
-            // 3. Insert the new record into the correct side
-            if (key <= this->get_key(left_count - 1)) {
-                this->insert(key, value, pager);
-            } else {
-                right_node.insert(key, value, pager);
+        uint32_t get_content_bytes() {
+            uint32_t bytes = 0;
+            for (uint32_t i = 0; i < get_key_count(); i++) {
+                bytes += get_cell_length(i);
             }
+            return bytes;
+        }
 
-            // 4. Commit to disk
-            pager.write_page(new_page_num, *new_page);
-            pager.write_page(this->get_page_id(), *(this->page));
+        // Whether absorb(right) fits
+        bool can_absorb(BasicLeafNode& right) {
+            uint32_t left_cells = get_key_count();
+            uint32_t right_cells = right.get_key_count();
+            if (left_cells == 0 || right_cells == 0) {
+                return get_used_bytes() + right.get_used_bytes() <= LEAF_NODE_SPACE_FOR_CELLS;
+            }
+            return cells_bytes(left_cells + right_cells, get_content_bytes() + right.get_content_bytes(),
+                               get_key(0), right.get_key(right_cells - 1)) <= LEAF_NODE_SPACE_FOR_CELLS;
+        }
 
-            // 5. RETURN the info needed for promotion
-            // We use the first key of the right node as the divider
-            return { right_node.get_key(0), new_page_num };
-        };
+        // Bytes the cells take up, slots included
+        uint32_t get_used_bytes() {
+            // Leaves from format version 2 files may use the last four bytes too
+            uint32_t free_space = get_free_space();
+            return free_space >= LEAF_NODE_SPACE_FOR_CELLS ? 0 : LEAF_NODE_SPACE_FOR_CELLS - free_space;
+        }
+
+        // Rewrites the cell content back to back below the page checksum,
+        // leaving at least room bytes free. Leaves from format version 2
+        // files may have counted on the last four bytes as well; they get
+        // them (such a file has no checksums).
+        void compact(uint32_t room = 0) {
+            char scratch[PAGE_SIZE];
+            std::memcpy(scratch, page->data, PAGE_SIZE);
 
-        
-        SplitResult insert(uint32_t key, const char* value, Pager& pager) {
-            
             uint32_t num_cells = get_key_count();
+            uint32_t content_bytes = 0;
+            for (uint32_t i = 0; i < num_cells; i++) {
+                content_bytes += get_cell_length(i);
+            }
+            uint32_t slots_end = directory_end();
+            uint32_t end = slots_end + content_bytes + room <= LEAF_NODE_CONTENT_END ? LEAF_NODE_CONTENT_END : PAGE_SIZE;
 
-            if (num_cells >= LEAF_NODE_MAX_CELLS) {
-                return split_and_insert(key, value, pager);
+            for (uint32_t i = 0; i < num_cells; i++) {
+                uint32_t length = get_cell_length(i);
+                end -= length;
+                std::memcpy(page->data + end, scratch + get_cell_offset(i), length);
+                uint16_t offset = end;
+                std::memcpy(slot_address(i) + SLOT_KEY_SIZE, &offset, sizeof(uint16_t));
             }
 
-            // 1. Find the spot where this ID belongs
-            uint32_t target_cell = 0;
-            while (target_cell < num_cells && get_key(target_cell) < key) {
-                target_cell++;
+            set_content_start(end);
+            write_u16(LEAF_NODE_FRAGMENTED_OFFSET, 0);
+        }
+
+        // Places a cell at slot index. The caller checks has_room first, and
+        // content must not point into this page (it may get compacted).
+        void insert_cell(uint32_t index, const KeyType& key, const char* content, uint16_t raw_length) {
+            uint32_t length = raw_length & ~LEAF_SLOT_OVERFLOW_FLAG;
+            uint32_t num_cells = get_key_count();
+            uint32_t slots_end = LEAF_NODE_SLOTS_START + ((num_cells + 1) * SLOT_SIZE);
+
+            // Packed: the keys that move (all of them if the frame changes)
+            // are decoded before anything else does
+            uint32_t keys[PACKED ? Layout::LEAF_NODE_MAX_CELLS + 1 : 1];
+            uint32_t base = 0;
+            uint32_t width = 0;
+            uint32_t first = 0;
+            if constexpr (PACKED) {
+                base = key;
+                if (num_cells > 0) {
+                    base = std::min(get_key(0), key);
+                    width = packed_key_width(std::max(get_key(num_cells - 1), key) - base);
+                }
+                uint32_t old_width = get_packed_width();
+                first = (base == get_packed_base() && width == old_width) ? index : 0;
+                unpack_keys(key_column(), old_width, get_packed_base(), first, num_cells - first, keys);
+                std::memmove(keys + (index - first) + 1, keys + (index - first), (num_cells - index) * sizeof(uint32_t));
+                keys[index - first] = key;
+                slots_end += packed_key_bytes(num_cells + 1, width);
             }
 
-            // 2. Shift existing records to the right to make a hole
-            if (target_cell < num_cells) {
-                char* src = cell_address(target_cell);
-                char*dest = cell_address(target_cell + 1);
-                uint32_t bytes_to_move = (num_cells - target_cell) * LEAF_NODE_CELL_SIZE;
-                std::memmove(dest, src, bytes_to_move);
+            if (get_content_start() < slots_end + length) {
+                compact(slots_end - directory_end() + length);
             }
 
-            // 3. Write the carved data into the hole
-            set_key(target_cell, key);
-            set_value(target_cell, value);
+            // 1. Carve the content out of the top of the free gap
+            uint32_t offset = get_content_start() - length;
+            std::memcpy(page->data + offset, content, length);
+            set_content_start(offset);
 
-            // 4. Update the header so we know there is a new record
+            // 2. Shift the slots to the right to make a hole (a packed leaf
+            // moves its column out of the way first)
+            if constexpr (PACKED) {
+                repack_keys(num_cells + 1, base, width, first, keys, SLOT_SIZE);
+            }
+            if (index < num_cells) {
+                std::memmove(slot_address(index + 1), slot_address(index),
+                             (num_cells - index) * SLOT_SIZE);
+            }
+
+            // 3. Fill the slot and bump the count
+            uint16_t offset16 = offset;
+            if constexpr (!PACKED) {
+                set_key(index, key);
+            }
+            std::memcpy(slot_address(index) + SLOT_KEY_SIZE, &offset16, sizeof(uint16_t));
+            std::memcpy(slot_address(index) + SLOT_KEY_SIZE + 2, &raw_length, sizeof(uint16_t));
             set_key_count(num_cells + 1);
+        }
+
+        void append_cell(const KeyType& key, const char* content, uint16_t raw_length) {
+            insert_cell(get_key_count(), key, content, raw_length);
+        }
+
+        // Drops a slot; its content becomes a hole until the next compaction
+        void remove_cell(uint32_t index) {
+            uint32_t num_cells = get_key_count();
+            uint32_t length = get_cell_length(index);
+
+            if (get_cell_offset(index) == get_content_start()) {
+                set_content_start(get_content_start() + length);
+            } else {
+                write_u16(LEAF_NODE_FRAGMENTED_OFFSET, get_fragmented_bytes() + length);
+            }
+
+            if constexpr (PACKED) {
+                remove_packed_slot(index);
+                return;
+            }
+
+            std::memmove(slot_address(index), slot_address(index + 1),
+                         (num_cells - index - 1) * SLOT_SIZE);
+            set_key_count(num_cells - 1);
+        }
+
+        // remove_cell for a packed leaf, past the content bookkeeping
+        void remove_packed_slot(uint32_t index) {
+            uint32_t num_cells = get_key_count();
+            uint32_t keys[Layout::LEAF_NODE_MAX_CELLS];
+
+            // 1. Frame what stays and decode what moves
+            uint32_t base = 0;
+            uint32_t width = 0;
+            if (num_cells > 1) {
+                base = get_key(index == 0 ? 1 : 0);
+                width = packed_key_width(get_key(index == num_cells - 1 ? num_cells - 2 : num_cells - 1) - base);
+            }
+            uint32_t first = (base == get_packed_base() && width == get_packed_width()) ? index : 0;
+            unpack_keys(key_column(), get_packed_width(), get_packed_base(), first, num_cells - first, keys);
+            std::memmove(keys + (index - first), keys + (index - first) + 1, (num_cells - index - 1) * sizeof(uint32_t));
+
+            // 2. Close the slot, then pull the column in behind it
+            std::memmove(slot_address(index), slot_address(index + 1),
+                         (num_cells - index - 1) * SLOT_SIZE);
+            repack_keys(num_cells - 1, base, width, first, keys, -(int32_t) SLOT_SIZE);
+            set_key_count(num_cells - 1);
+        }
+
+        // Drops a cell along with the overflow chain behind it, if any
+        void erase_cell(uint32_t index, Pager& pager) {
+            if (is_overflow(index)) {
+                free_overflow_chain(pager, deserialize_uint32(cell_content(index) + 4));
+            }
+            remove_cell(index);
+        }
+
+        // Folds the right sibling into this leaf. The caller checked that
+        // everything fits.
+        void absorb(BasicLeafNode& right) {
+            uint32_t num_cells = right.get_key_count();
+            for (uint32_t i = 0; i < num_cells; i++) {
+                append_cell(right.get_key(i), right.cell_content(i), right.get_cell_length_raw(i));
+            }
+            set_next_page(right.get_next_page());
+        }
+
+        // Moves a cut between cells [0, cut) and [cut, count) until both
+        // sides fit a page. Only packed leaves need it: a column of keys
+        // from both sides may be wider than either half's. content_before[i]
+        // is the content of cells [0, i).
+        template <typename KeyAt>
+        static uint32_t fit_cut(uint32_t cut, uint32_t count, const std::vector<uint32_t>& content_before,
+                                KeyAt key_at) {
+            auto fits = [&](uint32_t from, uint32_t to) {
+                return cells_bytes(to - from, content_before[to] - content_before[from], key_at(from), key_at(to - 1))
+                       <= LEAF_NODE_SPACE_FOR_CELLS;
+            };
+            while (cut > 1 && !fits(0, cut)) cut--;
+            while (cut < count - 1 && !fits(cut, count)) cut++;
+            return cut;
+        }
+
+        // Evens out the bytes of this leaf and its right sibling. Returns the
+        // first key of the right one, the new divider between them.
+        KeyType redistribute(BasicLeafNode& right) {
+            // 1. Snapshot both, the cells are rebuilt in place
+            Page left_snapshot = *page;
+            Page right_snapshot = *right.page;
+            BasicLeafNode old_left(&left_snapshot, page_id);
+            BasicLeafNode old_right(&right_snapshot, right.page_id);
+
+            uint32_t left_cells = old_left.get_key_count();
+            uint32_t total_cells = left_cells + old_right.get_key_count();
+            uint32_t total_bytes = old_left.get_used_bytes() + old_right.get_used_bytes();
+            auto source = [&](uint32_t i) -> std::pair<BasicLeafNode*, uint32_t> {
+                return (i < left_cells) ? std::make_pair(&old_left, i) : std::make_pair(&old_right, i - left_cells);
+            };
+
+            // 2. Same cut as a split: half the bytes on the left, at least
+            // one cell on each side
+            uint32_t left_count = 0;
+            uint32_t left_bytes = 0;
+            while (left_count < total_cells) {
+                auto [node, i] = source(left_count);
+                uint32_t size = SLOT_SIZE + node->get_cell_length(i);
+                if (left_bytes + size > total_bytes / 2) break;
+                left_bytes += size;
+                left_count++;
+            }
+            left_count = std::clamp<uint32_t>(left_count, 1, total_cells - 1);
+            if constexpr (PACKED) {
+                std::vector<uint32_t> content_before(total_cells + 1, 0);
+                for (uint32_t n = 0; n < total_cells; n++) {
+                    auto [node, i] = source(n);
+                    content_before[n + 1] = content_before[n] + node->get_cell_length(i);
+                }
+                left_count = fit_cut(left_count, total_cells, content_before, [&](uint32_t n) {
+                    auto [node, i] = source(n);
+                    return node->get_key(i);
+                });
+            }
+
+            // 3. Rebuild both from the snapshots
+            this->clear_cells();
+            right.clear_cells();
+            for (uint32_t n = 0; n < total_cells; n++) {
+                auto [node, i] = source(n);
+                BasicLeafNode& target = (n < left_count) ? *this : right;
+                target.append_cell(node->get_key(i), node->cell_content(i), node->get_cell_length_raw(i));
+            }
+            return right.get_key(0);
+        }
+
+        // Turns a value into cell content: small values are stored as is,
+        // large ones are written to a fresh overflow chain and replaced by a
+        // stub written into stub_out. Returns the raw slot length.
+        static uint16_t prepare_cell(Pager& pager, const char* value, uint32_t value_size,
+                                     char* stub_out, const char** content_out) {
+            if (value_size <= Layout::LEAF_NODE_MAX_INLINE_VALUE) {
+                *content_out = value;
+                return (uint16_t) value_size;
+            }
+
+            uint32_t first_page = pager.allocate_pages(overflow_chain_length(value_size));
+            fill_overflow_chain(first_page, value, value_size, [&pager](uint32_t page_id) {
+                auto page_handle = pager.read_page(page_id);
+                page_handle.mark_dirty();
+                return page_handle;
+            });
+
+            serialize_uint32(value_size, stub_out);
+            serialize_uint32(first_page, stub_out + 4);
+            *content_out = stub_out;
+            return LEAF_NODE_OVERFLOW_STUB_SIZE | LEAF_SLOT_OVERFLOW_FLAG;
+        }
+
+
+        SplitResult split_and_insert(const KeyType& key, const char* content, uint16_t raw_length, Pager& pager) {
+            metrics_count(METRIC_LEAF_SPLITS);
+
+            // 1. Snapshot the cells, with the new one in its sorted position
+            Page snapshot = *page;
+            BasicLeafNode old_node(&snapshot, page_id);
+
+            struct PendingCell {
+                KeyType key;
+                const char* content;
+                uint16_t raw_length;
+            };
+
+            uint32_t num_cells = old_node.get_key_count();
+            uint32_t insert_at = old_node.find_cell(key);
+            std::vector<PendingCell> cells;
+            cells.reserve(num_cells + 1);
+
+            uint32_t total_bytes = 0;
+            for (uint32_t i = 0; i <= num_cells; i++) {
+                PendingCell cell;
+                if (i == insert_at) {
+                    cell = { key, content, raw_length };
+                } else {
+                    uint32_t old_index = (i < insert_at) ? i : i - 1;
+                    cell = { old_node.get_key(old_index), old_node.cell_content(old_index),
+                             old_node.get_cell_length_raw(old_index) };
+                }
+                total_bytes += SLOT_SIZE + (cell.raw_length & ~LEAF_SLOT_OVERFLOW_FLAG);
+                cells.push_back(cell);
+            }
+
+            // 2. Split by bytes, not by count: the left half takes cells until
+            // it holds half the data, and both halves keep at least one cell.
+            // An append past the last key of the last leaf is different: a
+            // 50/50 cut would leave every leaf behind it half empty for good,
+            // so the old cells all stay and the new one starts a fresh leaf.
+            bool at_right_edge = insert_at == num_cells && this->get_next_page() == 0;
+            uint32_t left_count = 0;
+            if (at_right_edge) {
+                left_count = num_cells;
+            } else {
+                uint32_t left_bytes = 0;
+                while (left_count < cells.size()) {
+                    uint32_t size = SLOT_SIZE + (cells[left_count].raw_length & ~LEAF_SLOT_OVERFLOW_FLAG);
+                    if (left_bytes + size > total_bytes / 2) break;
+                    left_bytes += size;
+                    left_count++;
+                }
+            }
+            left_count = std::clamp<uint32_t>(left_count, 1, cells.size() - 1);
+            if constexpr (PACKED) {
+                std::vector<uint32_t> content_before(cells.size() + 1, 0);
+                for (uint32_t i = 0; i < cells.size(); i++) {
+                    content_before[i + 1] = content_before[i] + (cells[i].raw_length & ~LEAF_SLOT_OVERFLOW_FLAG);
+                }
+                left_count = fit_cut(left_count, cells.size(), content_before,
+                                     [&cells](uint32_t i) { return cells[i].key; });
+            }
+
+            // 3. Create a new page for the right side
+            uint32_t new_page_num = pager.allocate_page();
+            auto new_page = pager.read_page(new_page_num);
+            BasicLeafNode right_node(new_page.get(), new_page_num);
 
-            return { 0, 0 };
+            // Initialize the new right node
+            right_node.initialize();
+            right_node.set_is_root(0);   // The new sibling is never the root
+            right_node.set_next_page(this->get_next_page());
+            this->set_next_page(new_page_num);
+
+            // 4. Rebuild both halves from the snapshot
+            this->clear_cells();
+            for (uint32_t i = 0; i < cells.size(); i++) {
+                BasicLeafNode& target = (i < left_count) ? *this : right_node;
+                target.append_cell(cells[i].key, cells[i].content, cells[i].raw_length);
+            }
+
+            // 5. Both halves now differ from disk
+            new_page.mark_dirty();
+            pager.mark_dirty(this->get_page_id());
+
+            // 6. RETURN the info needed for promotion
+            // We use the first key of the right node as the divider
+            return { right_node.get_key(0), new_page_num, at_right_edge };
+        };
+
+
+        SplitResult insert(const KeyType& key, const char* value, uint32_t value_size, Pager& pager) {
+            // 1. Small values go in as is, large ones leave a stub behind
+            char stub[LEAF_NODE_OVERFLOW_STUB_SIZE];
+            const char* content;
+            uint16_t raw_length = prepare_cell(pager, value, value_size, stub, &content);
+
+            if (!has_room(raw_length & ~LEAF_SLOT_OVERFLOW_FLAG, key)) {
+                return split_and_insert(key, content, raw_length, pager);
+            }
+
+            // 2. Find the spot where this ID belongs and carve the cell
+            insert_cell(find_cell(key), key, content, raw_length);
+
+            return { KeyType{}, 0 };
         }
 
-    
-};
\ No newline at end of file
+
+};
+
+
+using LeafNode = BasicLeafNode<DefaultLayout>;
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "wal.hpp"
+#include "tree_layout.hpp"
+
+// Rows accepted by a write-buffered table (TableOptions::buffered_writes)
+// before they reach the tree. Each one is logged to a WAL of its own (the
+// table file name plus ".mem") and kept in a sorted map; once the map has
+// grown past the limit the table merges all of it into the leaves in one
+// sorted pass, so random inserts turn into a sweep over the leaf level.
+//
+// Like the tree, the memtable may hold the same key more than once. Rows
+// are ordered by key, then by the LSN of their log record.
+//
+// Not synchronized: the table guards it with its memtable latch.
+
+// --- LOG RECORDS (WAL_LOGICAL payloads) ---
+//   put:   [op 1][key][value bytes]
+//   erase: [op 1][key][LSN of the put it takes back 8]
+enum MemtableOp : uint8_t {
+    MEMTABLE_PUT = 1,
+    MEMTABLE_ERASE = 2
+};
+
+template <typename Layout>
+class BasicMemtable {
+    public:
+        using KeyType = typename Layout::KeyType;
+        using Traits = typename Layout::Traits;
+
+        struct Entry {
+            KeyType key;
+            uint64_t lsn;
+        };
+
+    private:
+        struct EntryLess {
+            bool operator()(const Entry& a, const Entry& b) const {
+                if (Traits::less(a.key, b.key)) return true;
+                if (Traits::less(b.key, a.key)) return false;
+                return a.lsn < b.lsn;
+            }
+        };
+
+        std::map<Entry, std::string, EntryLess> rows;
+        uint64_t bytes = 0;         // keys and values held, what the limit is checked against
+        uint64_t logged_lsn = 0;    // 0 before the first record
+        std::unique_ptr<Wal> log;
+
+        // Bookkeeping per row on top of key and value, roughly what the map spends
+        static constexpr uint64_t ENTRY_OVERHEAD = 64;
+
+    public:
+        using Map = std::map<Entry, std::string, EntryLess>;
+
+        BasicMemtable(const std::string& filename, const WalOptions& wal_options = WalOptions()) {
+            log = std::make_unique<Wal>(filename, wal_options);
+        }
+
+        bool empty() const { return rows.empty(); }
+        uint64_t size() const { return rows.size(); }
+        uint64_t get_bytes() const { return bytes; }
+        const Map& get_rows() const { return rows; }
+
+        // Everything up to the newest row is on disk once this returns
+        void sync() { log->sync(); }
+
+        // Rebuilds the map from the log. A flush that was cut short had put
+        // the first flushed_rows rows (in key order) of everything logged up
+        // to flush_lsn into the tree already; those are left out. Returns
+        // the rows recovered.
+        uint64_t recover(uint64_t flush_lsn, uint64_t flushed_rows) {
+            log->recover([](uint32_t, const Page&) {},
+                [this](uint64_t lsn, const char* payload, uint32_t length) {
+                    logged_lsn = lsn;
+                    if (length < 1 + Layout::KEY_SIZE) return;
+                    KeyType key = Traits::load(payload + 1);
+                    const char* rest = payload + 1 + Layout::KEY_SIZE;
+                    uint32_t rest_length = length - 1 - Layout::KEY_SIZE;
+
+                    if (payload[0] == MEMTABLE_PUT) {
+                        add({ key, lsn }, std::string(rest, rest_length));
+                    } else if (payload[0] == MEMTABLE_ERASE && rest_length == sizeof(uint64_t)) {
+                        uint64_t target;
+                        std::memcpy(&target, rest, sizeof(uint64_t));
+                        remove(rows.find({ key, target }));
+                    }
+                });
+
+            // The map is in key order already, so the flushed rows are the
+            // first ones logged no later than flush_lsn
+            for (auto it = rows.begin(); it != rows.end() && flushed_rows > 0; ) {
+                if (it->first.lsn <= flush_lsn) {
+                    it = remove(it);
+                    flushed_rows--;
+                } else {
+                    ++it;
+                }
+            }
+            return rows.size();
+        }
+
+        // Logs the row, then adds it. Returns its LSN.
+        uint64_t put(const KeyType& key, const char* value, uint32_t value_size) {
+            std::string record(1 + Layout::KEY_SIZE + value_size, '\0');
+            record[0] = MEMTABLE_PUT;
+            Traits::store(key, record.data() + 1);
+            std::memcpy(record.data() + 1 + Layout::KEY_SIZE, value, value_size);
+
+            uint64_t lsn = log->log_record(record.data(), record.size());
+            logged_lsn = lsn;
+            add({ key, lsn }, std::string(value, value_size));
+            return lsn;
+        }
+
+        // Takes back the newest row with key, if there is one
+        bool erase(const KeyType& key) {
+            auto it = newest(key);
+            if (it == rows.end()) return false;
+
+            char record[1 + Layout::KEY_SIZE + sizeof(uint64_t)];
+            record[0] = MEMTABLE_ERASE;
+            Traits::store(key, record + 1);
+            std::memcpy(record + 1 + Layout::KEY_SIZE, &it->first.lsn, sizeof(uint64_t));
+            logged_lsn = log->log_record(record, sizeof(record));
+
+            remove(it);
+            return true;
+        }
+
+        // Value of the newest row with key, null if there is none
+        const std::string* find(const KeyType& key) const {
+            auto it = newest(key);
+            return it == rows.end() ? nullptr : &it->second;
+        }
+
+        // Copies of the rows with lo <= key <= hi, in order
+        std::vector<std::pair<KeyType, std::string>> copy_range(const KeyType& lo, const KeyType& hi) const {
+            std::vector<std::pair<KeyType, std::string>> out;
+            for (auto it = rows.lower_bound({ lo, 0 }); it != rows.end() && !Traits::less(hi, it->first.key); ++it) {
+                out.emplace_back(it->first.key, it->second);
+            }
+            return out;
+        }
+
+        // LSN of the newest record in the log, erases included
+        uint64_t last_lsn() const { return logged_lsn; }
+
+        // Called once every row is in the tree and the tree is durable
+        void clear() {
+            log->reset();
+            rows.clear();
+            bytes = 0;
+        }
+
+    private:
+        void add(const Entry& entry, std::string value) {
+            bytes += Layout::KEY_SIZE + value.size() + ENTRY_OVERHEAD;
+            rows.emplace(entry, std::move(value));
+        }
+
+        typename Map::iterator remove(typename Map::const_iterator it) {
+            if (it == rows.end()) return rows.end();
+            bytes -= Layout::KEY_SIZE + it->second.size() + ENTRY_OVERHEAD;
+            return rows.erase(it);
+        }
+
+        typename Map::const_iterator newest(const KeyType& key) const {
+            auto it = rows.lower_bound({ key, UINT64_MAX });
+            if (it == rows.begin()) return rows.end();
+            --it;
+            return Traits::equal(it->first.key, key) ? it : rows.end();
+        }
+};
@@ -0,0 +1,172 @@
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include <atomic>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Engine instrumentation.
+// Every thread bumps its own shard of counters and histograms (plain
+// relaxed stores, no shared cache lines), and metrics_snapshot() sums the
+// shards when somebody asks. The numbers are process-wide: every table
+// and pager in the process counts into the same shards.
+
+
+enum MetricCounter {
+    METRIC_PAGE_READS = 0,          // data file pages read from disk
+    METRIC_PAGE_WRITES,             // data file pages written to disk
+    METRIC_BUFFER_HITS,             // read_page found the page in the pool
+    METRIC_BUFFER_MISSES,           // read_page had to load the page
+    METRIC_FSYNCS,                  // fsync/fdatasync of the data file or the WAL
+    METRIC_LEAF_SPLITS,
+    METRIC_INTERNAL_SPLITS,
+    METRIC_ROOT_SPLITS,
+    METRIC_NODE_MERGES,             // a leaf or internal node folded into its sibling
+    METRIC_NODE_REDISTRIBUTIONS,    // entries moved over from a sibling instead
+    METRIC_PAGES_FREED,
+    METRIC_PAGES_REUSED,            // allocations served from the free list
+    METRIC_APPEND_INSERTS,          // inserts that went straight to the cached rightmost leaf
+    METRIC_MEMTABLE_FLUSHES,
+    METRIC_MEMTABLE_ROWS_FLUSHED,
+    METRIC_MAPPED_READS,            // misses served straight from the file mapping (no copy)
+    METRIC_CHECKSUM_FAILURES,       // pages that failed their checksum (on read, eviction or scrub)
+    METRIC_HASH_INDEX_HITS,         // lookups the hash index sent straight to the right leaf
+    METRIC_HASH_INDEX_STALE,        // ... or to a leaf that no longer held the key
+    METRIC_PAGE_VERSIONS_KEPT,      // page images copied aside for open snapshots
+    METRIC_SNAPSHOT_VERSION_READS,  // snapshot page reads served by such an image
+    METRIC_COUNTER_COUNT
+};
+
+enum MetricHistogram {
+    METRIC_INSERT_LATENCY = 0,      // Table::insert, end to end
+    METRIC_LOOKUP_LATENCY,          // Table::find
+    METRIC_ERASE_LATENCY,           // Table::erase
+    METRIC_IO_READ_LATENCY,         // one read call (a page or a batch)
+    METRIC_IO_WRITE_LATENCY,        // one write call (a page or a batch)
+    METRIC_FSYNC_LATENCY,
+    METRIC_MEMTABLE_FLUSH_LATENCY,  // one whole memtable merged into the tree
+    METRIC_HISTOGRAM_COUNT
+};
+
+const char* metric_counter_name(MetricCounter counter);
+const char* metric_histogram_name(MetricHistogram histogram);
+
+
+// --- HDR-style histogram layout ---
+// Values below 16 get a bucket each; above that every power of two is cut
+// into 16 sub-buckets, so any recorded value is off by at most 1/16 (~6%)
+// whatever its magnitude, from nanoseconds to minutes.
+const uint32_t HISTOGRAM_SUB_BUCKET_BITS = 4;
+const uint32_t HISTOGRAM_SUB_BUCKETS = 1u << HISTOGRAM_SUB_BUCKET_BITS;
+const uint32_t HISTOGRAM_BUCKETS = (64 - HISTOGRAM_SUB_BUCKET_BITS + 1) * HISTOGRAM_SUB_BUCKETS;
+
+inline uint32_t histogram_bucket(uint64_t value) {
+    if (value < HISTOGRAM_SUB_BUCKETS) return (uint32_t) value;
+    uint32_t msb = 63 - __builtin_clzll(value);
+    uint32_t shift = msb - HISTOGRAM_SUB_BUCKET_BITS;
+    return (shift + 1) * HISTOGRAM_SUB_BUCKETS + (uint32_t) ((value >> shift) & (HISTOGRAM_SUB_BUCKETS - 1));
+}
+
+// Smallest value that lands in bucket
+inline uint64_t histogram_bucket_low(uint32_t bucket) {
+    if (bucket < HISTOGRAM_SUB_BUCKETS) return bucket;
+    uint32_t shift = bucket / HISTOGRAM_SUB_BUCKETS - 1;
+    return (uint64_t) (HISTOGRAM_SUB_BUCKETS + bucket % HISTOGRAM_SUB_BUCKETS) << shift;
+}
+
+
+// Summed histogram, values in nanoseconds
+struct HistogramSnapshot {
+    std::array<uint64_t, HISTOGRAM_BUCKETS> buckets{};
+    uint64_t count = 0;
+    uint64_t sum = 0;
+    uint64_t max = 0;
+
+    // Value below which a fraction p of the samples fall (bucket resolution)
+    uint64_t percentile(double p) const;
+    double mean() const { return count ? (double) sum / count : 0.0; }
+};
+
+struct MetricsSnapshot {
+    std::array<uint64_t, METRIC_COUNTER_COUNT> counters{};
+    std::array<HistogramSnapshot, METRIC_HISTOGRAM_COUNT> histograms{};
+
+    uint64_t get(MetricCounter counter) const { return counters[counter]; }
+    const HistogramSnapshot& get(MetricHistogram histogram) const { return histograms[histogram]; }
+
+    // One "name value" line per counter, one line per non-empty histogram:
+    //   insert_latency_ns count=N mean=.. p50=.. p90=.. p99=.. p999=.. max=..
+    std::string to_text() const;
+};
+
+
+// One thread's counters. Only the owning thread writes, so an increment
+// is a load and a store rather than a locked read-modify-write.
+struct MetricsShard {
+    std::array<std::atomic<uint64_t>, METRIC_COUNTER_COUNT> counters{};
+
+    struct Histogram {
+        std::array<std::atomic<uint64_t>, HISTOGRAM_BUCKETS> buckets{};
+        std::atomic<uint64_t> sum{0};
+        std::atomic<uint64_t> max{0};
+    };
+    std::array<Histogram, METRIC_HISTOGRAM_COUNT> histograms;
+};
+
+inline void metrics_bump(std::atomic<uint64_t>& slot, uint64_t amount) {
+    slot.store(slot.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+// Registers a shard for the calling thread (first use only)
+MetricsShard* metrics_attach_thread();
+
+inline thread_local MetricsShard* metrics_thread_shard = nullptr;
+
+inline MetricsShard& metrics_shard() {
+    MetricsShard* shard = metrics_thread_shard;
+    return shard != nullptr ? *shard : *metrics_attach_thread();
+}
+
+inline void metrics_count(MetricCounter counter, uint64_t amount = 1) {
+    metrics_bump(metrics_shard().counters[counter], amount);
+}
+
+inline void metrics_record(MetricHistogram histogram, uint64_t nanos) {
+    MetricsShard::Histogram& target = metrics_shard().histograms[histogram];
+    metrics_bump(target.buckets[histogram_bucket(nanos)], 1);
+    metrics_bump(target.sum, nanos);
+    if (nanos > target.max.load(std::memory_order_relaxed)) {
+        target.max.store(nanos, std::memory_order_relaxed);
+    }
+}
+
+// Sums every thread's shard, including threads that have exited
+MetricsSnapshot metrics_snapshot();
+
+
+// Records the time until it goes out of scope
+class LatencyTimer {
+    private:
+        MetricHistogram histogram;
+        std::chrono::steady_clock::time_point start;
+
+    public:
+        explicit LatencyTimer(MetricHistogram h): histogram(h), start(std::chrono::steady_clock::now()) {};
+        ~LatencyTimer() {
+            metrics_record(histogram, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start).count());
+        }
+
+        LatencyTimer(const LatencyTimer&) = delete;
+        LatencyTimer& operator=(const LatencyTimer&) = delete;
+};
+
+
+// Console tracing of engine events (page faults, ...). Off unless the
+// RDBMS_TRACE environment variable is set or it is switched on here.
+bool trace_enabled();
+void set_trace_enabled(bool enabled);
+
+#endif
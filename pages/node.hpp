@@ -1,15 +1,15 @@
+#pragma once
+
 #include "page.hpp"
 #include "pager.hpp"
 #include <cstdint>
 
 
-// --- TABLE LEVEL METADATA (Special 4-byte slot only used in Page 0) ---
-const uint32_t TABLE_TOTAL_COUNT_OFFSET = 4;  // Bytes 4, 5, 6, 7
-
-// --- SHARED HEADER (Starts after the Table Count) ---
+// --- SHARED HEADER ---
 const uint32_t NODE_TYPE_OFFSET = 0;          // Byte 0
 const uint32_t IS_ROOT_OFFSET = 1;            // Byte 1
-// (Bytes 2-3 are padding/unused)
+// (Bytes 2-7 are padding/unused. Packed leaves keep their key frame there,
+// see tree_layout.hpp.)
 
 const uint32_t PARENT_POINTER_OFFSET = 8;     // Bytes 8, 9, 10, 11
 const uint32_t KEY_COUNT_OFFSET = 12;         // Bytes 12, 13, 14, 15
@@ -18,15 +18,32 @@ const uint32_t KEY_COUNT_OFFSET = 12;         // Bytes 12, 13, 14, 15
 const uint32_t RIGHT_CHILD_OFFSET = 16;       // Bytes 16, 17, 18, 19 (Internal)
 const uint32_t NEXT_PAGE_OFFSET = 16;         // Bytes 16, 17, 18, 19 (Leaf)
 
+// --- WAL STAMP ---
+// Bytes 20-27 hold the page LSN (PAGE_LSN_OFFSET in page.hpp)
+
 // --- DATA START ---
-const uint32_t COMMON_HEADER_SIZE = 20;       // Total header length
-const uint32_t INTERNAL_NODE_CELLS_START = 20; 
-const uint32_t LEAF_NODE_CELLS_START = 20;
+const uint32_t COMMON_HEADER_SIZE = 28;       // Total header length
+const uint32_t INTERNAL_NODE_CELLS_START = 28; 
+const uint32_t LEAF_NODE_CELLS_START = 28;
+
+
+enum NodeType {
+    NODE_INTERNAL = 0,
+    NODE_LEAF = 1,
+    NODE_OVERFLOW = 2
+};
 
 
-struct SplitResult {
-    uint32_t split_key;
+// What a node split hands up to its parent: the divider key and the new
+// right sibling (new_page_id 0 means nothing split). at_right_edge marks a
+// split made by a key above every other in the tree: the old node was left
+// full and the sibling starts out (almost) empty, so the parent should
+// split the same way if it has to.
+template <typename Key>
+struct BasicSplitResult {
+    Key split_key;
     uint32_t new_page_id;
+    bool at_right_edge = false;
 };
 
 
@@ -49,6 +66,10 @@ class Node {
                 page->data[IS_ROOT_OFFSET] = is_root;
             }
 
+            bool is_root() const {
+                return (uint8_t) *(page->data + IS_ROOT_OFFSET) == 1;
+            };
+
             void set_key_count(uint32_t count) {
                 serialize_uint32(count, page->data + KEY_COUNT_OFFSET);
             }
@@ -0,0 +1,196 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__AVX2__) || defined(__SSE4_1__)
+#include <immintrin.h>
+#endif
+
+
+// Key search inside a single node.
+// Both entry points return the same thing as std::lower_bound /
+// std::upper_bound (an index into the sorted run), but narrow the range with
+// a branch-free binary search and finish the last few keys with one SIMD
+// compare-and-count instead of a data-dependent loop.
+
+// Binary search stops once this many candidates are left
+const uint32_t NODE_SEARCH_LINEAR_WINDOW = 16;
+
+
+// Counts how many of the first n keys are < key (n <= NODE_SEARCH_LINEAR_WINDOW)
+inline uint32_t count_keys_less(const uint32_t* keys, uint32_t n, uint32_t key) {
+    uint32_t count = 0;
+    uint32_t i = 0;
+
+#if defined(__AVX2__)
+    // No unsigned compare in AVX2: flip the sign bit and compare signed
+    const __m256i bias = _mm256_set1_epi32((int) 0x80000000);
+    const __m256i needle = _mm256_xor_si256(_mm256_set1_epi32((int) key), bias);
+    for (; i + 8 <= n; i += 8) {
+        __m256i block = _mm256_loadu_si256((const __m256i*) (keys + i));
+        block = _mm256_xor_si256(block, bias);
+        __m256i less = _mm256_cmpgt_epi32(needle, block);
+        count += __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(less)));
+    }
+#endif
+
+#if defined(__SSE4_1__)
+    const __m128i bias4 = _mm_set1_epi32((int) 0x80000000);
+    const __m128i needle4 = _mm_xor_si128(_mm_set1_epi32((int) key), bias4);
+    for (; i + 4 <= n; i += 4) {
+        __m128i block = _mm_loadu_si128((const __m128i*) (keys + i));
+        block = _mm_xor_si128(block, bias4);
+        __m128i less = _mm_cmpgt_epi32(needle4, block);
+        count += __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(less)));
+    }
+#endif
+
+    // Scalar fallback and tail
+    for (; i < n; i++) {
+        count += (keys[i] < key);
+    }
+    return count;
+}
+
+
+// First index whose key is >= key, over a contiguous sorted array
+inline uint32_t search_lower_bound(const uint32_t* keys, uint32_t n, uint32_t key) {
+    const uint32_t* base = keys;
+    uint32_t len = n;
+
+    // The answer always stays within [base, base + len]
+    while (len > NODE_SEARCH_LINEAR_WINDOW) {
+        uint32_t half = len / 2;
+        base = (base[half - 1] < key) ? base + half : base;
+        len -= half;
+    }
+
+    return (uint32_t) (base - keys) + count_keys_less(base, len, key);
+}
+
+
+// First index whose key is > key, over a contiguous sorted array
+inline uint32_t search_upper_bound(const uint32_t* keys, uint32_t n, uint32_t key) {
+    if (key == UINT32_MAX) return n;
+    return search_lower_bound(keys, n, key + 1);
+}
+
+
+// Same lower bound for keys embedded in fixed-size cells (leaf pages):
+// the keys are not contiguous, so there is no vector path, only the
+// branch-free narrowing and a branch-free final count
+inline uint32_t search_lower_bound_strided(const char* cells, uint32_t stride, uint32_t n, uint32_t key) {
+    auto key_at = [cells, stride](uint32_t idx) {
+        uint32_t value;
+        std::memcpy(&value, cells + ((size_t) idx * stride), sizeof(uint32_t));
+        return value;
+    };
+
+    uint32_t base = 0;
+    uint32_t len = n;
+
+    while (len > NODE_SEARCH_LINEAR_WINDOW) {
+        uint32_t half = len / 2;
+        base = (key_at(base + half - 1) < key) ? base + half : base;
+        len -= half;
+    }
+
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < len; i++) {
+        count += (key_at(base + i) < key);
+    }
+    return base + count;
+}
+
+
+// --- 64-bit keys ---
+
+// Counts how many of the first n keys are < key (n <= NODE_SEARCH_LINEAR_WINDOW)
+inline uint32_t count_keys_less(const uint64_t* keys, uint32_t n, uint64_t key) {
+    uint32_t count = 0;
+    uint32_t i = 0;
+
+#if defined(__AVX2__)
+    const __m256i bias = _mm256_set1_epi64x((long long) 0x8000000000000000ull);
+    const __m256i needle = _mm256_xor_si256(_mm256_set1_epi64x((long long) key), bias);
+    for (; i + 4 <= n; i += 4) {
+        __m256i block = _mm256_loadu_si256((const __m256i*) (keys + i));
+        block = _mm256_xor_si256(block, bias);
+        __m256i less = _mm256_cmpgt_epi64(needle, block);
+        count += __builtin_popcount(_mm256_movemask_pd(_mm256_castsi256_pd(less)));
+    }
+#endif
+
+    for (; i < n; i++) {
+        count += (keys[i] < key);
+    }
+    return count;
+}
+
+inline uint32_t search_lower_bound(const uint64_t* keys, uint32_t n, uint64_t key) {
+    const uint64_t* base = keys;
+    uint32_t len = n;
+
+    while (len > NODE_SEARCH_LINEAR_WINDOW) {
+        uint32_t half = len / 2;
+        base = (base[half - 1] < key) ? base + half : base;
+        len -= half;
+    }
+
+    return (uint32_t) (base - keys) + count_keys_less(base, len, key);
+}
+
+inline uint32_t search_upper_bound(const uint64_t* keys, uint32_t n, uint64_t key) {
+    if (key == UINT64_MAX) return n;
+    return search_lower_bound(keys, n, key + 1);
+}
+
+
+// --- Any other key type ---
+// Keys are Traits::SIZE bytes apart from each other (or stride bytes), read
+// through Traits::load and ordered by Traits::less, both inlined.
+
+template <typename Traits>
+inline uint32_t generic_lower_bound(const char* base, uint32_t stride, uint32_t n,
+                                    const typename Traits::Key& key) {
+    auto key_at = [base, stride](uint32_t idx) {
+        return Traits::load(base + ((size_t) idx * stride));
+    };
+
+    uint32_t first = 0;
+    uint32_t len = n;
+    while (len > NODE_SEARCH_LINEAR_WINDOW) {
+        uint32_t half = len / 2;
+        first = Traits::less(key_at(first + half - 1), key) ? first + half : first;
+        len -= half;
+    }
+
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < len; i++) {
+        count += Traits::less(key_at(first + i), key);
+    }
+    return first + count;
+}
+
+template <typename Traits>
+inline uint32_t generic_upper_bound(const char* base, uint32_t stride, uint32_t n,
+                                    const typename Traits::Key& key) {
+    auto key_at = [base, stride](uint32_t idx) {
+        return Traits::load(base + ((size_t) idx * stride));
+    };
+
+    uint32_t first = 0;
+    uint32_t len = n;
+    while (len > NODE_SEARCH_LINEAR_WINDOW) {
+        uint32_t half = len / 2;
+        first = !Traits::less(key, key_at(first + half - 1)) ? first + half : first;
+        len -= half;
+    }
+
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < len; i++) {
+        count += !Traits::less(key, key_at(first + i));
+    }
+    return first + count;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <algorithm>
+#include <functional>
+#include "node.hpp"
+
+// Values too large to sit inside a leaf are cut into a chain of overflow
+// pages: [Header][Payload...], linked through NEXT_PAGE_OFFSET and with
+// the payload length kept in the key count slot.
+const uint32_t OVERFLOW_PAGE_DATA_START = COMMON_HEADER_SIZE;
+const uint32_t OVERFLOW_PAGE_CAPACITY = PAGE_USABLE_SIZE - OVERFLOW_PAGE_DATA_START;
+
+
+class OverflowPage : public Node {
+    public:
+        OverflowPage(Page* p, uint32_t id): Node(p, id) {};
+
+        char* payload() { return page->data + OVERFLOW_PAGE_DATA_START; }
+
+        uint32_t get_payload_size() { return get_key_count(); }
+
+        uint32_t get_next_page() {
+            return deserialize_uint32(page->data + NEXT_PAGE_OFFSET);
+        }
+
+        void set_next_page(uint32_t page_id) {
+            serialize_uint32(page_id, page->data + NEXT_PAGE_OFFSET);
+        }
+};
+
+
+inline uint32_t overflow_chain_length(uint32_t value_size) {
+    return (value_size + OVERFLOW_PAGE_CAPACITY - 1) / OVERFLOW_PAGE_CAPACITY;
+}
+
+
+// Writes a value into overflow pages first_page_id, first_page_id + 1, ...
+// new_page(id) must return something dereferencing to a writable Page
+// that will be stored under that id (a PageHandle or a Page*).
+template <typename PageSource>
+void fill_overflow_chain(uint32_t first_page_id, const char* data, uint32_t size, PageSource&& new_page) {
+    uint32_t pages = overflow_chain_length(size);
+
+    for (uint32_t i = 0; i < pages; i++) {
+        uint32_t page_id = first_page_id + i;
+        auto&& holder = new_page(page_id);
+        Page& target = *holder;
+
+        std::memset(target.data, 0, PAGE_SIZE);
+        OverflowPage overflow(&target, page_id);
+        overflow.set_node_type(NODE_OVERFLOW);
+
+        uint32_t chunk = std::min(OVERFLOW_PAGE_CAPACITY, size - (i * OVERFLOW_PAGE_CAPACITY));
+        std::memcpy(overflow.payload(), data + ((size_t) i * OVERFLOW_PAGE_CAPACITY), chunk);
+        overflow.set_key_count(chunk);
+        overflow.set_next_page(i + 1 < pages ? page_id + 1 : 0);
+    }
+}
+
+
+// Hands the value to sink one page-sized chunk at a time. Latched shared
+// like any read (it is not a write, an open snapshot need not keep a copy).
+inline void stream_overflow_chain(Pager& pager, uint32_t first_page_id,
+                                  const std::function<void(const char*, uint32_t)>& sink) {
+    uint32_t page_id = first_page_id;
+    while (page_id != 0) {
+        auto page_handle = pager.read_page(page_id, LATCH_SHARED);
+        OverflowPage overflow(page_handle.get(), page_id);
+        sink(overflow.payload(), overflow.get_payload_size());
+        page_id = overflow.get_next_page();
+    }
+}
+
+
+// Hands every page of the chain back to the free list (the cell pointing
+// at it is already gone)
+inline void free_overflow_chain(Pager& pager, uint32_t first_page_id) {
+    uint32_t page_id = first_page_id;
+    while (page_id != 0) {
+        uint32_t next_page;
+        {
+            auto page_handle = pager.read_page(page_id, LATCH_EXCLUSIVE);
+            next_page = OverflowPage(page_handle.get(), page_id).get_next_page();
+        }
+        pager.free_page(page_id);
+        page_id = next_page;
+    }
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include "node_search.hpp"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+
+// Frame-of-reference key column of a packed leaf (LEAF_KEYS_PACKED in
+// tree_layout.hpp): each 32-bit key is stored as key - base in `width`
+// bits, back to back, key i at bit i * width. A width of 0 means every key
+// is the base; ranges too wide for PACKED_KEY_MAX_BITS are stored whole
+// (32 bits, byte aligned).
+//
+// Every key is read with one 4-byte load at the byte it starts in, so a
+// width up to 24 always fits a single load after the shift. The load may
+// run up to 3 bytes past the end of the column; a leaf's column always has
+// the cell content (or at least the page checksum) behind it.
+
+const uint32_t PACKED_KEY_MAX_BITS = 24;
+
+
+// Bits per key for keys spanning base .. base + range
+inline uint32_t packed_key_width(uint32_t range) {
+    uint32_t bits = range == 0 ? 0 : 32 - __builtin_clz(range);
+    return bits <= PACKED_KEY_MAX_BITS ? bits : 32;
+}
+
+inline uint32_t packed_key_bytes(uint32_t count, uint32_t width) {
+    return (uint32_t) (((uint64_t) count * width + 7) / 8);
+}
+
+inline uint32_t packed_key_mask(uint32_t width) {
+    return width >= 32 ? UINT32_MAX : (1u << width) - 1;
+}
+
+
+// The delta of key index (key - base)
+inline uint32_t packed_delta_at(const char* column, uint32_t width, uint32_t index) {
+    uint32_t bit = index * width;
+    uint32_t word;
+    std::memcpy(&word, column + (bit >> 3), sizeof(uint32_t));
+    return (word >> (bit & 7)) & packed_key_mask(width);
+}
+
+// Writes the delta of key index, leaving the bits around it alone
+inline void packed_store_delta(char* column, uint32_t width, uint32_t index, uint32_t delta) {
+    if (width == 0) return;
+    uint32_t bit = index * width;
+    uint32_t shift = bit & 7;
+    uint32_t mask = packed_key_mask(width);
+    uint32_t word;
+    std::memcpy(&word, column + (bit >> 3), sizeof(uint32_t));
+    word = (word & ~(mask << shift)) | ((delta & mask) << shift);
+    std::memcpy(column + (bit >> 3), &word, sizeof(uint32_t));
+}
+
+
+// Deltas of keys first .. first + count - 1 into out. Eight at a time with
+// AVX2: one gather fetches the word each key starts in, a variable shift
+// and a mask cut it out.
+inline void unpack_deltas(const char* column, uint32_t width, uint32_t first, uint32_t count, uint32_t* out) {
+    uint32_t i = 0;
+
+#if defined(__AVX2__)
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i widths = _mm256_set1_epi32((int) width);
+    const __m256i mask = _mm256_set1_epi32((int) packed_key_mask(width));
+    const __m256i seven = _mm256_set1_epi32(7);
+    for (; i + 8 <= count; i += 8) {
+        __m256i index = _mm256_add_epi32(_mm256_set1_epi32((int) (first + i)), lanes);
+        __m256i bit = _mm256_mullo_epi32(index, widths);
+        __m256i word = _mm256_i32gather_epi32((const int*) column, _mm256_srli_epi32(bit, 3), 1);
+        word = _mm256_srlv_epi32(word, _mm256_and_si256(bit, seven));
+        _mm256_storeu_si256((__m256i*) (out + i), _mm256_and_si256(word, mask));
+    }
+#endif
+
+    for (; i < count; i++) {
+        out[i] = packed_delta_at(column, width, first + i);
+    }
+}
+
+// Whole keys first .. first + count - 1 into out
+inline void unpack_keys(const char* column, uint32_t width, uint32_t base, uint32_t first, uint32_t count,
+                        uint32_t* out) {
+    unpack_deltas(column, width, first, count, out);
+    for (uint32_t i = 0; i < count; i++) {
+        out[i] += base;
+    }
+}
+
+// Keys (all >= base, within the width) into positions first, first + 1, ...
+inline void pack_keys(char* column, uint32_t width, uint32_t base, uint32_t first, uint32_t count,
+                      const uint32_t* keys) {
+    for (uint32_t i = 0; i < count; i++) {
+        packed_store_delta(column, width, first + i, keys[i] - base);
+    }
+}
+
+
+// First index whose key is >= key among the n keys of a column, like
+// search_lower_bound. Works on the deltas: keys below the base or past
+// the width are answered without looking, the binary search narrows down
+// with single loads and the last window is unpacked and counted with SIMD.
+inline uint32_t packed_lower_bound(const char* column, uint32_t width, uint32_t base, uint32_t n, uint32_t key) {
+    if (n == 0 || key <= base) return 0;
+    uint32_t delta = key - base;
+    if (width < 32 && delta > packed_key_mask(width)) return n;
+
+    uint32_t first = 0;
+    uint32_t len = n;
+    while (len > NODE_SEARCH_LINEAR_WINDOW) {
+        uint32_t half = len / 2;
+        first = (packed_delta_at(column, width, first + half - 1) < delta) ? first + half : first;
+        len -= half;
+    }
+
+    uint32_t window[NODE_SEARCH_LINEAR_WINDOW];
+    unpack_deltas(column, width, first, len, window);
+    return first + count_keys_less(window, len, delta);
+}
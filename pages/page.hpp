@@ -1,11 +1,33 @@
 #pragma once
 #include <vector>
 #include <cstdint>
+#include <cstring>
 
 
 const uint32_t PAGE_SIZE = 4096;
 
+// Every page carries the LSN of the last WAL record that wrote it
+// (Bytes 20-27, right after the node header in node.hpp)
+const uint32_t PAGE_LSN_OFFSET = 20;
 
-struct Page {
+// ... and a CRC32C of everything before it in its last four bytes
+// (checksum.hpp). Page formats keep their contents below PAGE_USABLE_SIZE.
+const uint32_t PAGE_CHECKSUM_OFFSET = PAGE_SIZE - 4;
+const uint32_t PAGE_USABLE_SIZE = PAGE_CHECKSUM_OFFSET;
+
+
+// Aligned so any Page can be the buffer of an O_DIRECT transfer
+struct alignas(PAGE_SIZE) Page {
     char data[PAGE_SIZE];
-};
\ No newline at end of file
+};
+
+
+inline uint64_t get_page_lsn(const Page& page) {
+    uint64_t lsn;
+    std::memcpy(&lsn, page.data + PAGE_LSN_OFFSET, sizeof(uint64_t));
+    return lsn;
+}
+
+inline void set_page_lsn(Page& page, uint64_t lsn) {
+    std::memcpy(page.data + PAGE_LSN_OFFSET, &lsn, sizeof(uint64_t));
+}
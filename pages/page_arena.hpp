@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "page.hpp"
+
+// Huge page size the arena aligns to (x86-64 and arm64 with 4KB base pages)
+const size_t HUGE_PAGE_BYTES = 2u << 20;
+
+// What the arena's memory ended up backed by
+enum ArenaBacking {
+    ARENA_SMALL_PAGES = 0,      // plain 4KB pages
+    ARENA_TRANSPARENT = 1,      // 4KB pages the kernel may fold into huge ones (THP)
+    ARENA_HUGETLB = 2           // huge pages reserved by the admin (vm.nr_hugepages)
+};
+
+
+// One block of memory holding every page of a buffer pool, mapped when the
+// pool is created and kept until it goes away. Pages are PAGE_SIZE aligned
+// (what O_DIRECT wants) and sit back to back, so frames never allocate.
+//
+// With huge_pages, a pool of 2 MB or more asks for explicit huge pages
+// first, then for transparent ones on a 2 MB aligned range: a 4 MB pool
+// costs the TLB two entries instead of a thousand. Either way the memory
+// is touched up front, so the pool's footprint is all there from the start
+// instead of growing as pages come in.
+class PageArena {
+    private:
+        char* memory = nullptr;
+        size_t length = 0;
+        ArenaBacking backing = ARENA_SMALL_PAGES;
+
+    public:
+        PageArena(uint32_t page_count, bool huge_pages);
+        ~PageArena();
+
+        PageArena(const PageArena&) = delete;
+        PageArena& operator=(const PageArena&) = delete;
+
+        Page* page(uint32_t index) const { return reinterpret_cast<Page*>(memory) + index; }
+
+        ArenaBacking get_backing() const { return backing; }
+        const char* get_backing_name() const;
+};
@@ -1,36 +1,415 @@
 #ifndef PAGER_HPP
 #define PAGER_HPP
 
-#include <fstream>
 #include <string>
 #include <memory>
+#include <vector>
+#include <unordered_map>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <functional>
 #include "page.hpp"
+#include "wal.hpp"
+#include "io_backend.hpp"
+#include "page_arena.hpp"
+#include "version_store.hpp"
+#include "checksum.hpp"
+#include "metrics.hpp"
 #include <cstdint>
 #include <cstring>
 
 
+// Number of 4KB frames the buffer pool keeps in memory (4 MB by default)
+const uint32_t DEFAULT_BUFFER_POOL_FRAMES = 1024;
+const uint32_t INVALID_PAGE_ID = UINT32_MAX;
+const uint32_t INVALID_FRAME = UINT32_MAX;
 
+// Adjacent dirty pages written back by one vectored request
+const uint32_t FLUSH_MAX_RUN_PAGES = 64;
+
+// Address space reserved for the file mapping up front. The mapping only
+// grows in place (pages already handed out must not move), so leave room.
+const uint64_t MAP_MIN_RESERVE_BYTES = 1ull << 30;
+
+// Adjacent pages read by one request of a scrub
+const uint32_t SCRUB_CHUNK_PAGES = 64;
+
+// A page on the free list is zeroed except for the next free page (0 ends
+// the list, page 0 is never free)
+const uint32_t FREE_PAGE_NEXT_OFFSET = 4;     // Bytes 4-7
+
+
+// How a PageHandle holds the page it pins
+enum PageLatch {
+    LATCH_NONE = 0,         // pinned only: the caller already owns the page some other way
+    LATCH_SHARED = 1,       // readers
+    LATCH_EXCLUSIVE = 2     // the one writer changing the page
+};
+
+
+// Where the checksum check of a page read ahead of time stands
+enum FrameCheck : uint8_t {
+    CHECK_DONE = 0,         // checked (or nothing to check)
+    CHECK_PENDING = 1,      // the first pin checks it
+    CHECK_RUNNING = 2       // being checked, other pins wait
+};
+
+
+// A slot in the buffer pool holding one cached page
+struct Frame {
+    Page* page = nullptr;                   // its slot in the pool's PageArena
+    uint32_t page_id = INVALID_PAGE_ID;     // only changes under the exclusive pool latch
+    std::atomic<uint32_t> pin_count{0};
+    std::atomic<bool> is_dirty{false};
+    std::atomic<bool> ref_bit{false};       // CLOCK "second chance" bit, set on every access
+    std::atomic<bool> in_write_set{false};  // dirtied since the last commit_write, not evictable
+    std::atomic<bool> loading{false};       // still being read from disk
+
+    // Mapped mode: the clean page read in place from the file mapping, and
+    // `page` is unused. Null once the page has been copied in to be changed.
+    std::atomic<Page*> view{nullptr};
+
+    // Checksum of the bytes as they are on disk, known once the page was
+    // checked on its way in or stamped on its way out. CHECKSUM_ON_READ
+    // compares it with a clean page before the frame is reused, if the page
+    // was ever handed out to someone who could write it.
+    uint32_t checksum = 0;
+    bool has_checksum = false;
+    std::atomic<bool> writable{false};
+    std::atomic<uint8_t> check{0};          // FrameCheck: read ahead, not checked yet
+
+    // Page latch: protects the page bytes, held through a PageHandle
+    std::shared_mutex latch;
+};
+
+
+class Pager;
+
+// RAII pin on a buffer pool frame. The page stays resident (and the
+// Page* stays valid) until the handle is destroyed or released, and the
+// page latch taken with it is held just as long.
+class PageHandle {
+    private:
+        Pager* pager = nullptr;
+        Frame* frame = nullptr;
+        PageLatch latch = LATCH_NONE;
+
+    public:
+        PageHandle() = default;
+        PageHandle(Pager* owner, Frame* f, PageLatch mode): pager(owner), frame(f), latch(mode) {};
+        ~PageHandle() { release(); }
+
+        PageHandle(const PageHandle&) = delete;
+        PageHandle& operator=(const PageHandle&) = delete;
+
+        PageHandle(PageHandle&& other) noexcept: pager(other.pager), frame(other.frame), latch(other.latch) {
+            other.pager = nullptr;
+            other.frame = nullptr;
+            other.latch = LATCH_NONE;
+        }
+
+        PageHandle& operator=(PageHandle&& other) noexcept {
+            if (this != &other) {
+                release();
+                pager = other.pager;
+                frame = other.frame;
+                latch = other.latch;
+                other.pager = nullptr;
+                other.frame = nullptr;
+                other.latch = LATCH_NONE;
+            }
+            return *this;
+        }
+
+        Page* get() const {
+            Page* view = frame->view.load(std::memory_order_acquire);
+            return view != nullptr ? view : frame->page;
+        }
+        Page* operator->() const { return get(); }
+        Page& operator*() const { return *get(); }
+        explicit operator bool() const { return frame != nullptr; }
+
+        uint32_t get_page_id() const { return frame->page_id; }
+
+        // Flag the page so it gets logged and written back before its frame is reused
+        void mark_dirty();
+
+        // Unlatch and unpin early (the handle becomes empty)
+        void release();
+};
+
+
+// Thread safety: read_page, mark_dirty, allocate_page(s), prefetch,
+// commit_write and sync may be called from any number of threads. The page
+// bytes themselves are protected by the latch each PageHandle takes.
+// flush_all and checkpoint may run next to readers but not next to a write
+// that has yet to commit; append_pages needs the pager to itself. Writers
+// hold begin_write and whoever needs them gone holds exclude_writers, so
+// that also holds with several tables in one file.
 class Pager {
     private:
-        std::fstream file_stream;
-        uint32_t file_length;
-        uint32_t num_pages;
-    
+        int fd = -1;
+        bool direct_io = false;     // fd was opened with O_DIRECT
+        std::unique_ptr<IoBackend> io;
+        std::atomic<uint64_t> file_length;
+        std::atomic<uint32_t> num_pages;
+
+        // Page images the WAL replayed when the file was opened
+        uint32_t recovered_pages = 0;
+        std::vector<uint32_t> replayed_page_ids;    // until set_checksums stamps them
+
+        // Off until the table knows its file format has room for them
+        ChecksumMode checksums = CHECKSUM_OFF;
+
+        // --- Free list ---
+        // Freed pages are chained through their own bytes, the head sits in
+        // a slot of the header page. A thread that changes the list keeps
+        // the header page latched until its commit_write, so the list and
+        // the tree change that freed or took the page are logged together.
+        uint32_t header_page_id = INVALID_PAGE_ID;
+        uint32_t free_list_head_offset = 0;
+        std::atomic<bool> free_list_empty{true};    // hint: skips the header latch when there is nothing to reuse
+
+        // Pages latched until their thread's next commit_write (the header
+        // page, a table's superblock), under write_set_mutex
+        std::unordered_map<std::thread::id, std::vector<PageHandle>> commit_holders;
+
+        // Every page change goes through the log before the data file
+        std::unique_ptr<Wal> wal;
+
+        // --- Checkpoints ---
+        // Held shared by each writer from its first change to its commit and
+        // exclusively by checkpoints, which must not truncate the log under
+        // a write in flight. Readers never touch it. A checkpoint waiting at
+        // the gate holds off new writers so it cannot starve.
+        std::mutex checkpoint_gate;
+        std::shared_mutex checkpoint_latch;
+
+        // What the tables sharing the file store before each checkpoint
+        std::mutex hooks_mutex;
+        std::vector<std::pair<const void*, std::function<void()>>> checkpoint_hooks;
+
+        // Page images open snapshots may still read (version_store.hpp)
+        VersionStore versions;
+
+        // Frames each thread dirtied since its own last commit_write, so one
+        // writer's group never picks up another writer's pages
+        std::mutex write_set_mutex;
+        std::unordered_map<std::thread::id, std::vector<uint32_t>> write_sets;
+
+        // --- Buffer pool ---
+        PageArena arena;
+        std::vector<Frame> frames;
+        std::unordered_map<uint32_t, uint32_t> page_table;  // page id -> frame index
+        uint32_t clock_hand = 0;
+
+        // Shared to look pages up, exclusive to map or evict them. Never
+        // held across a page latch or a read from disk.
+        std::shared_mutex pool_latch;
+
+        // --- File mapping (IoOptions::map_reads) ---
+        // Read only and shared, so it always shows what the pool last wrote.
+        // Pages past the end of the file are never viewed through it (SIGBUS).
+        char* mapping = nullptr;
+        std::atomic<uint64_t> mapping_length{0};
+        std::mutex mapping_mutex;
+
+        void map_file();
+
+        // The page inside the mapping, or null when it cannot be viewed
+        Page* map_view(uint32_t page_id);
+
+        // Copies a viewed page into its frame so it can be changed
+        void materialize(Frame* frame);
+
+        Frame* pin_frame(uint32_t page_id);
+        uint32_t find_victim_frame();
+
+        // False for pages past the end of the file (handed back blank)
+        bool read_page_from_disk(uint32_t page_id, Page& page);
+
+        // CHECKSUM_ON_READ: checks a page that just came in from disk
+        bool verify_loaded(Frame& frame);
+        // ... and a clean page about to be dropped from the pool, which must
+        // still be what was read (or last written)
+        void verify_evicted(Frame& frame);
+        // Takes a frame whose page failed its check out of the pool
+        void drop_frame(Frame& frame);
+
+        // The end of a buffer hit: waits for the load (and the check of a
+        // page read ahead) to finish
+        Frame* wait_for_page(Frame& frame, uint32_t page_id);
+        void check_prefetched(Frame& frame);
+        void write_page_to_disk(uint32_t page_id, const Page& page);
+
+        // Reads the (sorted, missing) pages into the pool in one batch
+        void load_pages(const std::vector<uint32_t>& page_ids);
+
+        // Writes pinned frames, sorted by page id, as vectored runs (and unpins them)
+        void write_frames(Frame* const* batch, size_t count);
+        void unpin_all(Frame* const* batch, size_t count);
+
+        void recover();
+
+        // Pops the free list (0 when it is empty)
+        uint32_t reuse_free_page();
+
+        friend class PageHandle;
+        void unpin(Frame* frame);
+        void track_write(Frame* frame);
+
     public:
-        Pager(const std::string& filename);
+        Pager(const std::string& filename, uint32_t pool_frames = DEFAULT_BUFFER_POOL_FRAMES,
+              const WalOptions& wal_options = WalOptions(),
+              const IoOptions& io_options = IoOptions());
         ~Pager();
 
         uint32_t get_num_pages() const { return num_pages; }
+        uint32_t get_pool_frames() const { return frames.size(); }
+        const char* get_io_backend_name() const { return mapping != nullptr ? "mmap" : io->name(); }
+        bool is_direct_io() const { return direct_io; }
+
+        // Stamps pages with checksums from now on (and checks them in
+        // CHECKSUM_ON_READ). Pages the log replayed at open went out without
+        // one; they are rewritten. Called once, before any other thread uses
+        // the pager.
+        void set_checksums(ChecksumMode mode);
+        ChecksumMode get_checksums() const { return checksums; }
+
+        // Reads every page of the data file straight from disk, spread over
+        // threads, and returns the ones whose checksum does not match. Only
+        // meaningful right after a checkpoint, with no writer around.
+        std::vector<uint32_t> scrub_file(uint32_t threads, uint64_t* pages_read = nullptr);
+
+        // Pages the calling thread dirtied since its last commit_write
+        // (they pin their frames)
+        uint32_t get_write_set_size();
 
+        // Id the next allocation would get; nothing is reserved (see allocate_pages)
         uint32_t get_unused_page_number();
-        // Returns a pointer to a page loaded from disk
-        std::unique_ptr<Page> read_page(uint32_t page_id);
 
-        // Writes a page from RAM back to the specific slot on disk
-        void write_page(uint32_t page_id, const Page& page);
+        // Whether opening the file had to replay the log (a crash since the
+        // last checkpoint): anything kept only in memory is out of date
+        bool recovered_from_log() const { return recovered_pages > 0; }
+
+        // Makes sure the next allocation comes after page_count - 1 (pages
+        // a superblock says exist even if the file ends earlier)
+        void reserve_pages(uint32_t page_count);
+
+        // Reserves count consecutive page ids and returns the first. Single
+        // pages come off the free list when it has any; runs always extend
+        // the file.
+        uint32_t allocate_pages(uint32_t count);
+        uint32_t allocate_page() { return allocate_pages(1); }
+
+        // Keeps the free list head in bytes [head_offset, head_offset + 4) of
+        // header_page_id from now on. Until then nothing is reused.
+        void attach_free_list(uint32_t header_page_id, uint32_t head_offset);
+
+        // The page, latched exclusively for the calling thread until its
+        // next commit_write (or left as is if it holds it already). Any
+        // change to it goes out with the rest of the thread's write set.
+        Page* latch_until_commit(uint32_t page_id);
+
+        // ... the header page that way
+        Page* latch_header_page() { return latch_until_commit(header_page_id); }
+
+        // Puts a page the tree cannot reach any more (open snapshots still
+        // may) on the free list, latching it while it is cleared. Latches
+        // the header page, so the caller must hold every tree latch it
+        // still needs before it commits.
+        void free_page(uint32_t page_id);
+
+        // Pins the page in the buffer pool, loading it from disk on a miss,
+        // then latches it in the given mode. In mapped mode a shared handle
+        // may point into the mapping; any other latch gets a private copy.
+        PageHandle read_page(uint32_t page_id, PageLatch latch = LATCH_NONE);
+
+        // Brings pages that are about to be needed into the pool. With an
+        // async backend the misses are read together (one vectored read per
+        // run of adjacent pages, all in flight at once); otherwise (and in
+        // mapped mode) it only hints the kernel and returns without waiting.
+        void prefetch(const std::vector<uint32_t>& page_ids);
+
+        // Marks an already pinned page as modified
+        void mark_dirty(uint32_t page_id);
+
+        // Writes brand new pages straight to the end of the file in one call,
+        // bypassing the pool and the WAL (stamping their checksums first).
+        // Returns the id of the first one. Not durable until the next
+        // checkpoint fsyncs the data file.
+        uint32_t append_pages(Page* pages, uint32_t count);
+
+        // Logs every page the calling thread dirtied since its last call as
+        // one atomic group, durable on return (with WalOptions::async_commit,
+        // after the next group commit fsync or an explicit sync). The caller
+        // keeps those pages latched until it returns.
+        void commit_write();
+
+        const WalOptions& get_wal_options() const { return wal->get_options(); }
+
+        // The log has grown enough that the next quiet moment should checkpoint
+        bool checkpoint_due();
+
+        // Held by a writer from its first change to its commit_write
+        std::shared_lock<std::shared_mutex> begin_write();
+
+        // Waits for every write in flight and holds off new ones: for a
+        // checkpoint, or work that writes around the pool
+        std::unique_lock<std::shared_mutex> exclude_writers();
+
+        // hook runs at the start of every checkpoint until it is removed
+        // (a table saving its counters to its superblock)
+        void add_checkpoint_hook(const void* owner, std::function<void()> hook);
+        void remove_checkpoint_hook(const void* owner);
+
+        // Opens a snapshot of everything committed so far and returns its
+        // LSN. From then on pages are copied aside before they change, until
+        // close_snapshot. Caller excludes writers.
+        uint64_t open_snapshot();
+        void close_snapshot(uint64_t lsn);
+
+        // Copies page_id as it was when the snapshot at lsn opened. Latches
+        // the page only for the copy (and not at all once it has changed).
+        // A page some writer pins without a latch (LATCH_NONE) must not be
+        // read this way meanwhile.
+        void read_snapshot_page(uint32_t page_id, uint64_t lsn, Page& out);
+
+        // Forces all committed groups to stable storage
+        void sync();
+
+        // Writes committed dirty pages from the pool back to their slot on
+        // disk, adjacent ones coalesced into vectored writes
+        void flush_all();
+
+        // Runs the checkpoint hooks, flushes the pool, fsyncs the data file
+        // and truncates the log (caller excludes writers)
+        void checkpoint();
 };
 
 
+inline void PageHandle::mark_dirty() {
+    frame->is_dirty = true;
+    pager->track_write(frame);
+}
+
+inline void PageHandle::release() {
+    if (frame != nullptr) {
+        if (latch == LATCH_SHARED) {
+            frame->latch.unlock_shared();
+        } else if (latch == LATCH_EXCLUSIVE) {
+            frame->latch.unlock();
+        }
+        latch = LATCH_NONE;
+        pager->unpin(frame);
+        frame = nullptr;
+        pager = nullptr;
+    }
+}
+
+
 // Writes a 32-bit integer into a specific spot in the page
 inline void serialize_uint32(uint32_t value, char* destination) {
     std::memcpy(destination, &value, sizeof(uint32_t));
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include "pager.hpp"
+
+// The value a lookup found, read in place. An inline value stays inside
+// its leaf, which the ref keeps pinned and latched shared (and the table's
+// tree latch shared, like a cursor) until it is destroyed or released:
+// no copy and no allocation per row. Values that are not in one piece in
+// a leaf (overflow chains, rows still in the memtable) are copied into
+// the ref instead.
+//
+//   if (RowRef row = table.find(key)) { send(row.value()); }
+//
+// While a ref is alive this thread must not modify the table.
+class RowRef {
+    private:
+        std::shared_lock<std::shared_mutex> tree_guard;
+        PageHandle leaf_handle;
+        const char* data = nullptr;
+        uint32_t size = 0;
+        std::string owned;
+        bool found = false;
+        bool is_owned = false;
+
+    public:
+        RowRef() = default;
+
+        // Points into a latched leaf
+        RowRef(std::shared_lock<std::shared_mutex> guard, PageHandle handle, const char* value, uint32_t value_size)
+            : tree_guard(std::move(guard)), leaf_handle(std::move(handle)), data(value), size(value_size),
+              found(true) {};
+
+        // Holds its own copy
+        explicit RowRef(std::string value): owned(std::move(value)), found(true), is_owned(true) {};
+
+        RowRef(RowRef&&) = default;
+        RowRef& operator=(RowRef&&) = default;
+
+        explicit operator bool() const { return found; }
+
+        // Valid until the ref is destroyed or released. A copied value is
+        // looked up on every call since moving the ref may move the string.
+        std::span<const char> value() const {
+            if (is_owned) return std::span<const char>(owned.data(), owned.size());
+            return std::span<const char>(data, size);
+        }
+        std::string_view value_view() const {
+            std::span<const char> bytes = value();
+            return std::string_view(bytes.data(), bytes.size());
+        }
+
+        // False when the value had to be copied
+        bool is_pinned() const { return found && !is_owned; }
+
+        // Unlatches and unpins the leaf early (the ref becomes empty)
+        void release() {
+            leaf_handle.release();
+            if (tree_guard.owns_lock()) tree_guard.unlock();
+            owned.clear();
+            data = nullptr;
+            size = 0;
+            found = false;
+            is_owned = false;
+        }
+};
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "pager.hpp"
+#include "leaf_node.hpp"
+#include "internal_node.hpp"
+#include "tree_layout.hpp"
+
+template <typename Layout>
+class BasicTable;
+
+template <typename Layout>
+class BasicSnapshotCursor;
+
+
+// The table as it was at one moment, for reads that take long: every page
+// is read as of the snapshot's LSN (Pager::read_snapshot_page), the
+// memtable is copied when it opens, and what writers did since stays
+// invisible. Readers keep nothing latched between pages, so writers carry
+// on next to them at the cost of copying each page they change once while
+// the snapshot is open (VersionStore).
+//
+//   Snapshot snapshot = table.snapshot();
+//   for (SnapshotCursor c = snapshot.scan(lo, hi); c.is_valid(); c.next()) { ... }
+//
+// Opening one waits for the writes in flight. The snapshot must outlive
+// its cursors; it can be used from several threads at once.
+template <typename Layout>
+class BasicSnapshot {
+    friend class BasicSnapshotCursor<Layout>;
+
+    public:
+        using KeyType = typename Layout::KeyType;
+        using Traits = typename Layout::Traits;
+        using LeafNode = BasicLeafNode<Layout>;
+        using InternalNode = BasicInternalNode<Layout>;
+        using Cursor = BasicSnapshotCursor<Layout>;
+
+    private:
+        BasicTable<Layout>* table;
+        Pager* pager;
+        uint64_t lsn;
+        uint32_t root_page_id;
+        uint32_t tree_height;
+
+        // The memtable's rows, in key order
+        std::vector<std::pair<KeyType, std::string>> buffered;
+
+        // page_id as of lsn, copied into out
+        void read_page(uint32_t page_id, Page& out);
+
+        // Copies the leaf key belongs in into out and returns its id; with
+        // leftmost, the first leaf that may hold key (see Table::descend)
+        uint32_t find_leaf(const KeyType& key, Page& out, bool leftmost = false);
+
+        // The whole value of a cell of a leaf copy, overflow pages included
+        void read_value(LeafNode& leaf, uint32_t cell, std::string& out);
+
+        // First buffered row at or after key
+        size_t buffered_lower_bound(const KeyType& key) const;
+
+    public:
+        explicit BasicSnapshot(BasicTable<Layout>* t);
+        ~BasicSnapshot();
+
+        BasicSnapshot(const BasicSnapshot&) = delete;
+        BasicSnapshot& operator=(const BasicSnapshot&) = delete;
+
+        // Everything committed up to this LSN is in the snapshot
+        uint64_t get_lsn() const { return lsn; }
+
+        bool find(const KeyType& key, std::string& value_out);
+
+        // Rows with lo <= key <= hi, buffered ones included
+        Cursor scan(const KeyType& lo, const KeyType& hi) { return Cursor(this, lo, hi); }
+};
+
+
+// Forward iterator over [lo, hi] of a snapshot. Works on a private copy of
+// one leaf at a time, so it holds no latch and no pin between calls.
+// Where a key is in both the tree and the memtable, the tree's rows come
+// first (as with a Cursor).
+template <typename Layout>
+class BasicSnapshotCursor {
+    public:
+        using KeyType = typename Layout::KeyType;
+        using Traits = typename Layout::Traits;
+        using LeafNode = BasicLeafNode<Layout>;
+
+    private:
+        BasicSnapshot<Layout>* snapshot;
+        std::unique_ptr<Page> leaf_page;    // the current leaf as of the snapshot
+        uint32_t leaf_id = 0;
+        uint32_t cell = 0;
+        KeyType high_key;
+        bool valid = false;
+        bool in_tree = false;               // leaf_page and cell point at a row in range
+
+        size_t buffered_pos;
+        bool from_buffer = false;           // the current row is the snapshot's buffered[buffered_pos]
+
+        void skip_exhausted_leaves();
+        void pick_row();
+
+        LeafNode current_leaf() { return LeafNode(leaf_page.get(), leaf_id); }
+
+        const std::pair<KeyType, std::string>& buffered_row() const {
+            return snapshot->buffered[buffered_pos];
+        }
+
+    public:
+        BasicSnapshotCursor(BasicSnapshot<Layout>* s, const KeyType& low_key, const KeyType& high);
+
+        BasicSnapshotCursor(BasicSnapshotCursor&&) = default;
+        BasicSnapshotCursor& operator=(BasicSnapshotCursor&&) = default;
+
+        bool is_valid() const { return valid; }
+
+        KeyType get_key() {
+            return from_buffer ? buffered_row().first : current_leaf().get_key(cell);
+        }
+
+        uint32_t get_value_size() {
+            return from_buffer ? buffered_row().second.size() : current_leaf().get_value_size(cell);
+        }
+
+        // Valid until the cursor moves. Only the inline bytes: large values
+        // need read_value.
+        const char* get_value() {
+            return from_buffer ? buffered_row().second.data() : current_leaf().get_value(cell);
+        }
+        bool value_is_inline() { return from_buffer || !current_leaf().is_overflow(cell); }
+
+        // Copies the whole value, following overflow pages as of the snapshot
+        void read_value(std::string& out) {
+            if (from_buffer) {
+                out = buffered_row().second;
+            } else {
+                LeafNode leaf = current_leaf();
+                snapshot->read_value(leaf, cell, out);
+            }
+        }
+
+        void next();
+};
+
+
+extern template class BasicSnapshot<DefaultLayout>;
+extern template class BasicSnapshot<Layout64>;
+extern template class BasicSnapshot<CompositeLayout>;
+extern template class BasicSnapshot<UuidLayout>;
+extern template class BasicSnapshot<NameLayout>;
+extern template class BasicSnapshot<PackedLayout>;
+
+extern template class BasicSnapshotCursor<DefaultLayout>;
+extern template class BasicSnapshotCursor<Layout64>;
+extern template class BasicSnapshotCursor<CompositeLayout>;
+extern template class BasicSnapshotCursor<UuidLayout>;
+extern template class BasicSnapshotCursor<NameLayout>;
+extern template class BasicSnapshotCursor<PackedLayout>;
+
+using Snapshot = BasicSnapshot<DefaultLayout>;
+using SnapshotCursor = BasicSnapshotCursor<DefaultLayout>;
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include "page.hpp"
+#include "pager.hpp"
+
+// Page 0 of every table file: where the tree starts and what it holds.
+// Only changes that must survive a crash together with the tree (a new
+// root) are logged with the pages they belong to; the row count and page
+// count are kept in memory and written back at each checkpoint.
+//
+// Files without a superblock (tree pages from page 0 on) are refused.
+//
+// Version 3 keeps the last four bytes of every page for its checksum.
+// Version 2 pages may use them for data, so those files are opened
+// without checksums.
+
+const uint32_t SUPERBLOCK_PAGE_ID = 0;
+const uint32_t SUPERBLOCK_MAGIC = 0x42445253;       // "SRDB"
+const uint32_t TABLE_FORMAT_VERSION = 3;
+const uint32_t CHECKSUM_FORMAT_VERSION = 3;         // the first one with page checksums
+
+// --- SUPERBLOCK LAYOUT ---
+const uint32_t SUPERBLOCK_MAGIC_OFFSET = 0;         // Bytes 0-3
+const uint32_t SUPERBLOCK_VERSION_OFFSET = 4;       // Bytes 4-7
+const uint32_t SUPERBLOCK_ROOT_OFFSET = 8;          // Bytes 8-11
+const uint32_t SUPERBLOCK_HEIGHT_OFFSET = 12;       // Bytes 12-15
+const uint32_t SUPERBLOCK_PAGE_COUNT_OFFSET = 16;   // Bytes 16-19
+// Bytes 20-27 hold the page LSN like on any other page
+const uint32_t SUPERBLOCK_FREE_LIST_OFFSET = 28;    // Bytes 28-31 (0 = no free pages, kept by the pager)
+const uint32_t SUPERBLOCK_ROW_COUNT_OFFSET = 32;    // Bytes 32-39
+const uint32_t SUPERBLOCK_KEY_SIZE_OFFSET = 40;     // Bytes 40-43 (catches opening with the wrong key type)
+const uint32_t SUPERBLOCK_FLAGS_OFFSET = 44;        // Bytes 44-47
+const uint32_t SUPERBLOCK_MEMTABLE_LSN_OFFSET = 48;     // Bytes 48-55 (last memtable flush, see below)
+const uint32_t SUPERBLOCK_MEMTABLE_ROWS_OFFSET = 56;    // Bytes 56-63
+const uint32_t SUPERBLOCK_LEAF_KEYS_OFFSET = 64;        // Bytes 64-67 (LeafKeyEncoding, 0 in older files)
+
+// A memtable flush goes into the tree in several WAL groups, each of which
+// also records how far it got: the last memtable log LSN the flush covers
+// and how many of its rows (in key order) are in the tree. A crash in the
+// middle leaves the memtable log to replay; the rows already flushed are
+// skipped. Both are zero in files that never had a memtable.
+
+// The row count was not exact when written: count the leaves on first use
+const uint32_t SUPERBLOCK_FLAG_ROW_COUNT_STALE = 1;
+
+
+class Superblock {
+    private:
+        Page* page;
+
+        uint64_t get_u64(uint32_t offset) const {
+            uint64_t value;
+            std::memcpy(&value, page->data + offset, sizeof(uint64_t));
+            return value;
+        }
+
+        void set_u64(uint32_t offset, uint64_t value) {
+            std::memcpy(page->data + offset, &value, sizeof(uint64_t));
+        }
+
+    public:
+        explicit Superblock(Page* p): page(p) {};
+
+        // Formats a blank superblock
+        void initialize(uint32_t key_size, uint32_t leaf_keys = 0) {
+            std::memset(page->data, 0, PAGE_SIZE);
+            serialize_uint32(SUPERBLOCK_MAGIC, page->data + SUPERBLOCK_MAGIC_OFFSET);
+            serialize_uint32(TABLE_FORMAT_VERSION, page->data + SUPERBLOCK_VERSION_OFFSET);
+            serialize_uint32(key_size, page->data + SUPERBLOCK_KEY_SIZE_OFFSET);
+            serialize_uint32(leaf_keys, page->data + SUPERBLOCK_LEAF_KEYS_OFFSET);
+        }
+
+        bool is_valid() const {
+            return deserialize_uint32(page->data + SUPERBLOCK_MAGIC_OFFSET) == SUPERBLOCK_MAGIC;
+        }
+
+        uint32_t get_format_version() const { return deserialize_uint32(page->data + SUPERBLOCK_VERSION_OFFSET); }
+        void set_format_version(uint32_t version) { serialize_uint32(version, page->data + SUPERBLOCK_VERSION_OFFSET); }
+        uint32_t get_key_size() const { return deserialize_uint32(page->data + SUPERBLOCK_KEY_SIZE_OFFSET); }
+        uint32_t get_leaf_keys() const { return deserialize_uint32(page->data + SUPERBLOCK_LEAF_KEYS_OFFSET); }
+
+        uint32_t get_root_page_id() const { return deserialize_uint32(page->data + SUPERBLOCK_ROOT_OFFSET); }
+        void set_root_page_id(uint32_t page_id) { serialize_uint32(page_id, page->data + SUPERBLOCK_ROOT_OFFSET); }
+
+        uint32_t get_tree_height() const { return deserialize_uint32(page->data + SUPERBLOCK_HEIGHT_OFFSET); }
+        void set_tree_height(uint32_t height) { serialize_uint32(height, page->data + SUPERBLOCK_HEIGHT_OFFSET); }
+
+        uint32_t get_page_count() const { return deserialize_uint32(page->data + SUPERBLOCK_PAGE_COUNT_OFFSET); }
+        void set_page_count(uint32_t count) { serialize_uint32(count, page->data + SUPERBLOCK_PAGE_COUNT_OFFSET); }
+
+        uint32_t get_free_list_head() const { return deserialize_uint32(page->data + SUPERBLOCK_FREE_LIST_OFFSET); }
+        void set_free_list_head(uint32_t page_id) { serialize_uint32(page_id, page->data + SUPERBLOCK_FREE_LIST_OFFSET); }
+
+        uint64_t get_row_count() const { return get_u64(SUPERBLOCK_ROW_COUNT_OFFSET); }
+        void set_row_count(uint64_t count) { set_u64(SUPERBLOCK_ROW_COUNT_OFFSET, count); }
+
+        uint32_t get_flags() const { return deserialize_uint32(page->data + SUPERBLOCK_FLAGS_OFFSET); }
+        void set_flags(uint32_t flags) { serialize_uint32(flags, page->data + SUPERBLOCK_FLAGS_OFFSET); }
+
+        uint64_t get_memtable_flush_lsn() const { return get_u64(SUPERBLOCK_MEMTABLE_LSN_OFFSET); }
+        uint64_t get_memtable_flushed_rows() const { return get_u64(SUPERBLOCK_MEMTABLE_ROWS_OFFSET); }
+        void set_memtable_flush(uint64_t lsn, uint64_t rows) {
+            set_u64(SUPERBLOCK_MEMTABLE_LSN_OFFSET, lsn);
+            set_u64(SUPERBLOCK_MEMTABLE_ROWS_OFFSET, rows);
+        }
+};
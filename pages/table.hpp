@@ -2,107 +2,995 @@
 
 #include <string>
 #include <memory>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <span>
+#include <string_view>
+#include <utility>
+#include <optional>
+#include <limits>
+#include <type_traits>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
 #include "pager.hpp"
 #include "leaf_node.hpp"
 #include "internal_node.hpp"
+#include "cursor.hpp"
+#include "snapshot.hpp"
+#include "tree_layout.hpp"
+#include "superblock.hpp"
+#include "memtable.hpp"
+#include "row_ref.hpp"
+#include "hash_index.hpp"
+#include "work_stealing.hpp"
 
+// Pages the bulk loader accumulates before each sequential write (1 MB)
+const uint32_t BULK_LOAD_BATCH_PAGES = 256;
+
+// A delete that leaves a node less than a third full merges it with a
+// sibling or borrows from one. (Half full would bounce a node sitting on
+// the boundary between a split and a merge.)
+const uint32_t LEAF_NODE_MIN_BYTES = LEAF_NODE_SPACE_FOR_CELLS / 3;
+
+// Inserts in a row that must land in the rightmost leaf before inserts stop
+// descending from the root and go to that leaf directly
+const uint32_t APPEND_STREAK_MIN = 8;
+
+// Memtable size at which buffered writes are flushed into the tree
+const uint64_t DEFAULT_MEMTABLE_BYTES = 8ull << 20;
+
+// Key range partitions a parallel scan aims for per thread: enough that
+// the workers can even out partitions of different sizes by stealing
+const uint32_t PARALLEL_SCAN_PARTITIONS_PER_THREAD = 8;
+
+
+// How a table is opened; the defaults give the plain B+tree
+struct TableOptions {
+    // Inserts are logged to a memtable and reach the leaves in large sorted
+    // batches (memtable.hpp). Random inserts get much cheaper; lookups and
+    // scans check the memtable as well.
+    bool buffered_writes = false;
+    uint64_t memtable_bytes = DEFAULT_MEMTABLE_BYTES;   // size that triggers a flush
+
+    // Writes return before their commit is fsynced, which happens in groups
+    // of commits: a crash may lose the last few (WalOptions::async_commit)
+    bool async_commit = false;
+
+    // Readers see clean pages through an mmap of the table file, with the
+    // OS page cache as their cache (IoOptions::map_reads)
+    bool map_reads = false;
+
+    // The table file bypasses the OS page cache (IoOptions::direct_io)
+    bool direct_io = false;
+
+    // Page checksums (checksum.hpp). Only files of format version 3 and
+    // later have room for them; older ones are opened without.
+    ChecksumMode checksums = CHECKSUM_ON_READ;
+
+    // Point lookups of hot keys go straight to their leaf through an
+    // adaptive hash index of this many slots (hash_index.hpp); 0 = none
+    uint32_t hash_index_slots = DEFAULT_HASH_INDEX_SLOTS;
+};
+
+
+// What Table::verify found
+struct VerifyReport {
+    bool checksums_checked = false;         // false for files without checksums
+    uint64_t pages_scrubbed = 0;            // read back from disk
+    std::vector<uint32_t> corrupt_pages;    // whose checksum did not match
+    uint64_t pages_walked = 0;              // reached from the root
+    uint64_t rows = 0;                      // in the leaves (buffered rows not included)
+    std::vector<std::string> tree_errors;   // broken invariants (only the first few)
+
+    bool ok() const { return corrupt_pages.empty() && tree_errors.empty(); }
+};
+
+// Broken invariants Table::verify writes down before it only counts them
+const size_t VERIFY_MAX_ERRORS = 100;
+
+
+// What Table::aggregate found for a field of type T stored at the same
+// offset in every value. Integers are summed in 64 bits, floats as double.
+template <typename T>
+struct ScanAggregate {
+    using Sum = std::conditional_t<std::is_floating_point_v<T>, double,
+                                   std::conditional_t<std::is_signed_v<T>, int64_t, uint64_t>>;
+
+    uint64_t rows = 0;      // in the range
+    uint64_t count = 0;     // whose value is long enough to hold the field
+    Sum sum = 0;
+    T min = std::numeric_limits<T>::max();
+    T max = std::numeric_limits<T>::lowest();
+
+    void add(T value) {
+        count++;
+        sum += value;
+        min = std::min(min, value);
+        max = std::max(max, value);
+    }
+
+    void merge(const ScanAggregate& other) {
+        rows += other.rows;
+        count += other.count;
+        sum += other.sum;
+        min = std::min(min, other.min);
+        max = std::max(max, other.max);
+    }
+
+    double mean() const { return count > 0 ? (double) sum / count : 0; }
+};
+
+
+// B+tree table over one file, or one of many tables sharing a database
+// file and its pager (database.hpp). Layout fixes the key type and every
+// page size that depends on it (tree_layout.hpp); the usual instantiations
+// are aliased at the bottom of this file.
+template <typename Layout>
+class BasicTable {
+    friend class BasicCursor<Layout>;
+    friend class BasicSnapshot<Layout>;
+
+    public:
+        using KeyType = typename Layout::KeyType;
+        using Traits = typename Layout::Traits;
+        using LeafNode = BasicLeafNode<Layout>;
+        using InternalNode = BasicInternalNode<Layout>;
+        using Cursor = BasicCursor<Layout>;
+        using Snapshot = BasicSnapshot<Layout>;
+        using SplitResult = BasicSplitResult<KeyType>;
+        using Row = std::pair<KeyType, std::string_view>;
+        using Memtable = BasicMemtable<Layout>;
+        using HashIndex = BasicHashIndex<Traits>;
 
-class Table {
     private:
         std::string table_name;
-        std::unique_ptr<Pager> pager;
+        std::shared_ptr<Pager> pager;
+        std::string memtable_log_name;      // empty: never buffered
+
+        // Page 0 in a file of its own, which also makes the table keeper of
+        // the free list, the checksum mode and the page count. Anywhere
+        // else in a shared file.
+        uint32_t superblock_page_id;
         uint32_t root_page_id;
+        std::atomic<uint32_t> tree_height{0};   // internal levels above the leaves (stats read it unlatched)
+
+        // Rows in the table, kept here and written to the superblock at
+        // each checkpoint. After a crash the persisted number may be behind;
+        // then the leaves are counted the first time somebody asks.
+        std::atomic<uint64_t> row_count{0};
+        std::atomic<bool> row_count_known{true};
+
+        // Sequential keys (sequence ids, timestamps) all land in the
+        // rightmost leaf. Its id is remembered along with how many inserts in
+        // a row went there; past APPEND_STREAK_MIN the descent is skipped.
+        // The id is only a hint, checked against the page once latched, but
+        // a page it names is never freed and reused behind its back: leaves
+        // are only freed by a rebalance, which forgets it.
+        std::atomic<uint32_t> append_leaf_id{INVALID_PAGE_ID};
+        std::atomic<uint32_t> append_streak{0};
+
+        // Held shared by every lookup, insert and open cursor, exclusively
+        // by work that reshapes the tree without latch crabbing
+        // (insert_batch, bulk_load, deletes that merge nodes)
+        std::shared_mutex tree_latch;
+
+        // Guards root_page_id and tree_height. Readers hold it until the
+        // root page is latched; an insert that may split the root holds it
+        // exclusively until it commits.
+        std::shared_mutex root_latch;
+
+        // Only with buffered writes (or to drain the log an earlier buffered
+        // session left behind). Guarded by memtable_latch, which is taken
+        // after tree_latch when both are needed: a flush holds the tree
+        // latch exclusively, then the memtable latch.
+        std::unique_ptr<Memtable> memtable;
+        uint64_t memtable_limit;
+        std::shared_mutex memtable_latch;
+
+        ChecksumMode checksum_mode;
+
+        // Leaves of recently found keys. Cleared under the exclusive tree
+        // latch whenever a merge frees a node.
+        HashIndex hash_index;
 
     public:
-        Table(const std::string& name): table_name(name), root_page_id(0) {
-            pager = std::make_unique<Pager>(name + ".db");
+        // What an insert that may split keeps latched until it commits: the
+        // root latch (only while the root itself may split) and the chain of
+        // ancestors a split can still reach, root side first
+        struct WritePath {
+            std::unique_lock<std::shared_mutex> root_guard;
+            std::vector<PageHandle> ancestors;
+        };
 
-            // If the database is brand new, initialize Page 0 as a Leaf Root
-            if (pager->get_num_pages() == 0) {
-                auto root_handle = pager->read_page(0);
-                
-                // Use LeafNode to format the blank page
-                LeafNode root_node(root_handle.get(), 0);
-                root_node.set_node_type(1); // 1 = Leaf
-                root_node.set_is_root(1);
-                root_node.set_key_count(0);
-                root_node.set_next_page(0); // No sibling yet
-                
-                // Initialize the global row count to 0
-                serialize_uint32(0, root_handle->data + TABLE_TOTAL_COUNT_OFFSET);
+        // A table in a file of its own, name + ".db"
+        BasicTable(const std::string& name, const TableOptions& options = TableOptions())
+            : BasicTable(std::make_shared<Pager>(name + ".db", DEFAULT_BUFFER_POOL_FRAMES,
+                                                 table_wal_options(options), table_io_options(options)),
+                         name, SUPERBLOCK_PAGE_ID, name + ".db.mem", options) {}
 
-                // Commit the "empty" root to disk
-                pager->write_page(0, *root_handle);
+        // A table whose superblock is at superblock_id in shared_pager's file
+        // (INVALID_PAGE_ID makes a new one, see get_superblock_page_id).
+        // The pager's own options win over the file-level ones in options
+        // (map_reads, direct_io); only the table at SUPERBLOCK_PAGE_ID sets
+        // the checksum mode. Buffered rows are logged to memtable_log.
+        BasicTable(std::shared_ptr<Pager> shared_pager, const std::string& name, uint32_t superblock_id,
+                   const std::string& memtable_log, const TableOptions& options = TableOptions())
+            : table_name(name), pager(std::move(shared_pager)), memtable_log_name(memtable_log),
+              superblock_page_id(superblock_id), root_page_id(0), memtable_limit(options.memtable_bytes),
+              checksum_mode(options.checksums), hash_index(options.hash_index_slots) {
+            // Brand new: superblock and an empty leaf root. Otherwise the
+            // superblock says where everything is, no page walk needed.
+            bool is_new = superblock_page_id == INVALID_PAGE_ID
+                          || (owns_file() && pager->get_num_pages() == 0);
+            if (is_new) {
+                format_file();
+            } else {
+                open_file();
             }
+            open_memtable(options.buffered_writes);
+            pager->add_checkpoint_hook(this, [this] { save_superblock(); });
+        }
+
+        // Buffered rows go into the tree and the counters into the
+        // superblock (the pager's final checkpoint writes it out)
+        ~BasicTable() {
+            pager->remove_checkpoint_hook(this);
+            flush_memtable();
+            std::shared_lock<std::shared_mutex> write_guard = pager->begin_write();
+            save_superblock();
         }
 
-        void process_internal_root_split(InternalNode parent, SplitResult internal_split);
+        // The high-level interface for the Database class.
+        // Values of any length are accepted; without a size the value is
+        // taken to be the old fixed 32 bytes. Safe to call from many threads.
+        void insert(const KeyType& key, const char* value, uint32_t value_size = LEAF_NODE_LEGACY_VALUE_SIZE) {
+            LatencyTimer timer(METRIC_INSERT_LATENCY);
+            if (memtable) {
+                // Buffered: logged and kept in memory until the next flush
+                bool full;
+                {
+                    std::unique_lock<std::shared_mutex> guard(memtable_latch);
+                    memtable->put(key, value, value_size);
+                    row_count.fetch_add(1);
+                    full = memtable->get_bytes() >= memtable_limit;
+                }
+                if (full) {
+                    flush_memtable(true);
+                }
+                return;
+            }
 
-        // The high-level interface for the Database class
-        void insert(uint32_t key, const char* value) {
-            // 1. Find the correct leaf where this key belongs
-            uint32_t leaf_id = find_leaf(root_page_id, key);
+            {
+                std::shared_lock<std::shared_mutex> tree_guard(tree_latch);
+                std::shared_lock<std::shared_mutex> write_guard = begin_write();
+                uint32_t cell_length = (value_size <= Layout::LEAF_NODE_MAX_INLINE_VALUE)
+                    ? value_size : LEAF_NODE_OVERFLOW_STUB_SIZE;
 
-            // 2. Load that leaf
-            auto page_handle = pager->read_page(leaf_id);
-            LeafNode leaf(page_handle.get(), leaf_id);
+                // 1. Optimistic descent: shared latches on the way down, only
+                // the leaf is latched exclusively. Most inserts fit right there.
+                // A run of appends skips even that and goes to the last leaf.
+                WritePath path;
+                PageHandle page_handle = latch_append_leaf(key);
+                if (!page_handle) {
+                    page_handle = find_leaf(key, LATCH_EXCLUSIVE);
+                }
 
-            // 3. Handle the insert/split logic
-            if (leaf.get_key_count() >= LEAF_NODE_MAX_CELLS) {
-                leaf.split_and_insert(key, value, *pager);
-            } else {
-                leaf.insert(key, value, *pager);
+                if (!LeafNode(page_handle.get(), page_handle.get_page_id()).has_room(cell_length, key)) {
+                    // 2. The leaf will split: descend again with exclusive
+                    // latches, keeping every ancestor the split can reach
+                    page_handle.release();
+                    page_handle = find_leaf_for_insert(key, cell_length, path);
+                }
+                uint32_t leaf_id = page_handle.get_page_id();
+                LeafNode leaf(page_handle.get(), leaf_id);
+                bool rightmost = leaf.get_next_page() == 0;
+
+                // 3. Handle the insert/split logic (the leaf splits when the cell
+                // does not fit)
+                SplitResult result = leaf.insert(key, value, value_size, *pager);
+                page_handle.mark_dirty();
+
+                // 4. Hand the new sibling to the parent (or grow a new root)
+                if (result.new_page_id != 0) {
+                    update_parent(path, leaf_id, result);
+                }
+
+                // 5. Every page touched above goes to the WAL as one unit; the
+                // latches are let go only after that
+                pager->commit_write();
+
+                // 6. Only now may appends go straight to a new sibling: until
+                // it is logged it sits unlatched in this thread's write set,
+                // and only the parent's latch keeps others out
+                track_appends(rightmost, result.new_page_id != 0 ? result.new_page_id : leaf_id);
             }
 
-            // 4. Update the global count in the header of Page 0
-            increment_total_count();
+            // 7. The row count lives in memory until the next checkpoint
+            row_count.fetch_add(1);
+
+            maybe_checkpoint();
         };
 
+        // Inserts many rows with one descent and one merge pass per target
+        // leaf, one row count update and one WAL group for the whole batch.
+        // Has the table to itself while it runs.
+        void insert_batch(std::span<const Row> rows);
+
+        // Removes key (and its overflow pages), returning whether it was
+        // there. Safe to call from many threads. A delete that would leave
+        // its leaf underfull has the table to itself while it merges or
+        // rebalances nodes, so not from a thread with a cursor open.
+        bool erase(const KeyType& key);
+
+        // Removes every key with lo <= key <= hi, one leaf at a time, and
+        // returns how many went. Has the table to itself while it runs
+        // (buffered rows are flushed to the tree first).
+        uint64_t erase_range(const KeyType& lo, const KeyType& hi);
+
+        // Point lookup: copies the value of key (overflow pages included)
+        bool find(const KeyType& key, std::string& value_out) {
+            RowRef row = find(key);
+            if (!row) return false;
+            value_out.assign(row.value().data(), row.value().size());
+            return true;
+        }
+
+        // Point lookup without the copy: the ref reads the value inside its
+        // leaf and keeps the leaf pinned until it goes (see row_ref.hpp)
+        RowRef find(const KeyType& key) {
+            LatencyTimer timer(METRIC_LOOKUP_LATENCY);
+            if (memtable) {
+                std::shared_lock<std::shared_mutex> guard(memtable_latch);
+                if (const std::string* value = memtable->find(key)) {
+                    return RowRef(*value);
+                }
+            }
+
+            std::shared_lock<std::shared_mutex> tree_guard(tree_latch);
+
+            // 1. A hot key: straight to the leaf the hash index remembers,
+            //    if the key is still in it
+            HashProbe probe = hash_index.probe(key);
+            PageHandle page_handle;
+            uint32_t cell = NO_CELL;
+            if (probe.leaf_id != INVALID_PAGE_ID) {
+                page_handle = pager->read_page(probe.leaf_id, LATCH_SHARED);
+                cell = find_row(page_handle, key);
+                metrics_count(cell != NO_CELL ? METRIC_HASH_INDEX_HITS : METRIC_HASH_INDEX_STALE);
+                if (cell == NO_CELL) {
+                    // (no leaf latch may be held into a descent)
+                    page_handle.release();
+                }
+            }
+            hash_index.record(probe, cell != NO_CELL);
+
+            // 2. The usual descent, which tells the index where the key is
+            if (!page_handle) {
+                page_handle = find_leaf(key, LATCH_SHARED);
+                cell = find_row(page_handle, key);
+                if (cell == NO_CELL) {
+                    return RowRef();
+                }
+                hash_index.remember(probe, page_handle.get_page_id());
+            }
 
-        uint32_t get_total_count() {
-            auto root_page = pager->read_page(0);
-            return deserialize_uint32(root_page->data + 4);
+            LeafNode leaf(page_handle.get(), page_handle.get_page_id());
+            if (leaf.is_overflow(cell)) {
+                std::string value;
+                leaf.read_value(cell, *pager, value);
+                return RowRef(std::move(value));
+            }
+            return RowRef(std::move(tree_guard), std::move(page_handle),
+                          leaf.get_value(cell), leaf.get_value_size(cell));
         }
 
-        void create_new_root(uint32_t left_child_id, uint32_t split_key, uint32_t right_child_id) {
-            auto root_handle = pager->read_page(0);
-            
-            // Format Page 0 as an Internal Node
-            InternalNode root(root_handle.get(), 0);
-            root.set_node_type(NODE_INTERNAL); // Internal
-            root.set_is_root(1);
-            root.set_key_count(1);
-            
-            // Set the pointers: [Child 0] [Key 0] [Right Child]
-            root.set_child(0, left_child_id);      // Points to original data
-            root.set_key(0, split_key);            // The divider key
-            root.set_right_child(right_child_id);  // Points to new sibling
-            
-            pager->write_page(0, *root_handle);
+        // Range scan over lo <= key <= hi in key order, buffered rows
+        // included. While it is open the cursor holds off insert_batch,
+        // bulk_load and memtable flushes, and this thread must not modify the
+        // table (other threads may).
+        Cursor scan(const KeyType& lo, const KeyType& hi, uint32_t readahead = DEFAULT_SCAN_READAHEAD) {
+            return Cursor(this, pager.get(), lo, hi, readahead);
         }
 
-        void update_parent(uint32_t parent_id, SplitResult result);
+        // A point-in-time view for reads that take long (snapshot.hpp). Its
+        // scans see none of the writes after it opened and hold nothing
+        // between rows, so writers (insert_batch and flushes included) are
+        // never kept waiting for more than a page copy. Opening one waits
+        // for the writes in flight, so not from a thread with a write open.
+        Snapshot snapshot() { return Snapshot(this); }
+
+        // Visits every row of [lo, hi] from several threads (0 = one per
+        // core). The range is cut at dividers taken from the upper internal
+        // levels into a few partitions per thread, each read by its own
+        // cursor (its own descent and walk along the leaf chain) and handed
+        // out by a WorkStealingPool. visitor(worker, key, value) is called
+        // from all the workers at once, worker being below the thread count,
+        // so per-worker state needs no lock. Keys come in order only within
+        // a partition, and the value is only good for the call. The visitor
+        // must not modify the table.
+        template <typename Visitor>
+        void parallel_scan(const KeyType& lo, const KeyType& hi, uint32_t threads, Visitor&& visitor);
+
+        // Count, sum, min and max over [lo, hi] of the T stored at
+        // field_offset in every value, as a parallel scan (values too short
+        // to hold the field only count as rows)
+        template <typename T>
+        ScanAggregate<T> aggregate(const KeyType& lo, const KeyType& hi, uint32_t field_offset, uint32_t threads = 0);
+
+        // Builds the whole tree bottom-up from (key, value) pairs sorted by
+        // key, where values are anything with data() and size(). Leaves are
+        // packed to fill_factor of their bytes, chained left to right, and
+        // every page is written sequentially in large batches around the
+        // buffer pool. The table must be empty.
+        template <typename Iterator>
+        void bulk_load(Iterator first, Iterator last, double fill_factor = 1.0);
+
+        // Makes every insert so far durable (only needed with async_commit,
+        // whose group commits do it periodically)
+        void sync() {
+            if (memtable) {
+                std::shared_lock<std::shared_mutex> guard(memtable_latch);
+                memtable->sync();
+            }
+            pager->sync();
+        }
+
+        // Merges every buffered row into the tree in one sorted pass (or
+        // only if the memtable is over its limit), then empties the memtable
+        // and its log. Nothing to do for an unbuffered table.
+        void flush_memtable(bool only_if_full = false);
+
+        // Writes all cached pages (and the superblock) to the table file and
+        // truncates the WAL. Waits for inserts in flight, lookups and scans
+        // carry on.
+        void checkpoint() {
+            std::unique_lock<std::shared_mutex> guard = pager->exclude_writers();
+            pager->checkpoint();
+        }
+
+
+        // Offline scrub: checkpoints, then reads every page of the file back
+        // from disk to check its checksum and walks the whole tree checking
+        // node types, key order and fences, both spread over threads (0 =
+        // one per core). Holds every writer off until it is done.
+        VerifyReport verify(uint32_t threads = 0);
+
+        // For tooling that wants the pool size or the I/O backend
+        Pager* get_pager() { return pager.get(); }
+
+        const std::string& get_name() const { return table_name; }
+
+        // Where the table starts in its file (what a database catalog keeps)
+        uint32_t get_superblock_page_id() const { return superblock_page_id; }
+
+        // Internal levels above the leaves (0 while the root is a leaf)
+        uint32_t get_tree_height() const { return tree_height; }
+
+        // Served from memory. Only right after crash recovery does the first
+        // call count the leaves (waiting for writers, so not with a cursor
+        // open on this thread).
+        uint64_t get_total_count() {
+            if (!row_count_known) {
+                count_rows();
+            }
+            return row_count;
+        }
+
+        void create_new_root(uint32_t left_child_id, const KeyType& split_key, uint32_t right_child_id);
+
+        // Propagates the split of split_page_id up the latched ancestors in
+        // path, growing a new root if it runs off the top
+        void update_parent(WritePath& path, uint32_t split_page_id, SplitResult result);
     
     private:
-        // Navigation logic: Start at root, follow pointer down to the leaf
-        uint32_t find_leaf(uint32_t page_id, uint32_t key) {
-            auto page_handle = pager->read_page(page_id);
+        void format_file();
+        void open_file();
+
+        // Opens the memtable log and replays it. Without buffered writes the
+        // memtable only lives long enough to flush what the log held.
+        void open_memtable(bool buffered);
+
+        // Rows of [lo, hi] still in the memtable, for a cursor that has the
+        // tree latch (so no flush can move them meanwhile)
+        std::vector<std::pair<KeyType, std::string>> copy_buffered(const KeyType& lo, const KeyType& hi) {
+            if (!memtable) return {};
+            std::shared_lock<std::shared_mutex> guard(memtable_latch);
+            return memtable->copy_range(lo, hi);
+        }
+
+        // Stores the in-memory counters in the superblock and logs it (a
+        // checkpoint hook)
+        void save_superblock();
+
+        bool owns_file() const { return superblock_page_id == SUPERBLOCK_PAGE_ID; }
+
+        static IoOptions table_io_options(const TableOptions& options) {
+            IoOptions io_options;
+            io_options.map_reads = options.map_reads;
+            io_options.direct_io = options.direct_io;
+            return io_options;
+        }
+
+        static WalOptions table_wal_options(const TableOptions& options) {
+            WalOptions wal_options;
+            wal_options.async_commit = options.async_commit;
+            return wal_options;
+        }
+
+        // Walks the leaf level once to get an exact row count
+        void count_rows();
+
+        // The cell holding key in a latched page, NO_CELL if the page is not
+        // a leaf or key is not in it
+        static constexpr uint32_t NO_CELL = UINT32_MAX;
+        static uint32_t find_row(PageHandle& page_handle, const KeyType& key) {
+            if (page_handle->data[NODE_TYPE_OFFSET] != NODE_LEAF) {
+                return NO_CELL;
+            }
+            LeafNode leaf(page_handle.get(), page_handle.get_page_id());
+            uint32_t cell = leaf.find_cell(key);
+            if (cell >= leaf.get_key_count() || !Traits::equal(leaf.get_key(cell), key)) {
+                return NO_CELL;
+            }
+            return cell;
+        }
+
+        // Up to partitions - 1 dividers strictly inside (lo, hi), in order,
+        // from the highest internal level that has enough of them. Only a
+        // hint: the tree may change as soon as the latches are let go.
+        std::vector<KeyType> partition_range(const KeyType& lo, const KeyType& hi, uint32_t partitions);
+
+        // Values may come as std::string, std::array, std::vector<char>, ...
+        template <typename V>
+        static std::string_view value_view(const V& value) {
+            return std::string_view(value.data(), value.size());
+        }
+
+        void flush_bulk_batch(std::vector<Page>& batch, uint32_t& next_page_id) {
+            pager->append_pages(batch.data(), batch.size());
+            next_page_id += batch.size();
+            batch.clear();
+        }
+
+        // Navigation logic: Start at root, follow pointer down with latch
+        // crabbing (each child is latched shared before its parent is let go)
+        // and stop levels_above_leaf levels above the leaves, returning that
+        // page latched in `latch`. Empty if the tree is not that tall.
+        // When a fence is given, it receives the smallest divider above key on
+        // the way down (empty if none): the leaf only covers keys below it.
+        // leftmost follows the first child that can hold key instead of the
+        // last one, for range starts (no fence then).
+        PageHandle descend(const KeyType& key, uint32_t levels_above_leaf, PageLatch latch,
+                           std::optional<KeyType>* upper_fence = nullptr, bool leftmost = false) {
+            if (upper_fence != nullptr) {
+                upper_fence->reset();
+            }
 
-            // if it is a leaf, we found our target
-            if (page_handle->data[NODE_TYPE_OFFSET] == 1) {
-                return page_id;
+            // The root may only change while nobody holds the root latch
+            std::shared_lock<std::shared_mutex> root_guard(root_latch);
+            uint32_t level = tree_height;
+            if (level < levels_above_leaf) {
+                return PageHandle();
             }
+            uint32_t page_id = root_page_id;
+            PageHandle page_handle = pager->read_page(page_id, level == levels_above_leaf ? latch : LATCH_SHARED);
+            root_guard.unlock();
 
-            // if it's internal, find which child to follow
-            InternalNode internal(page_handle.get(), page_id);
-            uint32_t child_id = internal.get_child_for_key(key);
-            return find_leaf(child_id, key);
+            while (level > levels_above_leaf) {
+                // if it's internal, find which child to follow
+                InternalNode internal(page_handle.get(), page_id);
+                uint32_t num_keys = internal.get_key_count();
+                uint32_t idx = leftmost ? internal.first_child_index_for_key(key) : internal.child_index_for_key(key);
+                if (upper_fence != nullptr && idx < num_keys) {
+                    KeyType divider = internal.get_key(idx);
+                    if (!upper_fence->has_value() || Traits::less(divider, **upper_fence)) {
+                        *upper_fence = divider;
+                    }
+                }
+                page_id = (idx < num_keys) ? internal.get_child(idx) : internal.get_right_child();
+                level--;
+
+                PageHandle child = pager->read_page(page_id, level == levels_above_leaf ? latch : LATCH_SHARED);
+                page_handle = std::move(child);
+            }
+            return page_handle;
+        }
+
+        PageHandle find_leaf(const KeyType& key, PageLatch latch, std::optional<KeyType>* upper_fence = nullptr) {
+            return descend(key, 0, latch, upper_fence);
+        }
+
+        // The first leaf that may hold key, where a scan from key starts
+        PageHandle find_first_leaf(const KeyType& key, PageLatch latch) {
+            return descend(key, 0, latch, nullptr, true);
+        }
+
+        // Pessimistic descent for an insert that may split: every page is
+        // latched exclusively, and whenever a node can take one more entry
+        // without splitting, everything above it (root latch included) is
+        // let go. Returns the leaf; path keeps the rest. A cell_length larger
+        // than a page treats the leaf as splitting no matter what.
+        PageHandle find_leaf_for_insert(const KeyType& key, uint32_t cell_length, WritePath& path) {
+            path.root_guard = std::unique_lock<std::shared_mutex>(root_latch);
+            uint32_t level = tree_height;
+            uint32_t page_id = root_page_id;
+
+            while (true) {
+                PageHandle page_handle = pager->read_page(page_id, LATCH_EXCLUSIVE);
+
+                bool safe;
+                if (level == 0) {
+                    LeafNode leaf(page_handle.get(), page_id);
+                    safe = cell_length <= LEAF_NODE_SPACE_FOR_CELLS && leaf.has_room(cell_length, key);
+                } else {
+                    InternalNode internal(page_handle.get(), page_id);
+                    safe = internal.get_key_count() < Layout::INTERNAL_NODE_MAX_CELLS;
+                }
+
+                // A split stops at this node, nothing above it can change
+                if (safe) {
+                    path.ancestors.clear();
+                    if (path.root_guard.owns_lock()) {
+                        path.root_guard.unlock();
+                    }
+                }
+
+                if (level == 0) {
+                    return page_handle;
+                }
+
+                InternalNode internal(page_handle.get(), page_id);
+                page_id = internal.get_child_for_key(key);
+                level--;
+
+                path.ancestors.push_back(std::move(page_handle));
+            }
         };
 
-        void increment_total_count() {
-            uint32_t count = get_total_count();
-            auto root_page = pager->read_page(0);
-            serialize_uint32(count + 1, root_page->data + TABLE_TOTAL_COUNT_OFFSET);
-            pager->write_page(0, *root_page);
+        // The rightmost leaf, latched exclusively, if inserts have been
+        // appending lately and key still belongs there (at or above its first
+        // key, and the leaf is still last). Empty otherwise.
+        PageHandle latch_append_leaf(const KeyType& key) {
+            if (append_streak.load(std::memory_order_relaxed) < APPEND_STREAK_MIN) {
+                return PageHandle();
+            }
+            // Pairs with the release in track_appends: the leaf was logged
+            // before its id got here
+            uint32_t leaf_id = append_leaf_id.load(std::memory_order_acquire);
+            if (leaf_id == INVALID_PAGE_ID) {
+                return PageHandle();
+            }
+
+            PageHandle page_handle = pager->read_page(leaf_id, LATCH_EXCLUSIVE);
+            LeafNode leaf(page_handle.get(), leaf_id);
+            if (leaf.get_node_type() != NODE_LEAF || leaf.get_next_page() != 0
+                || leaf.get_key_count() == 0 || Traits::less(key, leaf.get_key(0))) {
+                return PageHandle();
+            }
+            metrics_count(METRIC_APPEND_INSERTS);
+            return page_handle;
+        }
+
+        // Called after every insert with whether it went to the rightmost leaf
+        // and which leaf is rightmost now (the new sibling after a split).
+        // Only writes the shared counters when they change.
+        void track_appends(bool rightmost, uint32_t last_leaf_id) {
+            if (!rightmost) {
+                if (append_streak.load(std::memory_order_relaxed) != 0) {
+                    append_streak.store(0, std::memory_order_relaxed);
+                }
+                return;
+            }
+            if (append_leaf_id.load(std::memory_order_relaxed) != last_leaf_id) {
+                append_leaf_id.store(last_leaf_id, std::memory_order_release);
+            }
+            if (append_streak.load(std::memory_order_relaxed) < APPEND_STREAK_MIN) {
+                append_streak.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        std::shared_lock<std::shared_mutex> begin_write() {
+            return pager->begin_write();
+        }
+
+        // Called with no page latches held once the log has outgrown its
+        // limit (and not inside begin_write)
+        void maybe_checkpoint() {
+            if (!pager->checkpoint_due()) return;
+
+            std::unique_lock<std::shared_mutex> guard = pager->exclude_writers();
+            if (pager->checkpoint_due()) {
+                pager->checkpoint();
+            }
+        }
+
+        // Every page from the root down to a leaf, with the child taken at each
+        struct PinnedPath {
+            std::vector<PageHandle> ancestors;
+            std::vector<uint32_t> child_indexes;
         };
-};
\ No newline at end of file
+
+        // Descent for work that has the tree latch exclusively (insert_batch,
+        // deletes that rebalance): nobody else can reach a page, so pages are
+        // only pinned and the root latch is left alone. Returns the leaf.
+        // When a fence is given it works as in descend().
+        PageHandle find_leaf_pinned(const KeyType& key, PinnedPath& path, std::optional<KeyType>* upper_fence);
+
+        // Merges rows sorted by key into the leaves, committing in several
+        // groups if they are many. For a memtable flush (memtable_lsn set)
+        // each group also records its progress in the superblock, and the
+        // rows are not counted again. Needs the tree latch exclusively.
+        void merge_sorted(std::span<const Row> sorted, uint64_t memtable_lsn);
+
+        // Merges a sorted run of rows that all belong to one leaf
+        void merge_into_leaf(PageHandle page_handle, WritePath& path, const Row* rows, uint32_t row_count);
+
+        // Merges or refills node_handle (level levels above the leaves) from
+        // a sibling if it is underfull, then its parent, and so on up. Needs
+        // the tree latch exclusively.
+        void rebalance(PinnedPath& path, PageHandle node_handle, uint32_t level);
+
+        bool is_underfull(Page* page, uint32_t level) {
+            if (level == 0) {
+                return LeafNode(page, 0).get_used_bytes() < LEAF_NODE_MIN_BYTES;
+            }
+            return InternalNode(page, 0).get_key_count() < Layout::INTERNAL_NODE_MAX_CELLS / 3;
+        }
+
+        // Hands the root over to its only child once it has no key left
+        void collapse_root(PageHandle root_handle);
+};
+
+
+template <typename Layout>
+template <typename Visitor>
+void BasicTable<Layout>::parallel_scan(const KeyType& lo, const KeyType& hi, uint32_t threads, Visitor&& visitor) {
+    if (Traits::less(hi, lo)) return;
+    WorkStealingPool pool(threads);
+    std::vector<KeyType> bounds = partition_range(lo, hi, pool.get_threads() * PARALLEL_SCAN_PARTITIONS_PER_THREAD);
+
+    // Partition i reads [bounds[i - 1], bounds[i]]. Equal keys may sit on
+    // both sides of a divider: a scan starts at the first row equal to its
+    // low key and reads through every row equal to its high key, so the
+    // first partition gets all of lo and the others skip their start key,
+    // which the partition before them has read in full.
+    pool.run(bounds.size() + 1, [&](uint32_t worker, size_t part) {
+        const KeyType& start = part == 0 ? lo : bounds[part - 1];
+        const KeyType& end = part < bounds.size() ? bounds[part] : hi;
+
+        std::string large_value;
+        for (Cursor cursor = scan(start, end); cursor.is_valid(); cursor.next()) {
+            KeyType key = cursor.get_key();
+            if (part > 0 && Traits::equal(key, start)) {
+                continue;
+            }
+
+            std::string_view value;
+            if (cursor.value_is_inline()) {
+                value = std::string_view(cursor.get_value(), cursor.get_value_size());
+            } else {
+                cursor.read_value(large_value);
+                value = large_value;
+            }
+            visitor(worker, key, value);
+        }
+    });
+}
+
+
+template <typename Layout>
+template <typename T>
+ScanAggregate<T> BasicTable<Layout>::aggregate(const KeyType& lo, const KeyType& hi, uint32_t field_offset,
+                                               uint32_t threads) {
+    static_assert(std::is_arithmetic_v<T>, "aggregate needs a numeric field type");
+
+    // One partial result per worker, a cache line apart, merged at the end
+    struct alignas(64) Partial {
+        ScanAggregate<T> result;
+    };
+    std::vector<Partial> partials(WorkStealingPool(threads).get_threads());
+
+    parallel_scan(lo, hi, threads, [&](uint32_t worker, const KeyType&, std::string_view value) {
+        ScanAggregate<T>& partial = partials[worker].result;
+        partial.rows++;
+        if (value.size() >= (size_t) field_offset + sizeof(T)) {
+            T field;
+            std::memcpy(&field, value.data() + field_offset, sizeof(T));
+            partial.add(field);
+        }
+    });
+
+    ScanAggregate<T> total;
+    for (const Partial& partial : partials) {
+        total.merge(partial.result);
+    }
+    return total;
+}
+
+
+template <typename Layout>
+template <typename Iterator>
+void BasicTable<Layout>::bulk_load(Iterator first, Iterator last, double fill_factor) {
+    // Pages are written around the pool, nobody else may be in the tree
+    // (nor write anywhere in the file, it may hold other tables)
+    std::unique_lock<std::shared_mutex> tree_guard(tree_latch);
+    std::unique_lock<std::shared_mutex> writers_guard = pager->exclude_writers();
+
+    {
+        auto root_handle = pager->read_page(root_page_id);
+        std::shared_lock<std::shared_mutex> memtable_guard(memtable_latch);
+        if (tree_height != 0 || LeafNode(root_handle.get(), root_page_id).get_key_count() != 0
+            || (memtable && !memtable->empty())) {
+            throw std::logic_error("bulk_load requires an empty table");
+        }
+    }
+
+    fill_factor = std::clamp(fill_factor, 0.01, 1.0);
+    uint32_t leaf_capacity = LEAF_NODE_SPACE_FOR_CELLS * fill_factor;
+    uint32_t fanout = std::max<uint32_t>(3, Layout::INTERNAL_NODE_MAX_CELLS * fill_factor + 1);
+
+    // 1. Everything cached must be on disk before we write around the pool
+    pager->checkpoint();
+
+    std::vector<Page> batch;
+    batch.reserve(BULK_LOAD_BATCH_PAGES);
+    uint32_t next_page_id = pager->get_unused_page_number();
+
+    auto new_batch_page = [&batch]() -> Page* {
+        batch.emplace_back();
+        std::memset(batch.back().data, 0, PAGE_SIZE);
+        return &batch.back();
+    };
+
+    // (lowest key, page id) of every node on the level being built
+    std::vector<std::pair<KeyType, uint32_t>> level;
+    uint32_t height = 0;
+
+    // 2. Pack the leaves. The first one reuses the empty root leaf and goes
+    // through the pool at the very end, the rest (and any overflow chains)
+    // are appended in order. The leaf being filled is found by index since
+    // overflow pages may grow the batch underneath it.
+    Page first_leaf = {};
+    uint32_t first_leaf_id = root_page_id;
+    uint32_t leaf_index = UINT32_MAX;
+    uint32_t leaf_id = first_leaf_id;
+    uint32_t leaf_content = 0;
+    KeyType leaf_first_key{};
+    auto current_leaf = [&]() {
+        return LeafNode(leaf_index == UINT32_MAX ? &first_leaf : &batch[leaf_index], leaf_id);
+    };
+    current_leaf().initialize();
+    level.push_back({KeyType{}, first_leaf_id});
+
+    uint64_t rows_loaded = 0;
+    KeyType previous_key{};
+
+    for (; first != last; ++first) {
+        KeyType key = first->first;
+        std::string_view value = value_view(first->second);
+        if (rows_loaded > 0 && Traits::less(key, previous_key)) {
+            throw std::invalid_argument("bulk_load input is not sorted by key");
+        }
+
+        char stub[LEAF_NODE_OVERFLOW_STUB_SIZE];
+        const char* content = value.data();
+        uint16_t raw_length = value.size();
+        if (value.size() > Layout::LEAF_NODE_MAX_INLINE_VALUE) {
+            uint32_t first_overflow = next_page_id + batch.size();
+            fill_overflow_chain(first_overflow, value.data(), value.size(),
+                                [&new_batch_page](uint32_t) { return new_batch_page(); });
+            serialize_uint32(value.size(), stub);
+            serialize_uint32(first_overflow, stub + 4);
+            content = stub;
+            raw_length = LEAF_NODE_OVERFLOW_STUB_SIZE | LEAF_SLOT_OVERFLOW_FLAG;
+        }
+        uint32_t length = raw_length & ~LEAF_SLOT_OVERFLOW_FLAG;
+        uint32_t leaf_cells = current_leaf().get_key_count();
+
+        if (leaf_cells > 0
+            && LeafNode::cells_bytes(leaf_cells + 1, leaf_content + length, leaf_first_key, key) > leaf_capacity) {
+            uint32_t new_leaf_id = next_page_id + batch.size();
+            current_leaf().set_next_page(new_leaf_id);
+
+            if (batch.size() >= BULK_LOAD_BATCH_PAGES) {
+                flush_bulk_batch(batch, next_page_id);
+            }
+            new_batch_page();
+            leaf_index = batch.size() - 1;
+            leaf_id = new_leaf_id;
+            leaf_cells = 0;
+            leaf_content = 0;
+
+            current_leaf().initialize();
+            level.push_back({key, new_leaf_id});
+        }
+
+        if (leaf_cells == 0) {
+            leaf_first_key = key;
+        }
+        current_leaf().append_cell(key, content, raw_length);
+        leaf_content += length;
+
+        previous_key = key;
+        rows_loaded++;
+    }
+
+    // 3. Build each internal level from the one below in a single pass.
+    // Child i of a node holds keys < key i, so key i is the lowest key of
+    // child i + 1.
+    while (level.size() > 1) {
+        std::vector<std::pair<KeyType, uint32_t>> parents;
+        size_t i = 0;
+
+        while (i < level.size()) {
+            size_t take = std::min<size_t>(fanout, level.size() - i);
+            // Never leave a lone child for the last node of the level
+            if (level.size() - i - take == 1) {
+                take--;
+            }
+
+            if (batch.size() >= BULK_LOAD_BATCH_PAGES) {
+                flush_bulk_batch(batch, next_page_id);
+            }
+            uint32_t node_id = next_page_id + batch.size();
+
+            InternalNode node(new_batch_page(), node_id);
+            node.set_node_type(NODE_INTERNAL);
+            node.set_is_root(i == 0 && take == level.size());
+            node.set_key_count(take - 1);
+            for (size_t j = 0; j + 1 < take; j++) {
+                node.set_child(j, level[i + j].second);
+                node.set_key(j, level[i + j + 1].first);
+            }
+            node.set_right_child(level[i + take - 1].second);
+
+            parents.push_back({level[i].first, node_id});
+            i += take;
+        }
+
+        level.swap(parents);
+        height++;
+    }
+
+    flush_bulk_batch(batch, next_page_id);
+
+    // 4. The new pages must be durable before the superblock starts
+    // pointing at them
+    pager->checkpoint();
+
+    auto leaf_handle = pager->read_page(first_leaf_id);
+    std::memcpy(leaf_handle->data, first_leaf.data, PAGE_SIZE);
+    LeafNode(leaf_handle.get(), first_leaf_id).set_is_root(level[0].second == first_leaf_id);
+    leaf_handle.mark_dirty();
+    leaf_handle.release();
+
+    Superblock superblock(pager->latch_until_commit(superblock_page_id));
+    superblock.set_root_page_id(level[0].second);
+    superblock.set_tree_height(height);
+    pager->mark_dirty(superblock_page_id);
+    pager->commit_write();
+
+    this->root_page_id = level[0].second;
+    this->tree_height = height;
+    this->append_leaf_id = INVALID_PAGE_ID;
+    this->row_count = rows_loaded;
+    this->row_count_known = true;
+    pager->checkpoint();
+}
+
+
+extern template class BasicTable<DefaultLayout>;
+extern template class BasicTable<Layout64>;
+extern template class BasicTable<CompositeLayout>;
+extern template class BasicTable<UuidLayout>;
+extern template class BasicTable<NameLayout>;
+extern template class BasicTable<PackedLayout>;
+
+using Table = BasicTable<DefaultLayout>;               // uint32_t keys
+using Table64 = BasicTable<Layout64>;                  // uint64_t keys
+using CompositeTable = BasicTable<CompositeLayout>;    // (uint32_t, uint64_t) keys
+using UuidTable = BasicTable<UuidLayout>;              // 16-byte binary keys
+using NameTable = BasicTable<NameLayout>;              // names up to 64 bytes
+using PackedTable = BasicTable<PackedLayout>;          // uint32_t keys, bit-packed in the leaves
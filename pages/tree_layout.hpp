@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+#include "page.hpp"
+#include "node.hpp"
+#include "key_types.hpp"
+
+// --- SLOTTED LEAF LAYOUT ---
+// [Header][Content Start 2b][Fragmented 2b][Slot 0][Slot 1]...  free  ...[Cells]
+// The slot directory grows forward from byte 32, cell content grows back
+// from the page checksum. Each slot is [Key][Offset 2b][Length 2b], so
+// keys sit at a fixed stride for the search layer.
+const uint32_t LEAF_NODE_CONTENT_START_OFFSET = LEAF_NODE_CELLS_START;     // Bytes 28, 29
+const uint32_t LEAF_NODE_FRAGMENTED_OFFSET = LEAF_NODE_CELLS_START + 2;    // Bytes 30, 31
+const uint32_t LEAF_NODE_SLOTS_START = LEAF_NODE_CELLS_START + 4;
+const uint32_t LEAF_NODE_CONTENT_END = PAGE_USABLE_SIZE;
+const uint32_t LEAF_NODE_SPACE_FOR_CELLS = LEAF_NODE_CONTENT_END - LEAF_NODE_SLOTS_START;
+
+// Large values leave a stub of [Total Size 4b][First Overflow Page 4b]
+// in the leaf and flag the slot length
+const uint32_t LEAF_NODE_OVERFLOW_STUB_SIZE = 8;
+const uint16_t LEAF_SLOT_OVERFLOW_FLAG = 0x8000;
+
+// --- PACKED LEAF LAYOUT (LEAF_KEYS_PACKED) ---
+// [Header][Content Start 2b][Fragmented 2b][Slot 0]...[Slot n-1][Key column]  free  ...[Cells]
+// Slots are only [Offset 2b][Length 2b]; the keys move into a bit-packed
+// frame-of-reference column right behind them (packed_keys.hpp) whose
+// base and width sit in the unused header bytes 2-7.
+const uint32_t PACKED_LEAF_WIDTH_OFFSET = 2;      // Byte 2
+const uint32_t PACKED_LEAF_BASE_OFFSET = 4;       // Bytes 4-7
+const uint32_t PACKED_LEAF_SLOT_SIZE = 4;
+
+// How leaves store their keys
+enum LeafKeyEncoding {
+    LEAF_KEYS_INLINE = 0,       // in each slot, next to offset and length
+    LEAF_KEYS_PACKED = 1        // in a compressed column of their own (uint32_t keys only)
+};
+
+// Internal pages leave this much unused at the end, which keeps the
+// 4-byte key layout exactly where it has always been (500 cells) and the
+// page checksum clear of the children
+const uint32_t INTERNAL_NODE_RESERVED_BYTES = 64;
+
+
+// Everything about the page layout that depends on the key type, worked
+// out at compile time. Nodes, tables and cursors are instantiated per
+// layout, so the key width, the cell counts and the search routine are all
+// constants in the generated code.
+//
+// MaxInlineValue is the largest value kept inside the leaf; anything
+// bigger goes to an overflow chain. LeafKeys picks the leaf layout.
+template <typename Key, uint32_t MaxInlineValue = PAGE_SIZE / 4, LeafKeyEncoding LeafKeys = LEAF_KEYS_INLINE>
+struct TreeLayout {
+    using KeyType = Key;
+    using Traits = KeyTraits<Key>;
+
+    static constexpr uint32_t KEY_SIZE = Traits::SIZE;
+    static constexpr LeafKeyEncoding LEAF_KEYS = LeafKeys;
+
+    // Internal: [Header][Key 0..MAX-1][Child 0..MAX-1]
+    static constexpr uint32_t INTERNAL_NODE_MAX_CELLS =
+        (PAGE_SIZE - INTERNAL_NODE_CELLS_START - INTERNAL_NODE_RESERVED_BYTES) / (KEY_SIZE + 4);
+    static constexpr uint32_t INTERNAL_NODE_KEYS_START = INTERNAL_NODE_CELLS_START;
+    static constexpr uint32_t INTERNAL_NODE_CHILDREN_START =
+        INTERNAL_NODE_KEYS_START + (INTERNAL_NODE_MAX_CELLS * KEY_SIZE);
+
+    // Leaf: slots of [Key][Offset 2b][Length 2b]. What a packed leaf
+    // spends per key depends on its keys: SLOT_SIZE is the most it takes.
+    static constexpr uint32_t LEAF_NODE_SLOT_SIZE = KEY_SIZE + 4;
+    static constexpr uint32_t LEAF_NODE_MAX_CELLS =
+        LEAF_NODE_SPACE_FOR_CELLS / (LeafKeys == LEAF_KEYS_PACKED ? PACKED_LEAF_SLOT_SIZE : LEAF_NODE_SLOT_SIZE);
+    static constexpr uint32_t LEAF_NODE_MAX_INLINE_VALUE = MaxInlineValue;
+
+    static_assert(INTERNAL_NODE_MAX_CELLS >= 3, "key too wide for an internal page");
+    static_assert(INTERNAL_NODE_CHILDREN_START + INTERNAL_NODE_MAX_CELLS * 4 <= PAGE_USABLE_SIZE,
+                  "internal node runs into the page checksum");
+    static_assert(MaxInlineValue >= LEAF_NODE_OVERFLOW_STUB_SIZE, "inline limit smaller than an overflow stub");
+    static_assert(MaxInlineValue < LEAF_SLOT_OVERFLOW_FLAG, "inline limit collides with the overflow flag");
+    // A byte split has to leave both halves fitting in a page
+    static_assert(3 * (MaxInlineValue + LEAF_NODE_SLOT_SIZE) <= LEAF_NODE_SPACE_FOR_CELLS,
+                  "inline values too large for a leaf split");
+    static_assert(LeafKeys != LEAF_KEYS_PACKED || std::is_same_v<Key, uint32_t>,
+                  "packed leaves only hold uint32_t keys");
+};
+
+
+// The layout every table used before key types were configurable
+using DefaultLayout = TreeLayout<uint32_t>;
+
+// The other layouts compiled into the library (see the explicit
+// instantiations in src/table.cpp and src/cursor.cpp)
+using Layout64 = TreeLayout<uint64_t>;
+using CompositeLayout = TreeLayout<CompositeKey<uint32_t, uint64_t>>;
+using UuidLayout = TreeLayout<FixedBytesKey<16>>;
+
+// uint32_t keys in packed leaves: dense ids (sequences, timestamps) take
+// a byte or two per key instead of four
+using PackedLayout = TreeLayout<uint32_t, PAGE_SIZE / 4, LEAF_KEYS_PACKED>;
+
+// Names up to 64 bytes, zero padded (a database's catalog of tables)
+const uint32_t MAX_NAME_KEY_BYTES = 64;
+using NameLayout = TreeLayout<FixedBytesKey<MAX_NAME_KEY_BYTES>>;
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <unordered_map>
+#include <vector>
+#include "page.hpp"
+
+// Old page images kept for snapshot reads (MVCC through copy-on-write page
+// versions). A snapshot is the LSN of the last record logged when it
+// opened. While any snapshot is open, every page is copied aside the first
+// time a writer takes it after its last commit, before it can change, and
+// the copy is tagged with the LSN its change commits at (its "end"). The
+// page as of snapshot lsn is then the oldest copy whose end is past lsn,
+// or the page itself if there is none.
+//
+// A copy is dropped once no open snapshot falls into the span it covers,
+// and all of them go with the last snapshot.
+class VersionStore {
+    private:
+        static constexpr uint64_t UNCOMMITTED = UINT64_MAX;
+
+        struct Version {
+            uint64_t end = UNCOMMITTED;     // LSN of the change that replaced the image
+            std::unique_ptr<Page> image;
+        };
+
+        std::mutex mutex;
+        std::unordered_map<uint32_t, std::vector<Version>> chains;     // page id -> versions, oldest first
+        std::multiset<uint64_t> snapshots;
+        std::atomic<bool> active{false};    // snapshots is not empty
+
+        // Pages from here on were handed out after every open snapshot
+        // began, so none of them can reach them
+        uint32_t page_limit = 0;
+
+        // Drops the versions of one chain no snapshot reads any more
+        void prune(std::vector<Version>& chain);
+
+    public:
+        // Cheap check for read_page: nothing to keep while it is false
+        bool is_active() const { return active.load(std::memory_order_acquire); }
+
+        // A snapshot at lsn with page_count pages in the file. Nothing may
+        // be written between the lsn being taken and this call.
+        void open(uint64_t lsn, uint32_t page_count);
+        void close(uint64_t lsn);
+
+        // A writer took the page (still as last committed)
+        void preserve(uint32_t page_id, const Page& page);
+
+        // The writer's change to page_id was logged at lsn
+        void seal(uint32_t page_id, uint64_t lsn);
+
+        // Copies the page as of snapshot lsn into out, false if that is
+        // what the page holds now (as far as committed changes go)
+        bool find(uint32_t page_id, uint64_t lsn, Page& out);
+};
@@ -0,0 +1,104 @@
+#ifndef WAL_HPP
+#define WAL_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <utility>
+#include "page.hpp"
+
+
+// --- LOG FILE HEADER (first 16 bytes of the .wal file) ---
+const uint32_t WAL_MAGIC = 0x314C4157;        // "WAL1"
+const uint32_t WAL_FILE_HEADER_SIZE = 16;     // [magic 4][reserved 4][start LSN 8]
+
+enum WalRecordType : uint32_t {
+    WAL_PAGE_IMAGE = 1,     // payload is the full after-image of one page
+    WAL_COMMIT = 2,         // closes an atomic group of page images
+    WAL_LOGICAL = 3         // stands on its own, payload belongs to the caller (memtable rows)
+};
+
+// Largest WAL_LOGICAL payload recovery believes; anything bigger is a torn tail
+const uint32_t WAL_MAX_LOGICAL_RECORD = 1u << 30;
+
+struct WalRecordHeader {
+    uint64_t lsn;
+    uint32_t type;
+    uint32_t page_id;
+    uint32_t length;        // payload bytes following the header
+    uint32_t checksum;      // over the header (checksum = 0) and the payload
+};
+
+struct WalOptions {
+    // Commits return once buffered and are fsynced group_commit_size at a
+    // time, so a crash can lose the last few. Off: every commit waits for
+    // its fsync (shared with whoever commits at the same moment).
+    bool async_commit = false;
+    uint32_t group_commit_size = 64;            // commits batched into one fsync with async_commit
+    uint64_t checkpoint_bytes = 64ull << 20;    // log size that triggers a checkpoint
+};
+
+
+// Redo-only write-ahead log of full page images.
+// Pages dirtied by one logical operation are appended as a group and sealed
+// with a commit record; recovery replays only groups that were sealed.
+// The memtable keeps its rows in a log of its own made of WAL_LOGICAL
+// records instead (memtable.hpp).
+class Wal {
+    private:
+        int fd = -1;
+        WalOptions options;
+
+        uint64_t next_lsn;          // LSN handed to the next record
+        uint64_t durable_lsn;       // everything up to here is fsynced
+        uint64_t file_end;          // bytes already written to the log file
+
+        std::vector<char> buffer;   // records not yet written
+        uint64_t buffered_lsn = 0;  // last LSN sitting in the buffer
+        uint32_t pending_commits = 0;
+
+        // Group commit: one thread writes and fsyncs, the rest wait for it
+        std::mutex mutex;
+        std::condition_variable flushed;
+        bool flushing = false;
+
+        uint64_t append_record(uint32_t type, uint32_t page_id, const char* payload, uint32_t length);
+        void write_header(uint64_t start_lsn);
+
+    public:
+        Wal(const std::string& filename, const WalOptions& opts = WalOptions());
+        ~Wal();
+
+        // Stamps each page with its LSN, buffers the images and seals them
+        // with a commit record, all in one go so groups of concurrent writers
+        // never interleave. Returns once the group is durable (see
+        // WalOptions::async_commit).
+        uint64_t log_group(const std::vector<std::pair<uint32_t, Page*>>& pages);
+
+        // Appends one self-contained record and returns its LSN. Counts as a
+        // commit like log_group, and is as durable on return.
+        uint64_t log_record(const char* payload, uint32_t length);
+
+        // Blocks until every record up to lsn is on stable storage
+        void flush_to(uint64_t lsn);
+        void sync();
+
+        uint64_t size();
+
+        // LSN of the newest record handed out (every later one is larger)
+        uint64_t get_last_lsn();
+        const WalOptions& get_options() const { return options; }
+
+        // Replays every sealed group in log order, returns the pages applied.
+        // WAL_LOGICAL records go to apply_record (with their LSN) as they come.
+        uint32_t recover(const std::function<void(uint32_t, const Page&)>& apply,
+                         const std::function<void(uint64_t, const char*, uint32_t)>& apply_record = nullptr);
+
+        // Drops the log after a checkpoint, keeping the LSN sequence going
+        void reset();
+};
+
+#endif
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+// Runs tasks 0..n-1 on a few threads, for work split into more pieces than
+// there are threads (Table::parallel_scan hands it key range partitions).
+// Each worker starts with its own contiguous share of the tasks and takes
+// them from the front, so neighbouring partitions mostly stay on one
+// thread. A worker that runs dry steals the back half of the largest share
+// left, which evens out partitions that turn out larger or slower than
+// the rest.
+//
+//   WorkStealingPool pool(threads);
+//   pool.run(partitions.size(), [&](uint32_t worker, size_t task) { ... });
+//
+// Threads are started for each run and joined before it returns: the
+// pool is meant for work that runs for a while (whole-table scans), where
+// that does not show.
+class WorkStealingPool {
+    private:
+        uint32_t threads;
+
+    public:
+        // 0 = one per core
+        explicit WorkStealingPool(uint32_t thread_count = 0);
+
+        uint32_t get_threads() const { return threads; }
+
+        // Calls task(worker, index) once for every index below task_count,
+        // worker being the calling thread's number (below get_threads()).
+        // The calling thread is worker 0. Returns once every task is done;
+        // if a task throws, tasks not started yet are skipped and the first
+        // exception is rethrown here.
+        void run(size_t task_count, const std::function<void(uint32_t, size_t)>& task);
+};
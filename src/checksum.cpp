@@ -0,0 +1,185 @@
+#include "../pages/checksum.hpp"
+
+#if defined(__SSE4_2__)
+#include <nmmintrin.h>
+#endif
+
+
+// Reflected CRC32C polynomial
+static const uint32_t CRC32C_POLY = 0x82F63B78u;
+
+// table[k][b]: CRC of byte b followed by k zero bytes, so eight input
+// bytes are folded with eight lookups
+struct SlicingTables {
+    uint32_t table[8][256];
+
+    SlicingTables() {
+        for (uint32_t b = 0; b < 256; b++) {
+            uint32_t crc = b;
+            for (int bit = 0; bit < 8; bit++) {
+                crc = (crc >> 1) ^ (CRC32C_POLY & (0u - (crc & 1)));
+            }
+            table[0][b] = crc;
+        }
+        for (uint32_t b = 0; b < 256; b++) {
+            for (int k = 1; k < 8; k++) {
+                table[k][b] = (table[k - 1][b] >> 8) ^ table[0][table[k - 1][b] & 0xFF];
+            }
+        }
+    }
+};
+
+
+[[maybe_unused]] static uint32_t crc32c_slicing(const uint8_t* bytes, size_t length, uint32_t crc) {
+    static const SlicingTables tables;
+    const auto& t = tables.table;
+
+    while (length >= 8) {
+        uint64_t word;
+        std::memcpy(&word, bytes, sizeof(uint64_t));
+        word ^= crc;
+        crc = t[7][word & 0xFF] ^ t[6][(word >> 8) & 0xFF] ^ t[5][(word >> 16) & 0xFF]
+            ^ t[4][(word >> 24) & 0xFF] ^ t[3][(word >> 32) & 0xFF] ^ t[2][(word >> 40) & 0xFF]
+            ^ t[1][(word >> 48) & 0xFF] ^ t[0][word >> 56];
+        bytes += 8;
+        length -= 8;
+    }
+    while (length > 0) {
+        crc = (crc >> 8) ^ t[0][(crc ^ *bytes) & 0xFF];
+        bytes++;
+        length--;
+    }
+    return crc;
+}
+
+
+#if defined(__SSE4_2__)
+// The crc32 instruction takes 3 cycles but starts one per cycle, so three
+// independent streams over neighbouring blocks keep it busy; the block CRCs
+// are then combined by "appending" BLOCK zero bytes to the earlier one.
+// 3 x 1344 bytes is one pass over a page checksum's 4092.
+static const size_t CRC32C_BLOCK = 1344;
+
+// Multiplies the 32x32 GF(2) matrix mat by vec
+static uint32_t gf2_matrix_times(const uint32_t* mat, uint32_t vec) {
+    uint32_t sum = 0;
+    while (vec != 0) {
+        if (vec & 1) sum ^= *mat;
+        vec >>= 1;
+        mat++;
+    }
+    return sum;
+}
+
+static void gf2_matrix_square(uint32_t* square, const uint32_t* mat) {
+    for (int n = 0; n < 32; n++) {
+        square[n] = gf2_matrix_times(mat, mat[n]);
+    }
+}
+
+// zeros[k][b]: what byte k of a CRC turns into after length zero bytes
+struct ShiftTables {
+    uint32_t zeros[4][256];
+
+    explicit ShiftTables(size_t length) {
+        // Operator for one zero bit, squared into the one for a zero byte
+        uint32_t power[32];
+        uint32_t scratch[32];
+        power[0] = CRC32C_POLY;
+        for (int n = 1; n < 32; n++) {
+            power[n] = 1u << (n - 1);
+        }
+        for (int i = 0; i < 3; i++) {
+            gf2_matrix_square(scratch, power);
+            std::memcpy(power, scratch, sizeof(power));
+        }
+
+        // Square and multiply over the bits of length
+        uint32_t op[32];
+        for (int n = 0; n < 32; n++) {
+            op[n] = 1u << n;
+        }
+        while (length != 0) {
+            if (length & 1) {
+                for (int n = 0; n < 32; n++) {
+                    scratch[n] = gf2_matrix_times(power, op[n]);
+                }
+                std::memcpy(op, scratch, sizeof(op));
+            }
+            length >>= 1;
+            gf2_matrix_square(scratch, power);
+            std::memcpy(power, scratch, sizeof(power));
+        }
+
+        for (uint32_t b = 0; b < 256; b++) {
+            for (int k = 0; k < 4; k++) {
+                zeros[k][b] = gf2_matrix_times(op, b << (8 * k));
+            }
+        }
+    }
+
+    uint32_t shift(uint32_t crc) const {
+        return zeros[0][crc & 0xFF] ^ zeros[1][(crc >> 8) & 0xFF]
+             ^ zeros[2][(crc >> 16) & 0xFF] ^ zeros[3][crc >> 24];
+    }
+};
+
+static uint32_t crc32c_hardware(const uint8_t* bytes, size_t length, uint32_t crc) {
+    static const ShiftTables block_shift(CRC32C_BLOCK);
+
+    uint64_t crc0 = crc;
+    while (length >= 3 * CRC32C_BLOCK) {
+        uint64_t crc1 = 0;
+        uint64_t crc2 = 0;
+        for (size_t i = 0; i < CRC32C_BLOCK; i += 8) {
+            uint64_t w0, w1, w2;
+            std::memcpy(&w0, bytes + i, sizeof(uint64_t));
+            std::memcpy(&w1, bytes + CRC32C_BLOCK + i, sizeof(uint64_t));
+            std::memcpy(&w2, bytes + 2 * CRC32C_BLOCK + i, sizeof(uint64_t));
+            crc0 = _mm_crc32_u64(crc0, w0);
+            crc1 = _mm_crc32_u64(crc1, w1);
+            crc2 = _mm_crc32_u64(crc2, w2);
+        }
+        crc0 = block_shift.shift((uint32_t) crc0) ^ crc1;
+        crc0 = block_shift.shift((uint32_t) crc0) ^ crc2;
+        bytes += 3 * CRC32C_BLOCK;
+        length -= 3 * CRC32C_BLOCK;
+    }
+
+    while (length >= 8) {
+        uint64_t word;
+        std::memcpy(&word, bytes, sizeof(uint64_t));
+        crc0 = _mm_crc32_u64(crc0, word);
+        bytes += 8;
+        length -= 8;
+    }
+    uint32_t crc32 = (uint32_t) crc0;
+    while (length > 0) {
+        crc32 = _mm_crc32_u8(crc32, *bytes);
+        bytes++;
+        length--;
+    }
+    return crc32;
+}
+#endif
+
+
+uint32_t crc32c(const void* data, size_t length, uint32_t crc) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    crc = ~crc;
+#if defined(__SSE4_2__)
+    crc = crc32c_hardware(bytes, length, crc);
+#else
+    crc = crc32c_slicing(bytes, length, crc);
+#endif
+    return ~crc;
+}
+
+
+const char* crc32c_implementation() {
+#if defined(__SSE4_2__)
+    return "sse4.2";
+#else
+    return "slicing-by-8";
+#endif
+}
@@ -0,0 +1,133 @@
+#include "pages/cursor.hpp"
+#include "pages/table.hpp"
+
+
+template <typename Layout>
+BasicCursor<Layout>::BasicCursor(BasicTable<Layout>* t, Pager* p, const KeyType& low_key, const KeyType& high,
+                                 uint32_t readahead)
+    : table(t), pager(p), tree_guard(t->tree_latch), high_key(high), last_key(low_key),
+      readahead_pages(readahead) {
+    // No flush can move rows into the tree while the tree latch is held
+    buffered = table->copy_buffered(low_key, high);
+
+    // First window: the leaves right after the one low_key lands on. Rows
+    // equal to low_key may start leaves before the one a lookup picks.
+    if (readahead_pages > 0) {
+        issue_readahead(low_key, true);
+    }
+    leaf_handle = table->find_first_leaf(low_key, LATCH_SHARED);
+    cell = current_leaf().find_cell(low_key);
+    in_tree = true;
+    skip_exhausted_leaves();
+    pick_row();
+}
+
+
+template <typename Layout>
+void BasicCursor<Layout>::next() {
+    if (!valid) return;
+    if (from_buffer) {
+        buffered_pos++;
+    } else {
+        cell++;
+        skip_exhausted_leaves();
+    }
+    pick_row();
+}
+
+
+// The smaller of the next tree row and the next buffered row
+template <typename Layout>
+void BasicCursor<Layout>::pick_row() {
+    bool buffer_left = buffered_pos < buffered.size();
+    from_buffer = buffer_left
+                  && (!in_tree || Traits::less(buffered[buffered_pos].first, current_leaf().get_key(cell)));
+    valid = in_tree || buffer_left;
+}
+
+
+// Moves past leaves with no cells left and checks the upper bound
+template <typename Layout>
+void BasicCursor<Layout>::skip_exhausted_leaves() {
+    while (cell >= current_leaf().get_key_count()) {
+        LeafNode leaf = current_leaf();
+        if (leaf.get_key_count() > 0) {
+            last_key = leaf.get_key(leaf.get_key_count() - 1);
+        }
+        uint32_t next_page = leaf.get_next_page();
+        if (next_page == 0) {
+            finish();
+            return;
+        }
+        load_leaf(next_page);
+    }
+
+    if (Traits::less(high_key, current_leaf().get_key(cell))) {
+        finish();
+    }
+}
+
+
+// Once past the tree's rows the cursor holds nothing, checkpoints need not
+// wait for it to go
+template <typename Layout>
+void BasicCursor<Layout>::finish() {
+    in_tree = false;
+    leaf_handle.release();
+    if (tree_guard.owns_lock()) {
+        tree_guard.unlock();
+    }
+}
+
+
+// Only pages right of the current one get latched from here on, and only
+// after the current one is let go. A split meanwhile only moves keys
+// further right, so nothing can be skipped.
+template <typename Layout>
+void BasicCursor<Layout>::load_leaf(uint32_t page_id) {
+    leaf_handle.release();
+
+    // Refill the window once half of it has been consumed
+    leaves_since_hint++;
+    if (readahead_pages > 0 && leaves_since_hint > leaves_hinted / 2) {
+        issue_readahead(last_key);
+    }
+
+    leaf_handle = pager->read_page(page_id, LATCH_SHARED);
+    cell = 0;
+}
+
+
+// The parent of the leaf holding key lists the leaves that come after it,
+// so ask for those instead of guessing from page numbers. Runs with no
+// leaf latched, the descent goes top-down like any other.
+template <typename Layout>
+void BasicCursor<Layout>::issue_readahead(const KeyType& key, bool leftmost) {
+    leaves_since_hint = 0;
+    leaves_hinted = 0;
+
+    PageHandle parent_handle = table->descend(key, 1, LATCH_SHARED, nullptr, leftmost);
+    if (!parent_handle) return;
+
+    BasicInternalNode<Layout> parent(parent_handle.get(), parent_handle.get_page_id());
+    uint32_t num_keys = parent.get_key_count();
+    uint32_t idx = leftmost ? parent.first_child_index_for_key(key) : parent.child_index_for_key(key);
+
+    std::vector<uint32_t> upcoming;
+    for (uint32_t i = idx + 1; i <= num_keys && upcoming.size() < readahead_pages; i++) {
+        upcoming.push_back(i < num_keys ? parent.get_child(i) : parent.get_right_child());
+    }
+
+    // The batch may wait on the disk, splits of the parent need not
+    parent_handle.release();
+    pager->prefetch(upcoming);
+    leaves_hinted = upcoming.size();
+}
+
+
+template class BasicCursor<DefaultLayout>;
+template class BasicCursor<Layout64>;
+template class BasicCursor<CompositeLayout>;
+template class BasicCursor<UuidLayout>;
+template class BasicCursor<NameLayout>;
+template class BasicCursor<PackedLayout>;
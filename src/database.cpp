@@ -0,0 +1,96 @@
+#include "../pages/database.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+
+Database::Database(const std::string& path, const DatabaseOptions& options): path(path), options(options) {
+    IoOptions io_options;
+    io_options.map_reads = options.table_options.map_reads;
+    io_options.direct_io = options.table_options.direct_io;
+    WalOptions wal_options;
+    wal_options.async_commit = options.table_options.async_commit;
+    uint32_t pool_frames = std::max<uint64_t>(MIN_DATABASE_POOL_FRAMES, options.memory_limit_bytes / PAGE_SIZE);
+    pager = std::make_shared<Pager>(path, pool_frames, wal_options, io_options);
+
+    // The catalog owns page 0 (and with it the free list). It is small and
+    // read once per table open: no memtable, no hash index.
+    TableOptions catalog_options;
+    catalog_options.checksums = options.table_options.checksums;
+    catalog_options.hash_index_slots = 0;
+    catalog = std::make_unique<NameTable>(pager, path + " catalog", SUPERBLOCK_PAGE_ID, "", catalog_options);
+}
+
+
+Database::CatalogKey Database::catalog_key(const std::string& table_name) {
+    if (table_name.empty() || table_name.size() > MAX_NAME_KEY_BYTES
+        || table_name.find('\0') != std::string::npos) {
+        throw std::runtime_error("Database: bad table name '" + table_name + "' (1 to "
+                                 + std::to_string(MAX_NAME_KEY_BYTES) + " bytes, no zero bytes)");
+    }
+    CatalogKey key;
+    std::memcpy(key.bytes.data(), table_name.data(), table_name.size());
+    return key;
+}
+
+
+Table* Database::get_table(const std::string& table_name) {
+    std::lock_guard<std::mutex> guard(tables_mutex);
+    auto it = open_tables.find(table_name);
+    if (it != open_tables.end()) {
+        return it->second.get();
+    }
+
+    // 1. A known table starts at the superblock the catalog names
+    CatalogKey key = catalog_key(table_name);
+    uint32_t superblock_id = INVALID_PAGE_ID;
+    std::string value;
+    if (catalog->find(key, value)) {
+        std::memcpy(&superblock_id, value.data(), sizeof(uint32_t));
+    }
+
+    auto table = std::make_unique<Table>(pager, table_name, superblock_id, path + "." + table_name + ".mem",
+                                         options.table_options);
+
+    // 2. A new one was just formatted and only has to be written down. A
+    //    crash in between leaves its two pages unreachable, nothing worse.
+    if (superblock_id == INVALID_PAGE_ID) {
+        superblock_id = table->get_superblock_page_id();
+        catalog->insert(key, reinterpret_cast<const char*>(&superblock_id), sizeof(uint32_t));
+        catalog->sync();
+    }
+
+    Table* result = table.get();
+    open_tables[table_name] = std::move(table);
+    return result;
+}
+
+
+std::vector<std::string> Database::list_tables() {
+    CatalogKey lo;
+    CatalogKey hi;
+    hi.bytes.fill(0xFF);
+
+    std::vector<std::string> names;
+    for (auto cursor = catalog->scan(lo, hi); cursor.is_valid(); cursor.next()) {
+        CatalogKey key = cursor.get_key();
+        auto end = std::find(key.bytes.begin(), key.bytes.end(), 0);
+        names.emplace_back(key.bytes.begin(), end);
+    }
+    return names;
+}
+
+
+DatabaseStats Database::stats() {
+    DatabaseStats result;
+    result.engine = metrics_snapshot();
+    result.file_pages = pager->get_num_pages();
+    result.pool_frames = pager->get_pool_frames();
+
+    std::lock_guard<std::mutex> guard(tables_mutex);
+    for (auto& entry : open_tables) {
+        Table& table = *entry.second;
+        result.tables.push_back({ entry.first, table.get_tree_height(), table.get_total_count() });
+    }
+    return result;
+}
@@ -0,0 +1,271 @@
+#include "../pages/io_backend.hpp"
+#include "../pages/metrics.hpp"
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#include <stdexcept>
+#include <algorithm>
+#include <climits>
+#include <unistd.h>
+
+#if defined(RDBMS_HAVE_IO_URING)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+
+int64_t IoBackend::read(uint64_t offset, char* buffer, uint32_t length) {
+    return ::pread(fd, buffer, length, offset);
+}
+
+
+int64_t IoBackend::write(uint64_t offset, const char* buffer, uint32_t length) {
+    return ::pwrite(fd, buffer, length, offset);
+}
+
+
+int64_t IoBackend::transfer_sync(int fd, IoRequest& request, uint64_t already_done) {
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < request.iov_count; i++) {
+        total += request.iov[i].iov_len;
+    }
+
+    std::vector<struct iovec> remaining;
+    uint64_t done = already_done;
+
+    while (done < total) {
+        // Skip the buffers (and the part of one) that already went through
+        uint64_t skip = done;
+        size_t first = 0;
+        while (skip >= request.iov[first].iov_len) {
+            skip -= request.iov[first].iov_len;
+            first++;
+        }
+        remaining.assign(request.iov + first, request.iov + request.iov_count);
+        remaining[0].iov_base = (char*) remaining[0].iov_base + skip;
+        remaining[0].iov_len -= skip;
+
+        int count = std::min<size_t>(remaining.size(), IOV_MAX);
+        ssize_t moved = (request.op == IO_READ)
+            ? ::preadv(fd, remaining.data(), count, request.offset + done)
+            : ::pwritev(fd, remaining.data(), count, request.offset + done);
+
+        if (moved < 0) {
+            if (errno == EINTR) continue;
+            return -errno;
+        }
+        if (moved == 0) break;      // reading past the end of the file
+        done += moved;
+    }
+    return done;
+}
+
+
+void PosixIoBackend::submit_batch(std::vector<IoRequest>& requests) {
+    for (IoRequest& request : requests) {
+        request.result = transfer_sync(fd, request);
+    }
+}
+
+
+#if defined(RDBMS_HAVE_IO_URING)
+
+UringIoBackend::UringIoBackend(int file, uint32_t depth): IoBackend(file) {
+    struct io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+
+    ring_fd = (int) ::syscall(__NR_io_uring_setup, std::max<uint32_t>(depth, 1), &params);
+    if (ring_fd < 0) {
+        return;
+    }
+
+    // 1. Map the submission and completion rings (one mapping on newer kernels)
+    sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap) {
+        sq_ring_size = cq_ring_size = std::max(sq_ring_size, cq_ring_size);
+    }
+
+    sq_ring = ::mmap(nullptr, sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                     ring_fd, IORING_OFF_SQ_RING);
+    if (sq_ring == MAP_FAILED) {
+        sq_ring = nullptr;
+        close_ring();
+        return;
+    }
+
+    if (single_mmap) {
+        cq_ring = sq_ring;
+    } else {
+        cq_ring = ::mmap(nullptr, cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         ring_fd, IORING_OFF_CQ_RING);
+        if (cq_ring == MAP_FAILED) {
+            cq_ring = nullptr;
+            close_ring();
+            return;
+        }
+    }
+
+    // 2. Map the submission entries themselves
+    sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    void* sqe_area = ::mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                            ring_fd, IORING_OFF_SQES);
+    if (sqe_area == MAP_FAILED) {
+        close_ring();
+        return;
+    }
+    sqes = (struct io_uring_sqe*) sqe_area;
+
+    // 3. Locate the ring fields inside the mappings
+    char* sq = (char*) sq_ring;
+    sq_head = (unsigned*) (sq + params.sq_off.head);
+    sq_tail = (unsigned*) (sq + params.sq_off.tail);
+    sq_mask = (unsigned*) (sq + params.sq_off.ring_mask);
+    sq_array = (unsigned*) (sq + params.sq_off.array);
+
+    char* cq = (char*) cq_ring;
+    cq_head = (unsigned*) (cq + params.cq_off.head);
+    cq_tail = (unsigned*) (cq + params.cq_off.tail);
+    cq_mask = (unsigned*) (cq + params.cq_off.ring_mask);
+    cqes = (struct io_uring_cqe*) (cq + params.cq_off.cqes);
+
+    // The completion ring is at least as large, so it can never overflow
+    queue_depth = params.sq_entries;
+}
+
+
+UringIoBackend::~UringIoBackend() {
+    close_ring();
+}
+
+
+void UringIoBackend::close_ring() {
+    if (sqes != nullptr) {
+        ::munmap(sqes, sqes_size);
+        sqes = nullptr;
+    }
+    if (cq_ring != nullptr && cq_ring != sq_ring) {
+        ::munmap(cq_ring, cq_ring_size);
+    }
+    cq_ring = nullptr;
+    if (sq_ring != nullptr) {
+        ::munmap(sq_ring, sq_ring_size);
+        sq_ring = nullptr;
+    }
+    if (ring_fd >= 0) {
+        ::close(ring_fd);
+        ring_fd = -1;
+    }
+}
+
+
+// Keeps up to queue_depth requests in flight: refills the submission ring
+// as completions come back, so one system call both submits the new
+// entries and waits for the next completion.
+void UringIoBackend::submit_batch(std::vector<IoRequest>& requests) {
+    std::lock_guard<std::mutex> guard(ring_mutex);
+
+    size_t next = 0;
+    size_t completed = 0;
+    uint32_t in_flight = 0;
+    uint32_t unsubmitted = 0;
+
+    while (completed < requests.size()) {
+        // 1. Fill free submission slots (we are the only producer)
+        unsigned tail = *sq_tail;
+        unsigned mask = *sq_mask;
+        while (next < requests.size() && in_flight < queue_depth) {
+            IoRequest& request = requests[next];
+            unsigned idx = tail & mask;
+
+            struct io_uring_sqe* sqe = &sqes[idx];
+            std::memset(sqe, 0, sizeof(*sqe));
+            sqe->opcode = (request.op == IO_READ) ? IORING_OP_READV : IORING_OP_WRITEV;
+            sqe->fd = fd;
+            sqe->addr = (uint64_t) request.iov;
+            sqe->len = request.iov_count;
+            sqe->off = request.offset;
+            sqe->user_data = next;
+
+            sq_array[idx] = idx;
+            tail++;
+            next++;
+            in_flight++;
+            unsubmitted++;
+        }
+        __atomic_store_n(sq_tail, tail, __ATOMIC_RELEASE);
+
+        // 2. Submit whatever is queued and wait for at least one completion
+        int submitted = (int) ::syscall(__NR_io_uring_enter, ring_fd, unsubmitted, 1,
+                                        IORING_ENTER_GETEVENTS, nullptr, 0);
+        if (submitted < 0) {
+            if (errno == EINTR || errno == EAGAIN || errno == EBUSY) continue;
+            throw std::runtime_error("io_uring: io_uring_enter failed: " + std::string(std::strerror(errno)));
+        }
+        unsubmitted -= std::min<uint32_t>(submitted, unsubmitted);
+
+        // 3. Reap every completion that is ready
+        unsigned head = *cq_head;
+        unsigned ready = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+        while (head != ready) {
+            struct io_uring_cqe* cqe = &cqes[head & *cq_mask];
+            requests[cqe->user_data].result = cqe->res;
+            head++;
+            completed++;
+            in_flight--;
+        }
+        __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+    }
+
+    // 4. The ring does not retry short or interrupted transfers, so finish those inline
+    for (IoRequest& request : requests) {
+        if (request.result == -EINTR || request.result == -EAGAIN) {
+            request.result = transfer_sync(fd, request);
+            continue;
+        }
+        if (request.result < 0) continue;
+
+        uint64_t total = 0;
+        for (uint32_t i = 0; i < request.iov_count; i++) {
+            total += request.iov[i].iov_len;
+        }
+        if ((uint64_t) request.result < total) {
+            request.result = transfer_sync(fd, request, request.result);
+        }
+    }
+}
+
+#endif
+
+
+int sync_file(int fd, bool data_only) {
+    LatencyTimer timer(METRIC_FSYNC_LATENCY);
+    metrics_count(METRIC_FSYNCS);
+    return data_only ? ::fdatasync(fd) : ::fsync(fd);
+}
+
+
+std::unique_ptr<IoBackend> make_io_backend(int fd, const IoOptions& options) {
+    if (options.backend == IO_BACKEND_POSIX) {
+        return std::make_unique<PosixIoBackend>(fd);
+    }
+
+#if defined(RDBMS_HAVE_IO_URING)
+    auto uring = std::make_unique<UringIoBackend>(fd, options.queue_depth);
+    if (uring->is_ready()) {
+        return uring;
+    }
+    if (options.backend == IO_BACKEND_URING) {
+        std::cerr << "Warning: io_uring is not available (" << std::strerror(errno)
+                  << "), falling back to pread/pwrite" << std::endl;
+    }
+#else
+    if (options.backend == IO_BACKEND_URING) {
+        std::cerr << "Warning: built without io_uring support, falling back to pread/pwrite" << std::endl;
+    }
+#endif
+
+    return std::make_unique<PosixIoBackend>(fd);
+}
@@ -0,0 +1,186 @@
+#include "../pages/metrics.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+
+static const char* COUNTER_NAMES[METRIC_COUNTER_COUNT] = {
+    "page_reads",
+    "page_writes",
+    "buffer_hits",
+    "buffer_misses",
+    "fsyncs",
+    "leaf_splits",
+    "internal_splits",
+    "root_splits",
+    "node_merges",
+    "node_redistributions",
+    "pages_freed",
+    "pages_reused",
+    "append_inserts",
+    "memtable_flushes",
+    "memtable_rows_flushed",
+    "mapped_reads",
+    "checksum_failures",
+    "hash_index_hits",
+    "hash_index_stale",
+    "page_versions_kept",
+    "snapshot_version_reads"
+};
+
+static const char* HISTOGRAM_NAMES[METRIC_HISTOGRAM_COUNT] = {
+    "insert_latency_ns",
+    "lookup_latency_ns",
+    "erase_latency_ns",
+    "io_read_latency_ns",
+    "io_write_latency_ns",
+    "fsync_latency_ns",
+    "memtable_flush_latency_ns"
+};
+
+const char* metric_counter_name(MetricCounter counter) {
+    return COUNTER_NAMES[counter];
+}
+
+const char* metric_histogram_name(MetricHistogram histogram) {
+    return HISTOGRAM_NAMES[histogram];
+}
+
+
+// Every shard ever handed out. Shards are never freed: when a thread
+// exits its shard goes back on the free list with its counts intact, so
+// the totals keep what finished threads did and the next thread carries on
+// counting into it.
+struct MetricsRegistry {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<MetricsShard>> shards;
+    std::vector<MetricsShard*> free_shards;
+};
+
+static MetricsRegistry& registry() {
+    // Leaked on purpose: threads may still count while statics are destroyed
+    static MetricsRegistry* instance = new MetricsRegistry();
+    return *instance;
+}
+
+
+// Hands the thread's shard back when the thread exits
+struct ShardReleaser {
+    MetricsShard* shard = nullptr;
+
+    ~ShardReleaser() {
+        if (shard != nullptr) {
+            MetricsRegistry& r = registry();
+            std::lock_guard<std::mutex> guard(r.mutex);
+            r.free_shards.push_back(shard);
+        }
+    }
+};
+
+
+MetricsShard* metrics_attach_thread() {
+    static thread_local ShardReleaser releaser;
+
+    MetricsShard* shard;
+    {
+        MetricsRegistry& r = registry();
+        std::lock_guard<std::mutex> guard(r.mutex);
+        if (!r.free_shards.empty()) {
+            shard = r.free_shards.back();
+            r.free_shards.pop_back();
+        } else {
+            r.shards.push_back(std::make_unique<MetricsShard>());
+            shard = r.shards.back().get();
+        }
+    }
+
+    releaser.shard = shard;
+    metrics_thread_shard = shard;
+    return shard;
+}
+
+
+MetricsSnapshot metrics_snapshot() {
+    MetricsSnapshot snapshot;
+    MetricsRegistry& r = registry();
+    std::lock_guard<std::mutex> guard(r.mutex);
+
+    for (const auto& shard : r.shards) {
+        for (uint32_t c = 0; c < METRIC_COUNTER_COUNT; c++) {
+            snapshot.counters[c] += shard->counters[c].load(std::memory_order_relaxed);
+        }
+
+        for (uint32_t h = 0; h < METRIC_HISTOGRAM_COUNT; h++) {
+            const MetricsShard::Histogram& source = shard->histograms[h];
+            HistogramSnapshot& target = snapshot.histograms[h];
+
+            for (uint32_t b = 0; b < HISTOGRAM_BUCKETS; b++) {
+                uint64_t n = source.buckets[b].load(std::memory_order_relaxed);
+                target.buckets[b] += n;
+                target.count += n;
+            }
+            target.sum += source.sum.load(std::memory_order_relaxed);
+            target.max = std::max(target.max, source.max.load(std::memory_order_relaxed));
+        }
+    }
+    return snapshot;
+}
+
+
+uint64_t HistogramSnapshot::percentile(double p) const {
+    if (count == 0) return 0;
+
+    // Rank of the sample we are after, 1-based
+    uint64_t rank = (uint64_t) (p * count);
+    if (rank < 1) rank = 1;
+    if (rank > count) rank = count;
+
+    uint64_t seen = 0;
+    for (uint32_t b = 0; b < HISTOGRAM_BUCKETS; b++) {
+        seen += buckets[b];
+        if (seen >= rank) {
+            // Report the top of the bucket, but never above the real maximum
+            uint64_t high = (b + 1 < HISTOGRAM_BUCKETS) ? histogram_bucket_low(b + 1) - 1 : UINT64_MAX;
+            return std::min(high, max);
+        }
+    }
+    return max;
+}
+
+
+std::string MetricsSnapshot::to_text() const {
+    std::string out;
+    char line[256];
+
+    for (uint32_t c = 0; c < METRIC_COUNTER_COUNT; c++) {
+        std::snprintf(line, sizeof(line), "%s %lu\n", COUNTER_NAMES[c], (unsigned long) counters[c]);
+        out += line;
+    }
+
+    for (uint32_t h = 0; h < METRIC_HISTOGRAM_COUNT; h++) {
+        const HistogramSnapshot& histogram = histograms[h];
+        if (histogram.count == 0) continue;
+
+        std::snprintf(line, sizeof(line), "%s count=%lu mean=%.0f p50=%lu p90=%lu p99=%lu p999=%lu max=%lu\n",
+                      HISTOGRAM_NAMES[h], (unsigned long) histogram.count, histogram.mean(),
+                      (unsigned long) histogram.percentile(0.50), (unsigned long) histogram.percentile(0.90),
+                      (unsigned long) histogram.percentile(0.99), (unsigned long) histogram.percentile(0.999),
+                      (unsigned long) histogram.max);
+        out += line;
+    }
+    return out;
+}
+
+
+static std::atomic<bool> trace_on{std::getenv("RDBMS_TRACE") != nullptr};
+
+bool trace_enabled() {
+    return trace_on.load(std::memory_order_relaxed);
+}
+
+void set_trace_enabled(bool enabled) {
+    trace_on = enabled;
+}
@@ -0,0 +1,80 @@
+#include "../pages/page_arena.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <cstdint>
+#include <sys/mman.h>
+
+
+static size_t round_up(size_t value, size_t unit) {
+    return (value + unit - 1) / unit * unit;
+}
+
+
+PageArena::PageArena(uint32_t page_count, bool huge_pages) {
+    size_t bytes = (size_t) std::max<uint32_t>(1, page_count) * PAGE_SIZE;
+    bool want_huge = huge_pages && bytes >= HUGE_PAGE_BYTES;
+    int protection = PROT_READ | PROT_WRITE;
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+
+    // 1. Reserved huge pages: the mapping fails outright when there are not enough
+#ifdef MAP_HUGETLB
+    if (want_huge) {
+        length = round_up(bytes, HUGE_PAGE_BYTES);
+        void* address = ::mmap(nullptr, length, protection, flags | MAP_HUGETLB | MAP_POPULATE, -1, 0);
+        if (address != MAP_FAILED) {
+            memory = static_cast<char*>(address);
+            backing = ARENA_HUGETLB;
+            return;
+        }
+    }
+#endif
+
+    // 2. Plain pages. THP only folds whole aligned 2 MB ranges, so take one
+    //    huge page more than needed and trim the ends to an aligned range.
+    length = want_huge ? round_up(bytes, HUGE_PAGE_BYTES) : bytes;
+    size_t reserve = want_huge ? length + HUGE_PAGE_BYTES : length;
+    void* address = ::mmap(nullptr, reserve, protection, flags, -1, 0);
+    if (address == MAP_FAILED) {
+        throw std::runtime_error("PageArena: cannot map " + std::to_string(reserve) + " bytes");
+    }
+    memory = static_cast<char*>(address);
+
+    if (want_huge) {
+        char* aligned = reinterpret_cast<char*>(round_up(reinterpret_cast<uintptr_t>(memory), HUGE_PAGE_BYTES));
+        size_t head = aligned - memory;
+        if (head > 0) {
+            ::munmap(memory, head);
+        }
+        if (reserve - head > length) {
+            ::munmap(aligned + length, reserve - head - length);
+        }
+        memory = aligned;
+#ifdef MADV_HUGEPAGE
+        if (::madvise(memory, length, MADV_HUGEPAGE) == 0) {
+            backing = ARENA_TRANSPARENT;
+        }
+#endif
+    }
+
+    // 3. Fault it all in now
+    for (size_t offset = 0; offset < length; offset += PAGE_SIZE) {
+        memory[offset] = 0;
+    }
+}
+
+
+PageArena::~PageArena() {
+    if (memory != nullptr) {
+        ::munmap(memory, length);
+    }
+}
+
+
+const char* PageArena::get_backing_name() const {
+    switch (backing) {
+        case ARENA_HUGETLB: return "hugetlb";
+        case ARENA_TRANSPARENT: return "thp";
+        default: return "4k pages";
+    }
+}
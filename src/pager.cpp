@@ -1,26 +1,40 @@
 #include "../pages/pager.hpp"
 #include <iostream>
 #include <cstring>
+#include <stdexcept>
+#include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
 
 
-Pager::Pager(const std::string& filename) {
-    file_stream.open(filename, std::ios::in | std::ios::out | std::ios::binary);
-
-    if (!file_stream.is_open()) {
-        // if file does not exist, create it by opening in "out" mode only first
-        file_stream.open(filename, std::ios::out | std::ios::binary);
-        file_stream.close();
-
-        // Re-open with full permissions
-        file_stream.open(filename, std::ios::in | std::ios::out | std::ios::binary);
+Pager::Pager(const std::string& filename, uint32_t pool_frames, const WalOptions& wal_options,
+             const IoOptions& io_options): arena(pool_frames, io_options.huge_pages), frames(pool_frames) {
+    for (uint32_t i = 0; i < pool_frames; i++) {
+        frames[i].page = arena.page(i);
     }
 
+    // Create the file if it does not exist yet. Some file systems (tmpfs)
+    // refuse O_DIRECT, those get the page cache after all.
+    if (io_options.direct_io) {
+        fd = ::open(filename.c_str(), O_RDWR | O_CREAT | O_DIRECT, 0644);
+        if (fd >= 0) {
+            direct_io = true;
+        } else if (errno == EINVAL) {
+            std::cerr << "Warning: " << filename << " cannot be opened with O_DIRECT, using the page cache" << std::endl;
+        }
+    }
+    if (fd < 0) {
+        fd = ::open(filename.c_str(), O_RDWR | O_CREAT, 0644);
+    }
+    if (fd < 0) {
+        throw std::runtime_error("Pager: cannot open " + filename);
+    }
+    io = make_io_backend(fd, io_options);
 
     // Determine file length
-    file_stream.seekg(0, std::ios::end);
-    file_length = file_stream.tellg();
-    file_stream.clear();
-    file_stream.seekg(0, std::ios::beg);
+    file_length = ::lseek(fd, 0, SEEK_END);
 
     // Initialize  page count
     this->num_pages = file_length / PAGE_SIZE;
@@ -30,63 +44,1006 @@ Pager::Pager(const std::string& filename) {
         std::cerr << "Warning: DB file is not a multiple pf PAGE_SIZE!" << std::endl;
     };
 
-    std::cout << "Opened " << filename << " with " << (file_length / PAGE_SIZE) << " pages " << std::endl;
+    page_table.reserve(pool_frames);
+
+    // Bring the data file up to date with whatever the log sealed before a crash
+    wal = std::make_unique<Wal>(filename + ".wal", wal_options);
+    recover();
+
+    // The mapping would bring the page cache right back
+    if (io_options.map_reads && direct_io) {
+        std::cerr << "Warning: map_reads is ignored with direct I/O" << std::endl;
+    } else if (io_options.map_reads) {
+        map_file();
+    }
+
+    std::cout << "Opened " << filename << " with " << num_pages << " pages (" << get_io_backend_name()
+              << (direct_io ? ", direct" : "") << ", pool on " << arena.get_backing_name() << ")" << std::endl;
 }
 
+// Atomic max: raises value to candidate unless it is already larger
+template <typename T>
+static void raise_to(std::atomic<T>& value, T candidate) {
+    T current = value.load();
+    while (current < candidate && !value.compare_exchange_weak(current, candidate)) {
+    }
+}
+
+
 uint32_t Pager::get_unused_page_number() {
     return num_pages;
 }
 
+void Pager::reserve_pages(uint32_t page_count) {
+    raise_to(num_pages, page_count);
+}
+
+
+uint32_t Pager::allocate_pages(uint32_t count) {
+    // Free pages are scattered, so only single pages are reused
+    if (count == 1 && !free_list_empty) {
+        uint32_t page_id = reuse_free_page();
+        if (page_id != 0) {
+            return page_id;
+        }
+    }
+
+    // Concurrent splits each get their own ids, and a run stays consecutive
+    return num_pages.fetch_add(count);
+}
+
+
+void Pager::attach_free_list(uint32_t page_id, uint32_t head_offset) {
+    header_page_id = page_id;
+    free_list_head_offset = head_offset;
+
+    auto header_handle = read_page(header_page_id, LATCH_SHARED);
+    free_list_empty = deserialize_uint32(header_handle->data + free_list_head_offset) == 0;
+}
+
+
+Page* Pager::latch_until_commit(uint32_t page_id) {
+    {
+        std::lock_guard<std::mutex> guard(write_set_mutex);
+        auto it = commit_holders.find(std::this_thread::get_id());
+        if (it != commit_holders.end()) {
+            for (PageHandle& held : it->second) {
+                if (held.get_page_id() == page_id) {
+                    return held.get();
+                }
+            }
+        }
+    }
+
+    // Wait for the previous holder's commit without the mutex
+    PageHandle page_handle = read_page(page_id, LATCH_EXCLUSIVE);
+    Page* page = page_handle.get();
+
+    std::lock_guard<std::mutex> guard(write_set_mutex);
+    commit_holders[std::this_thread::get_id()].push_back(std::move(page_handle));
+    return page;
+}
+
+
+uint32_t Pager::reuse_free_page() {
+    if (header_page_id == INVALID_PAGE_ID) return 0;
+
+    char* head_slot = latch_header_page()->data + free_list_head_offset;
+    uint32_t page_id = deserialize_uint32(head_slot);
+    if (page_id == 0) {
+        // Somebody took the last one meanwhile (the latch stays with us
+        // until commit, harmless)
+        free_list_empty = true;
+        return 0;
+    }
+
+    // 1. Unlink it. Nobody else can reach a free page, no latch needed.
+    auto page_handle = read_page(page_id);
+    uint32_t next_free = deserialize_uint32(page_handle->data + FREE_PAGE_NEXT_OFFSET);
+    serialize_uint32(next_free, head_slot);
+    free_list_empty = next_free == 0;
+    mark_dirty(header_page_id);
+
+    // 2. Hand it out blank, logged together with the new head
+    std::memset(page_handle->data, 0, PAGE_SIZE);
+    page_handle.mark_dirty();
+
+    metrics_count(METRIC_PAGES_REUSED);
+    return page_id;
+}
+
+
+void Pager::free_page(uint32_t page_id) {
+    if (header_page_id == INVALID_PAGE_ID) return;
+
+    char* head_slot = latch_header_page()->data + free_list_head_offset;
+
+    // Latched: a snapshot reader may still be copying the page, it has to
+    // get the old image (preserved on the way in) or wait for the new one
+    auto page_handle = read_page(page_id, LATCH_EXCLUSIVE);
+    std::memset(page_handle->data, 0, PAGE_SIZE);
+    serialize_uint32(deserialize_uint32(head_slot), page_handle->data + FREE_PAGE_NEXT_OFFSET);
+    page_handle.mark_dirty();
+
+    serialize_uint32(page_id, head_slot);
+    free_list_empty = false;
+    mark_dirty(header_page_id);
+
+    metrics_count(METRIC_PAGES_FREED);
+}
+
 Pager::~Pager() {
-    if (file_stream.is_open()) {
-        file_stream.close();
+    if (fd >= 0) {
+        // Anything dirtied after the last commit_write never happened
+        for (auto& entry : write_sets) {
+            for (uint32_t frame_idx : entry.second) {
+                frames[frame_idx].in_write_set = false;
+                frames[frame_idx].is_dirty = false;
+            }
+        }
+        write_sets.clear();
+        commit_holders.clear();
+
+        checkpoint();
+        if (mapping != nullptr) {
+            ::munmap(mapping, mapping_length);
+        }
+        ::close(fd);
+    }
+}
+
+
+void Pager::recover() {
+    uint32_t replayed = wal->recover([this](uint32_t page_id, const Page& image) {
+        write_page_to_disk(page_id, image);
+        replayed_page_ids.push_back(page_id);
+    });
+
+    recovered_pages = replayed;
+    if (replayed > 0) {
+        sync_file(fd);
+        std::cerr << "Recovery: replayed " << replayed << " page image(s) from the WAL" << std::endl;
     }
+    wal->reset();
 }
 
 
-std::unique_ptr<Page> Pager::read_page(uint32_t page_id) {
-    auto page = std::make_unique<Page>();
-    uint32_t offset = page_id * PAGE_SIZE;
+PageHandle Pager::read_page(uint32_t page_id, PageLatch latch) {
+    Frame* frame = pin_frame(page_id);
+
+    // Latch only once the pool latch is gone: waiting for a busy page must
+    // not hold up lookups of every other page
+    if (latch == LATCH_SHARED) {
+        frame->latch.lock_shared();
+    } else if (latch == LATCH_EXCLUSIVE) {
+        frame->latch.lock();
+    }
+
+    // Writers (and LATCH_NONE callers, who may write) never touch the
+    // mapping, and an open snapshot gets the page as it is before they do
+    if (latch != LATCH_SHARED) {
+        materialize(frame);
+        frame->writable.store(true, std::memory_order_relaxed);
+        if (versions.is_active()) {
+            versions.preserve(page_id, *frame->page);
+        }
+    }
+    return PageHandle(this, frame, latch);
+}
+
+
+void Pager::map_file() {
+    uint64_t length = std::max<uint64_t>(MAP_MIN_RESERVE_BYTES, 2 * (uint64_t) file_length);
+    void* address = ::mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+    if (address == MAP_FAILED) {
+        std::cerr << "Warning: cannot map the data file, reading through the pool instead" << std::endl;
+        return;
+    }
+
+    // Lookups jump around the file: kernel readahead would only waste the
+    // page cache. Scans ask for their next leaves through prefetch.
+    ::madvise(address, length, MADV_RANDOM);
+    mapping = static_cast<char*>(address);
+    mapping_length = length;
+}
+
+
+Page* Pager::map_view(uint32_t page_id) {
+    if (mapping == nullptr) return nullptr;
+
+    // Only what the file already holds, the rest starts out blank in the frame
+    uint64_t end = (uint64_t) (page_id + 1) * PAGE_SIZE;
+    if (end > file_length) return nullptr;
+
+    if (end > mapping_length) {
+        std::lock_guard<std::mutex> guard(mapping_mutex);
+        uint64_t length = mapping_length;
+        if (end > length) {
+            // In place or not at all: views of the old range are pinned
+            uint64_t new_length = std::max(end, 2 * length);
+            if (::mremap(mapping, length, new_length, 0) == MAP_FAILED) {
+                return nullptr;
+            }
+            ::madvise(mapping + length, new_length - length, MADV_RANDOM);
+            mapping_length = new_length;
+        }
+    }
+    return reinterpret_cast<Page*>(mapping + (uint64_t) page_id * PAGE_SIZE);
+}
+
+
+void Pager::materialize(Frame* frame) {
+    if (frame->view.load(std::memory_order_acquire) == nullptr) return;
+
+    // Two LATCH_NONE callers may get here at once
+    std::lock_guard<std::mutex> guard(mapping_mutex);
+    Page* view = frame->view.load(std::memory_order_acquire);
+    if (view == nullptr) return;
+    std::memcpy(frame->page->data, view->data, PAGE_SIZE);
+    frame->view.store(nullptr, std::memory_order_release);
+}
+
+
+Frame* Pager::pin_frame(uint32_t page_id) {
+    // Scenario 1: Buffer hit, no I/O at all (and no exclusive pool latch)
+    {
+        std::shared_lock<std::shared_mutex> guard(pool_latch);
+        auto it = page_table.find(page_id);
+        if (it != page_table.end()) {
+            Frame& frame = frames[it->second];
+            frame.pin_count++;
+            frame.ref_bit = true;
+            guard.unlock();
+            metrics_count(METRIC_BUFFER_HITS);
+
+            return wait_for_page(frame, page_id);
+        }
+    }
+
+    // Scenario 2: Buffer miss, recycle a frame and load the page into it
+    std::unique_lock<std::shared_mutex> guard(pool_latch);
+
+    // Another thread may have loaded it while we waited for the latch
+    auto it = page_table.find(page_id);
+    if (it != page_table.end()) {
+        Frame& frame = frames[it->second];
+        frame.pin_count++;
+        frame.ref_bit = true;
+        guard.unlock();
+        metrics_count(METRIC_BUFFER_HITS);
+        return wait_for_page(frame, page_id);
+    }
+
+    uint32_t frame_idx = find_victim_frame();
+    if (frame_idx == INVALID_FRAME) {
+        throw std::runtime_error("Buffer pool exhausted: every frame is pinned");
+    }
+    Frame& frame = frames[frame_idx];
+
+    if (frame.page_id != INVALID_PAGE_ID) {
+        if (frame.is_dirty) {
+            write_page_to_disk(frame.page_id, *frame.page);
+        } else {
+            verify_evicted(frame);
+        }
+        page_table.erase(frame.page_id);
+    }
+
+    frame.page_id = page_id;
+    frame.pin_count = 1;
+    frame.is_dirty = false;
+    frame.ref_bit = true;
+    frame.loading = true;
+    frame.view = nullptr;
+    frame.has_checksum = false;
+    frame.writable = false;
+    frame.check = CHECK_DONE;
+    page_table[page_id] = frame_idx;
+    guard.unlock();
+    metrics_count(METRIC_BUFFER_MISSES);
+
+    // Mapped mode: nothing to read, the kernel faults the page in on first touch
+    bool from_disk = true;
+    if (Page* view = map_view(page_id)) {
+        frame.view = view;
+        metrics_count(METRIC_MAPPED_READS);
+    } else {
+        // The read runs without the pool latch; hits on this page wait for it
+        from_disk = read_page_from_disk(page_id, *frame.page);
+    }
+
+    if (from_disk && !verify_loaded(frame)) {
+        drop_frame(frame);
+        throw std::runtime_error("Checksum mismatch on page " + std::to_string(page_id)
+                                 + " (torn write or corruption)");
+    }
+    frame.loading = false;
+    frame.loading.notify_all();
+
+    return &frame;
+}
+
+
+Frame* Pager::wait_for_page(Frame& frame, uint32_t page_id) {
+    // Someone else may still be reading it in, or checking what readahead brought in
+    frame.loading.wait(true);
+    if (frame.check.load() != CHECK_DONE) {
+        check_prefetched(frame);
+    }
+
+    // ... and it failed its checksum: go and read it ourselves (and fail)
+    if (frame.page_id != page_id) {
+        frame.pin_count--;
+        return pin_frame(page_id);
+    }
+    return &frame;
+}
+
+
+void Pager::check_prefetched(Frame& frame) {
+    uint8_t state = CHECK_PENDING;
+    if (!frame.check.compare_exchange_strong(state, CHECK_RUNNING)) {
+        while (state == CHECK_RUNNING) {
+            frame.check.wait(CHECK_RUNNING);
+            state = frame.check.load();
+        }
+        return;
+    }
+
+    uint32_t page_id = frame.page_id;
+    bool ok = verify_loaded(frame);
+    if (!ok) {
+        drop_frame(frame);
+    }
+    frame.check = CHECK_DONE;
+    frame.check.notify_all();
+    if (!ok) {
+        throw std::runtime_error("Checksum mismatch on page " + std::to_string(page_id)
+                                 + " (torn write or corruption)");
+    }
+}
+
+
+void Pager::prefetch(const std::vector<uint32_t>& page_ids) {
+    std::vector<uint32_t> misses;
+    {
+        std::shared_lock<std::shared_mutex> guard(pool_latch);
+        for (uint32_t page_id : page_ids) {
+            if (page_table.count(page_id) == 0 && (uint64_t) page_id * PAGE_SIZE < file_length) {
+                misses.push_back(page_id);
+            }
+        }
+    }
+    std::sort(misses.begin(), misses.end());
+    misses.erase(std::unique(misses.begin(), misses.end()), misses.end());
+
+    // The mapping is served from the page cache, so filling the pool would
+    // only copy. Direct I/O has no page cache to hint, the pool is the only place.
+    bool mapped = mapping != nullptr;
+    if ((io->is_async() || direct_io) && !mapped) {
+        load_pages(misses);
+        return;
+    }
+
+    // One hint per run of adjacent pages
+    size_t i = 0;
+    while (i < misses.size()) {
+        size_t run = 1;
+        while (i + run < misses.size() && misses[i + run] == misses[i] + run) {
+            run++;
+        }
+        uint64_t offset = (uint64_t) misses[i] * PAGE_SIZE;
+        uint64_t length = (uint64_t) run * PAGE_SIZE;
+        if (mapped && offset + length <= mapping_length) {
+            ::madvise(mapping + offset, length, MADV_WILLNEED);
+        } else {
+            ::posix_fadvise(fd, (off_t) offset, (off_t) length, POSIX_FADV_WILLNEED);
+        }
+        i += run;
+    }
+}
+
+
+void Pager::load_pages(const std::vector<uint32_t>& page_ids) {
+    // 1. Map a frame for each page, exactly like a miss in pin_frame, but
+    //    leave most of the pool alone: readahead must not push out the working set
+    std::vector<Frame*> batch;
+    {
+        std::unique_lock<std::shared_mutex> guard(pool_latch);
+        uint32_t budget = std::max<uint32_t>(1, frames.size() / 4);
+
+        for (uint32_t page_id : page_ids) {
+            if (batch.size() >= budget) break;
+            if (page_table.count(page_id) != 0) continue;
+
+            uint32_t frame_idx = find_victim_frame();
+            if (frame_idx == INVALID_FRAME) break;
+            Frame& frame = frames[frame_idx];
+
+            if (frame.page_id != INVALID_PAGE_ID) {
+                if (frame.is_dirty) {
+                    write_page_to_disk(frame.page_id, *frame.page);
+                } else {
+                    verify_evicted(frame);
+                }
+                page_table.erase(frame.page_id);
+            }
+
+            frame.page_id = page_id;
+            frame.pin_count = 1;
+            frame.is_dirty = false;
+            frame.ref_bit = true;
+            frame.loading = true;
+            frame.view = nullptr;
+            frame.has_checksum = false;
+            frame.writable = false;
+            frame.check = CHECK_DONE;
+            page_table[page_id] = frame_idx;
+            batch.push_back(&frame);
+        }
+    }
+    if (batch.empty()) return;
+
+    // 2. One read per run of adjacent pages, every run in flight at once
+    std::vector<struct iovec> iovs(batch.size());
+    std::vector<IoRequest> requests;
+    for (size_t i = 0; i < batch.size(); i++) {
+        iovs[i].iov_base = batch[i]->page->data;
+        iovs[i].iov_len = PAGE_SIZE;
+
+        bool extends_run = i > 0 && batch[i]->page_id == batch[i - 1]->page_id + 1
+                           && requests.back().iov_count < FLUSH_MAX_RUN_PAGES;
+        if (extends_run) {
+            requests.back().iov_count++;
+        } else {
+            IoRequest request;
+            request.op = IO_READ;
+            request.offset = (uint64_t) batch[i]->page_id * PAGE_SIZE;
+            request.iov = &iovs[i];
+            request.iov_count = 1;
+            requests.push_back(request);
+        }
+    }
+
+    try {
+        {
+            LatencyTimer timer(METRIC_IO_READ_LATENCY);
+            io->submit_batch(requests);
+        }
+        metrics_count(METRIC_PAGE_READS, batch.size());
+        for (const IoRequest& request : requests) {
+            if (request.result != (int64_t) request.iov_count * PAGE_SIZE) {
+                std::cerr << "Error: Short read from file at page " << request.offset / PAGE_SIZE << std::endl;
+            }
+        }
+    } catch (const std::exception& e) {
+        // Hits are already waiting on these frames, so they must get their pages
+        std::cerr << "Warning: batched read failed (" << e.what() << "), reading pages one by one" << std::endl;
+        for (Frame* frame : batch) {
+            read_page_from_disk(frame->page_id, *frame->page);
+        }
+    }
+
+    // 3. Publish them, the pins were only there to cover the read. Much of
+    //    what readahead brings in is never used, so the checksum waits for
+    //    the first pin (wait_for_page).
+    for (Frame* frame : batch) {
+        if (checksums == CHECKSUM_ON_READ) {
+            frame->check = CHECK_PENDING;
+        }
+        frame->loading = false;
+        frame->loading.notify_all();
+        frame->pin_count--;
+    }
+}
+
+
+void Pager::mark_dirty(uint32_t page_id) {
+    Frame* frame = nullptr;
+    {
+        std::shared_lock<std::shared_mutex> guard(pool_latch);
+        auto it = page_table.find(page_id);
+        if (it != page_table.end()) {
+            frame = &frames[it->second];
+        }
+    }
+
+    // The caller has it pinned, so the frame cannot change under us
+    if (frame != nullptr) {
+        frame->is_dirty = true;
+        track_write(frame);
+    }
+}
+
+
+uint32_t Pager::append_pages(Page* pages, uint32_t count) {
+    uint32_t first_page_id = num_pages;
+    if (count == 0) return first_page_id;
+
+    if (checksums != CHECKSUM_OFF) {
+        for (uint32_t i = 0; i < count; i++) {
+            stamp_page_checksum(pages[i]);
+        }
+    }
+
+    uint64_t offset = (uint64_t) first_page_id * PAGE_SIZE;
+
+    LatencyTimer timer(METRIC_IO_WRITE_LATENCY);
+    const char* data = pages[0].data;
+    size_t remaining = (size_t) count * PAGE_SIZE;
+    while (remaining > 0) {
+        ssize_t written = ::pwrite(fd, data, remaining, offset);
+        if (written < 0) {
+            throw std::runtime_error("Pager: append write failed");
+        }
+        data += written;
+        offset += written;
+        remaining -= written;
+    }
+
+    num_pages += count;
+    metrics_count(METRIC_PAGE_WRITES, count);
+    raise_to(file_length, offset);
+    return first_page_id;
+}
+
+
+void Pager::track_write(Frame* frame) {
+    if (!frame->in_write_set.exchange(true)) {
+        std::lock_guard<std::mutex> guard(write_set_mutex);
+        write_sets[std::this_thread::get_id()].push_back(frame - frames.data());
+    }
+}
+
+
+uint32_t Pager::get_write_set_size() {
+    std::lock_guard<std::mutex> guard(write_set_mutex);
+    auto it = write_sets.find(std::this_thread::get_id());
+    return it == write_sets.end() ? 0 : it->second.size();
+}
+
+
+void Pager::commit_write() {
+    std::vector<uint32_t> write_set;
+    std::vector<PageHandle> held;   // let go only once the group is logged
+    {
+        std::lock_guard<std::mutex> guard(write_set_mutex);
+        auto holder = commit_holders.find(std::this_thread::get_id());
+        if (holder != commit_holders.end()) {
+            held.swap(holder->second);
+            commit_holders.erase(holder);
+        }
+
+        auto it = write_sets.find(std::this_thread::get_id());
+        if (it == write_sets.end()) return;
+        write_set.swap(it->second);
+        write_sets.erase(it);
+    }
+
+    // One image per touched page, sealed by a single commit record: a split
+    // is either replayed completely or not at all. Frames in a write set
+    // cannot be evicted, so their page ids are stable here.
+    std::vector<std::pair<uint32_t, Page*>> group;
+    group.reserve(write_set.size());
+    for (uint32_t frame_idx : write_set) {
+        group.push_back({ frames[frame_idx].page_id, frames[frame_idx].page });
+    }
+    wal->log_group(group);
+
+    // Copies taken for snapshots now know which change replaced them
+    // (before any latch goes, so no snapshot sees the new page without)
+    if (versions.is_active()) {
+        for (const auto& entry : group) {
+            versions.seal(entry.first, get_page_lsn(*entry.second));
+        }
+    }
+
+    for (uint32_t frame_idx : write_set) {
+        frames[frame_idx].in_write_set = false;
+    }
+}
+
+
+bool Pager::checkpoint_due() {
+    return wal->size() >= wal->get_options().checkpoint_bytes;
+}
+
+
+uint64_t Pager::open_snapshot() {
+    uint64_t lsn = wal->get_last_lsn();
+    versions.open(lsn, num_pages);
+    return lsn;
+}
+
+
+void Pager::close_snapshot(uint64_t lsn) {
+    versions.close(lsn);
+}
+
+
+void Pager::read_snapshot_page(uint32_t page_id, uint64_t lsn, Page& out) {
+    // 1. Changed since (or being changed right now): the copy
+    if (versions.find(page_id, lsn, out)) return;
+
+    // 2. Otherwise the page itself. A change may have committed in
+    //    between, but not while the page is latched here.
+    PageHandle page_handle = read_page(page_id, LATCH_SHARED);
+    if (versions.find(page_id, lsn, out)) return;
+    std::memcpy(out.data, page_handle->data, PAGE_SIZE);
+}
+
+
+std::shared_lock<std::shared_mutex> Pager::begin_write() {
+    std::lock_guard<std::mutex> gate(checkpoint_gate);
+    return std::shared_lock<std::shared_mutex>(checkpoint_latch);
+}
+
+
+std::unique_lock<std::shared_mutex> Pager::exclude_writers() {
+    std::lock_guard<std::mutex> gate(checkpoint_gate);
+    return std::unique_lock<std::shared_mutex>(checkpoint_latch);
+}
+
+
+void Pager::add_checkpoint_hook(const void* owner, std::function<void()> hook) {
+    std::lock_guard<std::mutex> guard(hooks_mutex);
+    checkpoint_hooks.push_back({ owner, std::move(hook) });
+}
+
+
+void Pager::remove_checkpoint_hook(const void* owner) {
+    std::lock_guard<std::mutex> guard(hooks_mutex);
+    std::erase_if(checkpoint_hooks, [owner](const auto& hook) { return hook.first == owner; });
+}
+
+
+void Pager::sync() {
+    wal->sync();
+}
+
+
+void Pager::flush_all() {
+    // 1. Pin every committed dirty frame so a reader's miss cannot evict it from under us
+    std::vector<Frame*> dirty;
+    {
+        std::shared_lock<std::shared_mutex> guard(pool_latch);
+        for (Frame& frame : frames) {
+            if (frame.page_id == INVALID_PAGE_ID || !frame.is_dirty || frame.in_write_set) {
+                continue;
+            }
+            frame.pin_count++;
+            dirty.push_back(&frame);
+        }
+    }
+
+    // 2. In file order, so neighbours end up in the same vectored write
+    std::sort(dirty.begin(), dirty.end(), [](const Frame* a, const Frame* b) {
+        return a->page_id < b->page_id;
+    });
+
+    // 3. A slice at a time, which bounds the staging copies
+    size_t slice = std::max<size_t>(1, frames.size() / 4);
+    for (size_t start = 0; start < dirty.size(); start += slice) {
+        write_frames(dirty.data() + start, std::min(slice, dirty.size() - start));
+    }
+}
+
+
+void Pager::write_frames(Frame* const* batch, size_t count) {
+    // 1. Copy each page out under its own latch. Holding them all across
+    //    the I/O would latch pages in file order rather than tree order.
+    std::vector<Page> staging(count);
+    std::vector<uint32_t> page_ids;
+    uint64_t max_lsn = 0;
+    for (size_t i = 0; i < count; i++) {
+        Frame* frame = batch[i];
+        frame->latch.lock_shared();
+        if (frame->is_dirty && !frame->in_write_set) {
+            Page& copy = staging[page_ids.size()];
+            std::memcpy(copy.data, frame->page->data, PAGE_SIZE);
+            if (checksums != CHECKSUM_OFF) {
+                // The frame keeps its stale trailer, only the copy goes out
+                stamp_page_checksum(copy);
+                frame->checksum = get_page_checksum(copy);
+                frame->has_checksum = true;
+            }
+            page_ids.push_back(frame->page_id);
+            max_lsn = std::max(max_lsn, get_page_lsn(*frame->page));
+            frame->is_dirty = false;
+        }
+        frame->latch.unlock_shared();
+    }
+    if (page_ids.empty()) {
+        unpin_all(batch, count);
+        return;
+    }
+
+    // 2. WAL rule, once for the whole batch
+    wal->flush_to(max_lsn);
+
+    // 3. One vectored write per run of adjacent pages
+    std::vector<struct iovec> iovs(page_ids.size());
+    std::vector<IoRequest> requests;
+    for (size_t i = 0; i < page_ids.size(); i++) {
+        iovs[i].iov_base = staging[i].data;
+        iovs[i].iov_len = PAGE_SIZE;
+
+        bool extends_run = i > 0 && page_ids[i] == page_ids[i - 1] + 1
+                           && requests.back().iov_count < FLUSH_MAX_RUN_PAGES;
+        if (extends_run) {
+            requests.back().iov_count++;
+        } else {
+            IoRequest request;
+            request.op = IO_WRITE;
+            request.offset = (uint64_t) page_ids[i] * PAGE_SIZE;
+            request.iov = &iovs[i];
+            request.iov_count = 1;
+            requests.push_back(request);
+        }
+    }
+    {
+        LatencyTimer timer(METRIC_IO_WRITE_LATENCY);
+        io->submit_batch(requests);
+    }
+    metrics_count(METRIC_PAGE_WRITES, page_ids.size());
+
+    // 4. The frames look clean since step 1, so they stay pinned until the
+    //    data is in the file: evicted earlier, a miss would read the old page
+    unpin_all(batch, count);
+
+    uint64_t end = 0;
+    for (const IoRequest& request : requests) {
+        if (request.result != (int64_t) request.iov_count * PAGE_SIZE) {
+            std::cerr << "Error: Short write to file at page " << request.offset / PAGE_SIZE << std::endl;
+        }
+        end = std::max(end, request.offset + (uint64_t) request.iov_count * PAGE_SIZE);
+    }
+    raise_to(file_length, end);
+    raise_to(num_pages, (uint32_t) (end / PAGE_SIZE));
+}
+
+
+void Pager::unpin_all(Frame* const* batch, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        batch[i]->pin_count--;
+    }
+}
+
+
+void Pager::checkpoint() {
+    // 0. Whatever the tables keep in memory goes into their superblocks
+    {
+        std::lock_guard<std::mutex> guard(hooks_mutex);
+        for (auto& hook : checkpoint_hooks) {
+            hook.second();
+        }
+    }
+
+    // 1. Log first, 2. data pages, 3. make them durable, 4. drop the log
+    wal->sync();
+    flush_all();
+    sync_file(fd);
+    wal->reset();
+}
+
+
+void Pager::unpin(Frame* frame) {
+    frame->pin_count--;
+}
+
+
+// CLOCK eviction: sweep the frames, giving recently used pages a second
+// chance, and take the first unpinned frame whose reference bit is clear.
+// Runs under the exclusive pool latch, so nothing can pin a frame meanwhile.
+// Returns INVALID_FRAME when every frame is pinned.
+uint32_t Pager::find_victim_frame() {
+    uint32_t pool_size = frames.size();
+
+    // Two full sweeps are enough: the first one clears every ref bit
+    for (uint32_t step = 0; step < 2 * pool_size; step++) {
+        uint32_t idx = clock_hand;
+        clock_hand = (clock_hand + 1) % pool_size;
+
+        Frame& frame = frames[idx];
+        // (a frame dropped after a failed checksum may still have waiters pinning it)
+        if (frame.page_id == INVALID_PAGE_ID && frame.pin_count == 0) {
+            return idx;
+        }
+        // Uncommitted changes must not reach the data file (no-steal)
+        if (frame.pin_count > 0 || frame.in_write_set) {
+            continue;
+        }
+        if (frame.ref_bit) {
+            frame.ref_bit = false;
+            continue;
+        }
+        return idx;
+    }
+
+    return INVALID_FRAME;
+}
+
+
+bool Pager::read_page_from_disk(uint32_t page_id, Page& page) {
+    uint64_t offset = (uint64_t) page_id * PAGE_SIZE;
 
     if (offset < file_length) {
-        // Scenario 1: Page is on disk
-        file_stream.seekg(offset, std::ios::beg);
-        file_stream.read(page->data, PAGE_SIZE);
+        // Page is on disk
+        int64_t bytes_read;
+        {
+            LatencyTimer timer(METRIC_IO_READ_LATENCY);
+            bytes_read = io->read(offset, page.data, PAGE_SIZE);
+        }
+        metrics_count(METRIC_PAGE_READS);
 
-        if (file_stream.gcount() != PAGE_SIZE) {
+        if (bytes_read != PAGE_SIZE) {
             std::cerr << "Error: Short read from file at page " << page_id << std::endl;
         }
+        return true;
     } else {
-        // Scenario 2: Page Fault (Requetsed a page we haven't written yet)
+        // Page Fault (Requetsed a page we haven't written yet)
         // We initialize the page with zeros (empty page)
-        std::memset(page->data, 0, PAGE_SIZE);
+        std::memset(page.data, 0, PAGE_SIZE);
 
-        if (page_id >= num_pages) {
-            num_pages = page_id + 1;
+        raise_to(num_pages, page_id + 1);
+        if (trace_enabled()) {
+            std::cout << "Page Fault: Initialized new page " << page_id << " in memory." << std::endl;
         }
-        std::cout << "Page Fault: Initialized new page " << page_id << " in memory." << std::endl;
+        return false;
     }
+}
 
-    return page;
 
+void Pager::write_page_to_disk(uint32_t page_id, const Page& page) {
+    // WAL rule: the log record describing this image must be durable first
+    wal->flush_to(get_page_lsn(page));
+
+    uint64_t offset = (uint64_t) page_id * PAGE_SIZE;
+
+    // The frame is on its way out, the trailer only has to be right on disk
+    Page stamped;
+    const Page* image = &page;
+    if (checksums != CHECKSUM_OFF) {
+        stamped = page;
+        stamp_page_checksum(stamped);
+        image = &stamped;
+    }
+
+    int64_t written;
+    {
+        LatencyTimer timer(METRIC_IO_WRITE_LATENCY);
+        written = io->write(offset, image->data, PAGE_SIZE);
+    }
+    metrics_count(METRIC_PAGE_WRITES);
+    if (written != PAGE_SIZE) {
+        std::cerr << "Error: Short write to file at page " << page_id << std::endl;
+    }
+
+    uint64_t current_end = offset + PAGE_SIZE;
+    raise_to(file_length, current_end);
+
+    // Pages past the old end may already be handed out in memory
+    raise_to(num_pages, (uint32_t) (current_end / PAGE_SIZE));
 }
 
 
-void Pager::write_page(uint32_t page_id, const Page& page) {
-    uint32_t offset = page_id * PAGE_SIZE;
+bool Pager::verify_loaded(Frame& frame) {
+    if (checksums != CHECKSUM_ON_READ) return true;
 
-    file_stream.seekp(offset, std::ios::beg);
-    file_stream.write(page.data, PAGE_SIZE);
-    file_stream.flush();
+    const Page* view = frame.view.load(std::memory_order_acquire);
+    const Page& page = view != nullptr ? *view : *frame.page;
+    if (!page_checksum_ok(page)) {
+        metrics_count(METRIC_CHECKSUM_FAILURES);
+        return false;
+    }
+    frame.checksum = get_page_checksum(page);
+    frame.has_checksum = true;
+    return true;
+}
 
-    uint32_t current_end = offset + PAGE_SIZE;
 
-    if (current_end > file_length) {
-        file_length = current_end;
+void Pager::verify_evicted(Frame& frame) {
+    // Readers cannot have changed it, and nothing can scribble on a view
+    if (checksums != CHECKSUM_ON_READ || !frame.has_checksum || !frame.writable || frame.view.load() != nullptr) return;
 
-        num_pages = file_length / PAGE_SIZE;
+    // Changed without mark_dirty: the change is about to be lost
+    if (page_checksum(*frame.page) != frame.checksum && !page_is_blank(*frame.page)) {
+        metrics_count(METRIC_CHECKSUM_FAILURES);
+        std::cerr << "Warning: page " << frame.page_id << " changed in memory without being marked dirty" << std::endl;
     }
 }
 
 
+void Pager::drop_frame(Frame& frame) {
+    {
+        std::unique_lock<std::shared_mutex> guard(pool_latch);
+        page_table.erase(frame.page_id);
+        frame.page_id = INVALID_PAGE_ID;
+        frame.view = nullptr;
+        frame.has_checksum = false;
+        frame.pin_count--;
+    }
+    // Hits waiting on it see the frame is no longer theirs and retry
+    frame.loading = false;
+    frame.loading.notify_all();
+}
+
 
+void Pager::set_checksums(ChecksumMode mode) {
+    if (mode == CHECKSUM_OFF) return;
+
+    // 1. Replayed pages are on disk without a checksum: dirty them so the
+    //    next write-back stamps them (nothing reads them from disk before).
+    //    They are on disk already, so a log bigger than the pool is
+    //    committed in several groups: uncommitted frames cannot be evicted.
+    checksums = CHECKSUM_ON_WRITE;
+    std::sort(replayed_page_ids.begin(), replayed_page_ids.end());
+    replayed_page_ids.erase(std::unique(replayed_page_ids.begin(), replayed_page_ids.end()),
+                            replayed_page_ids.end());
+    for (uint32_t page_id : replayed_page_ids) {
+        if (get_write_set_size() > get_pool_frames() / 2) {
+            commit_write();
+        }
+        auto page_handle = read_page(page_id);
+        page_handle.mark_dirty();
+    }
+    replayed_page_ids.clear();
+    commit_write();
+    checksums = mode;
+
+    // 2. Whatever was read before now (the header page) is checked late
+    if (mode == CHECKSUM_ON_READ) {
+        std::shared_lock<std::shared_mutex> guard(pool_latch);
+        for (Frame& frame : frames) {
+            if (frame.page_id == INVALID_PAGE_ID || frame.is_dirty || frame.has_checksum) continue;
+            if (!verify_loaded(frame)) {
+                throw std::runtime_error("Checksum mismatch on page " + std::to_string(frame.page_id)
+                                         + " (torn write or corruption)");
+            }
+        }
+    }
+}
+
+
+std::vector<uint32_t> Pager::scrub_file(uint32_t threads, uint64_t* pages_read) {
+    uint32_t page_count = file_length / PAGE_SIZE;
+    if (pages_read != nullptr) *pages_read = page_count;
+    threads = std::max<uint32_t>(1, std::min<uint32_t>(threads, page_count / SCRUB_CHUNK_PAGES + 1));
+
+    // Chunks of adjacent pages handed out to whichever thread is free
+    std::atomic<uint32_t> next_chunk{0};
+    std::mutex bad_mutex;
+    std::vector<uint32_t> bad;
+
+    auto worker = [&]() {
+        std::vector<Page> buffer(SCRUB_CHUNK_PAGES);
+        while (true) {
+            uint32_t first = next_chunk.fetch_add(1) * SCRUB_CHUNK_PAGES;
+            if (first >= page_count) break;
+            uint32_t count = std::min(SCRUB_CHUNK_PAGES, page_count - first);
+
+            int64_t bytes_read = io->read((uint64_t) first * PAGE_SIZE, buffer[0].data, count * PAGE_SIZE);
+            metrics_count(METRIC_PAGE_READS, count);
+            uint32_t complete = bytes_read < 0 ? 0 : (uint32_t) (bytes_read / PAGE_SIZE);
+
+            for (uint32_t i = 0; i < count; i++) {
+                if (i < complete && page_checksum_ok(buffer[i])) continue;
+                metrics_count(METRIC_CHECKSUM_FAILURES);
+                std::lock_guard<std::mutex> guard(bad_mutex);
+                bad.push_back(first + i);
+            }
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (uint32_t i = 1; i < threads; i++) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& thread : pool) {
+        thread.join();
+    }
+
+    std::sort(bad.begin(), bad.end());
+    return bad;
+}
@@ -0,0 +1,173 @@
+#include "pages/snapshot.hpp"
+#include "pages/table.hpp"
+
+
+template <typename Layout>
+BasicSnapshot<Layout>::BasicSnapshot(BasicTable<Layout>* t): table(t), pager(t->pager.get()) {
+    // With every write held off, the pages, the root and the memtable all
+    // say what was committed up to lsn and nothing else
+    std::unique_lock<std::shared_mutex> writers_guard = pager->exclude_writers();
+    lsn = pager->open_snapshot();
+    {
+        std::shared_lock<std::shared_mutex> root_guard(table->root_latch);
+        root_page_id = table->root_page_id;
+        tree_height = table->tree_height;
+    }
+
+    // Buffered inserts do not wait for writers, the memtable latch keeps them out
+    if (table->memtable) {
+        std::shared_lock<std::shared_mutex> memtable_guard(table->memtable_latch);
+        buffered.reserve(table->memtable->size());
+        for (const auto& entry : table->memtable->get_rows()) {
+            buffered.emplace_back(entry.first.key, entry.second);
+        }
+    }
+}
+
+
+template <typename Layout>
+BasicSnapshot<Layout>::~BasicSnapshot() {
+    pager->close_snapshot(lsn);
+}
+
+
+// The tree latch only keeps out work that changes pages without latching
+// them (insert_batch, merges, flushes), and only for one page copy
+template <typename Layout>
+void BasicSnapshot<Layout>::read_page(uint32_t page_id, Page& out) {
+    std::shared_lock<std::shared_mutex> tree_guard(table->tree_latch);
+    pager->read_snapshot_page(page_id, lsn, out);
+}
+
+
+template <typename Layout>
+uint32_t BasicSnapshot<Layout>::find_leaf(const KeyType& key, Page& out, bool leftmost) {
+    uint32_t page_id = root_page_id;
+    read_page(page_id, out);
+    for (uint32_t level = tree_height; level > 0; level--) {
+        InternalNode internal(&out, page_id);
+        page_id = internal.child_at(leftmost ? internal.first_child_index_for_key(key)
+                                             : internal.child_index_for_key(key));
+        read_page(page_id, out);
+    }
+    return page_id;
+}
+
+
+template <typename Layout>
+void BasicSnapshot<Layout>::read_value(LeafNode& leaf, uint32_t cell, std::string& out) {
+    out.clear();
+    if (!leaf.is_overflow(cell)) {
+        out.assign(leaf.get_value(cell), leaf.get_value_size(cell));
+        return;
+    }
+
+    out.reserve(leaf.get_value_size(cell));
+    auto page = std::make_unique<Page>();
+    uint32_t page_id = deserialize_uint32(leaf.cell_content(cell) + 4);
+    while (page_id != 0) {
+        read_page(page_id, *page);
+        OverflowPage overflow(page.get(), page_id);
+        out.append(overflow.payload(), overflow.get_payload_size());
+        page_id = overflow.get_next_page();
+    }
+}
+
+
+template <typename Layout>
+size_t BasicSnapshot<Layout>::buffered_lower_bound(const KeyType& key) const {
+    auto it = std::lower_bound(buffered.begin(), buffered.end(), key,
+        [](const std::pair<KeyType, std::string>& row, const KeyType& k) { return Traits::less(row.first, k); });
+    return it - buffered.begin();
+}
+
+
+template <typename Layout>
+bool BasicSnapshot<Layout>::find(const KeyType& key, std::string& value_out) {
+    size_t pos = buffered_lower_bound(key);
+    if (pos < buffered.size() && Traits::equal(buffered[pos].first, key)) {
+        value_out = buffered[pos].second;
+        return true;
+    }
+
+    auto page = std::make_unique<Page>();
+    LeafNode leaf(page.get(), find_leaf(key, *page));
+    uint32_t cell = leaf.find_cell(key);
+    if (cell >= leaf.get_key_count() || !Traits::equal(leaf.get_key(cell), key)) {
+        return false;
+    }
+    read_value(leaf, cell, value_out);
+    return true;
+}
+
+
+template <typename Layout>
+BasicSnapshotCursor<Layout>::BasicSnapshotCursor(BasicSnapshot<Layout>* s, const KeyType& low_key,
+                                                 const KeyType& high)
+    : snapshot(s), leaf_page(std::make_unique<Page>()), high_key(high) {
+    buffered_pos = snapshot->buffered_lower_bound(low_key);
+
+    leaf_id = snapshot->find_leaf(low_key, *leaf_page, true);
+    cell = current_leaf().find_cell(low_key);
+    in_tree = true;
+    skip_exhausted_leaves();
+    pick_row();
+}
+
+
+template <typename Layout>
+void BasicSnapshotCursor<Layout>::next() {
+    if (!valid) return;
+    if (from_buffer) {
+        buffered_pos++;
+    } else {
+        cell++;
+        skip_exhausted_leaves();
+    }
+    pick_row();
+}
+
+
+template <typename Layout>
+void BasicSnapshotCursor<Layout>::pick_row() {
+    bool buffer_left = buffered_pos < snapshot->buffered.size()
+                       && !Traits::less(high_key, buffered_row().first);
+    from_buffer = buffer_left && (!in_tree || Traits::less(buffered_row().first, current_leaf().get_key(cell)));
+    valid = in_tree || buffer_left;
+}
+
+
+// The next-page links are read from the leaf copies too, so a split since
+// the snapshot opened is never seen halfway
+template <typename Layout>
+void BasicSnapshotCursor<Layout>::skip_exhausted_leaves() {
+    while (cell >= current_leaf().get_key_count()) {
+        uint32_t next_page = current_leaf().get_next_page();
+        if (next_page == 0) {
+            in_tree = false;
+            return;
+        }
+        leaf_id = next_page;
+        snapshot->read_page(leaf_id, *leaf_page);
+        cell = 0;
+    }
+
+    if (Traits::less(high_key, current_leaf().get_key(cell))) {
+        in_tree = false;
+    }
+}
+
+
+template class BasicSnapshot<DefaultLayout>;
+template class BasicSnapshot<Layout64>;
+template class BasicSnapshot<CompositeLayout>;
+template class BasicSnapshot<UuidLayout>;
+template class BasicSnapshot<NameLayout>;
+template class BasicSnapshot<PackedLayout>;
+
+template class BasicSnapshotCursor<DefaultLayout>;
+template class BasicSnapshotCursor<Layout64>;
+template class BasicSnapshotCursor<CompositeLayout>;
+template class BasicSnapshotCursor<UuidLayout>;
+template class BasicSnapshotCursor<NameLayout>;
+template class BasicSnapshotCursor<PackedLayout>;
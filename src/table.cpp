@@ -1,33 +1,461 @@
 #include <cstdint>
 #include <memory>
+#include <optional>
+#include <iostream>
+#include <stdexcept>
+#include <filesystem>
+#include <thread>
 #include "pages/table.hpp"
 
 
-void Table::update_parent(uint32_t parent_id, SplitResult result) {
-    auto parent_handle = pager->read_page(parent_id);
-    InternalNode parent(parent_handle.get(), parent_id);
+template <typename Layout>
+void BasicTable<Layout>::format_file() {
+    if (owns_file()) {
+        pager->set_checksums(checksum_mode);
+    }
 
-    // Check if the internal node has room for one or more [ChildID + Key]
-    // Max cells for internal; (4096-20-4 for right child) / 8 = 509 cells
-    if(parent.get_key_count() < 500) {
-        parent.insert_child(result.split_key, result.new_page_id);
-        pager->write_page(parent_id, *parent_handle);
-    } else {
-        SplitResult internal_split = parent.split_and_insert(result, *pager);
+    // Other tables in the file may be writing (or checkpointing) meanwhile
+    std::shared_lock<std::shared_mutex> write_guard = begin_write();
+    uint32_t superblock_id = pager->allocate_page();
+    uint32_t root_id = pager->allocate_page();
 
-        // 2. If this  was the root, we need a new root
-        if (parent.is_root()) {
-            process_internal_root_split(parent, internal_split);
-        } else {
-            update_parent(parent.get_parent(), internal_split);
+    auto superblock_handle = pager->read_page(superblock_id);
+    Superblock superblock(superblock_handle.get());
+    superblock.initialize(Layout::KEY_SIZE, Layout::LEAF_KEYS);
+    superblock.set_root_page_id(root_id);
+    superblock.set_tree_height(0);
+    superblock.set_page_count(pager->get_num_pages());
+
+    // Use LeafNode to format the blank root
+    auto root_handle = pager->read_page(root_id);
+    LeafNode root_node(root_handle.get(), root_id);
+    root_node.initialize();
+    root_node.set_is_root(1);
+    root_node.set_next_page(0); // No sibling yet
+
+    // Log the "empty" table like any other change
+    superblock_handle.mark_dirty();
+    root_handle.mark_dirty();
+    superblock_handle.release();
+    root_handle.release();
+    pager->commit_write();
+    if (owns_file()) {
+        pager->attach_free_list(SUPERBLOCK_PAGE_ID, SUPERBLOCK_FREE_LIST_OFFSET);
+    }
+
+    this->superblock_page_id = superblock_id;
+    this->root_page_id = root_id;
+    this->tree_height = 0;
+    this->row_count = 0;
+}
+
+
+template <typename Layout>
+void BasicTable<Layout>::open_file() {
+    auto superblock_handle = pager->read_page(superblock_page_id);
+    Superblock superblock(superblock_handle.get());
+
+    // Files from before the superblock (tree pages from page 0 on) have a
+    // different page layout as well, there is nothing to read them with
+    if (!superblock.is_valid() && !owns_file()) {
+        throw std::runtime_error(table_name + ": no table at page " + std::to_string(superblock_page_id));
+    }
+    if (!superblock.is_valid()) {
+        throw std::runtime_error(table_name + ": no superblock at page 0 (not a table file, or one in the"
+                                 " layout from before superblocks, which is not supported)");
+    }
+
+    if (superblock.get_format_version() > TABLE_FORMAT_VERSION) {
+        throw std::runtime_error(table_name + ": written by a newer format version ("
+                                 + std::to_string(superblock.get_format_version()) + ")");
+    }
+    if (superblock.get_key_size() != Layout::KEY_SIZE) {
+        throw std::runtime_error(table_name + ": stored keys are " + std::to_string(superblock.get_key_size())
+                                 + " bytes, this table type uses " + std::to_string(Layout::KEY_SIZE));
+    }
+    if (superblock.get_leaf_keys() != Layout::LEAF_KEYS) {
+        throw std::runtime_error(table_name + ": stored leaves use key encoding " + std::to_string(superblock.get_leaf_keys())
+                                 + ", this table type uses " + std::to_string(Layout::LEAF_KEYS));
+    }
+
+    // Older pages may use the bytes the checksum would go in. In a shared
+    // file the table at page 0 decides for all of them.
+    bool has_checksums = superblock.get_format_version() >= CHECKSUM_FORMAT_VERSION;
+    if (owns_file() && has_checksums) {
+        pager->set_checksums(checksum_mode);
+    } else if (owns_file() && checksum_mode != CHECKSUM_OFF) {
+        std::cerr << "Warning: " << table_name << " is format version " << superblock.get_format_version()
+                  << ", its pages have no checksums" << std::endl;
+    }
+
+    this->root_page_id = superblock.get_root_page_id();
+    this->tree_height = superblock.get_tree_height();
+    this->row_count = superblock.get_row_count();
+
+    // Inserts replayed from the log never made it into the stored count
+    this->row_count_known = !(superblock.get_flags() & SUPERBLOCK_FLAG_ROW_COUNT_STALE)
+                            && !pager->recovered_from_log();
+
+    uint32_t page_count = superblock.get_page_count();
+    superblock_handle.release();
+    if (owns_file()) {
+        pager->reserve_pages(page_count);
+        pager->attach_free_list(SUPERBLOCK_PAGE_ID, SUPERBLOCK_FREE_LIST_OFFSET);
+    }
+}
+
+
+template <typename Layout>
+void BasicTable<Layout>::open_memtable(bool buffered) {
+    const std::string& log_name = memtable_log_name;
+    if (log_name.empty() || (!buffered && !std::filesystem::exists(log_name))) return;
+
+    uint64_t flush_lsn;
+    uint64_t flushed_rows;
+    {
+        auto superblock_handle = pager->read_page(superblock_page_id);
+        Superblock superblock(superblock_handle.get());
+        flush_lsn = superblock.get_memtable_flush_lsn();
+        flushed_rows = superblock.get_memtable_flushed_rows();
+    }
+
+    // Its log commits like the pager's
+    memtable = std::make_unique<Memtable>(log_name, pager->get_wal_options());
+    uint64_t recovered = memtable->recover(flush_lsn, flushed_rows);
+
+    // Closing flushes the memtable, so anything left means a crash: the
+    // stored row count may or may not include these
+    if (recovered > 0) {
+        std::cerr << "Recovery: " << recovered << " buffered row(s) from " << log_name << std::endl;
+        row_count_known = false;
+    }
+
+    if (!buffered) {
+        flush_memtable();
+        memtable.reset();
+    }
+}
+
+
+template <typename Layout>
+void BasicTable<Layout>::flush_memtable(bool only_if_full) {
+    if (!memtable) return;
+    {
+        std::unique_lock<std::shared_mutex> tree_guard(tree_latch);
+        std::shared_lock<std::shared_mutex> write_guard = begin_write();
+        std::unique_lock<std::shared_mutex> memtable_guard(memtable_latch);
+        if (memtable->empty() || (only_if_full && memtable->get_bytes() < memtable_limit)) {
+            return;
+        }
+        LatencyTimer timer(METRIC_MEMTABLE_FLUSH_LATENCY);
+        metrics_count(METRIC_MEMTABLE_FLUSHES);
+        metrics_count(METRIC_MEMTABLE_ROWS_FLUSHED, memtable->size());
+
+        // 1. Every row must be in the memtable log before any of it reaches
+        // the tree: a crash halfway through replays the rest from there
+        memtable->sync();
+
+        // 2. The memtable is sorted already, merge it leaf by leaf
+        std::vector<Row> rows;
+        rows.reserve(memtable->size());
+        for (const auto& entry : memtable->get_rows()) {
+            rows.push_back({ entry.first.key, entry.second });
         }
+        merge_sorted(rows, memtable->last_lsn());
+
+        // 3. Once the tree side is durable the memtable log can go. The
+        // progress marker is reset after it: until then a crash finds an
+        // empty log, which the marker does not apply to.
+        pager->sync();
+        memtable->clear();
+
+        Superblock superblock(pager->latch_until_commit(superblock_page_id));
+        superblock.set_memtable_flush(0, 0);
+        pager->mark_dirty(superblock_page_id);
+        pager->commit_write();
     }
 
+    maybe_checkpoint();
 }
 
 
-void Table::process_internal_root_split(InternalNode old_root, SplitResult internal_split) {
-    uint32_t new_root_id = pager->get_unused_page_number();
+template <typename Layout>
+void BasicTable<Layout>::save_superblock() {
+    Superblock superblock(pager->latch_until_commit(superblock_page_id));
+    if (owns_file()) {
+        superblock.set_page_count(pager->get_num_pages());
+    }
+    superblock.set_row_count(row_count);
+    superblock.set_flags(row_count_known ? 0 : SUPERBLOCK_FLAG_ROW_COUNT_STALE);
+    pager->mark_dirty(superblock_page_id);
+    pager->commit_write();
+}
+
+
+template <typename Layout>
+void BasicTable<Layout>::count_rows() {
+    // Writers keep counting into row_count meanwhile, so hold them off
+    // until the walk and the store are done
+    std::unique_lock<std::shared_mutex> tree_guard(tree_latch);
+    if (row_count_known) return;
+    std::shared_lock<std::shared_mutex> memtable_guard(memtable_latch);
+
+    uint32_t page_id = root_page_id;
+    for (uint32_t level = tree_height; level > 0; level--) {
+        auto page_handle = pager->read_page(page_id, LATCH_SHARED);
+        page_id = InternalNode(page_handle.get(), page_id).get_child(0);
+    }
+
+    uint64_t count = 0;
+    while (page_id != 0) {
+        auto page_handle = pager->read_page(page_id, LATCH_SHARED);
+        LeafNode leaf(page_handle.get(), page_id);
+        count += leaf.get_key_count();
+        page_id = leaf.get_next_page();
+    }
+    if (memtable) {
+        count += memtable->size();
+    }
+
+    row_count = count;
+    row_count_known = true;
+}
+
+
+template <typename Layout>
+std::vector<typename Layout::KeyType> BasicTable<Layout>::partition_range(const KeyType& lo, const KeyType& hi,
+                                                                          uint32_t partitions) {
+    std::vector<KeyType> bounds;
+    if (partitions <= 1) return bounds;
+
+    // No rebalance frees a node under us; splits may still go on, which at
+    // worst makes the dividers a little uneven
+    std::shared_lock<std::shared_mutex> tree_guard(tree_latch);
+    std::vector<uint32_t> nodes;
+    uint32_t level;
+    {
+        std::shared_lock<std::shared_mutex> root_guard(root_latch);
+        nodes.push_back(root_page_id);
+        level = tree_height;
+    }
+
+    // 1. A level at a time, the nodes that hold part of [lo, hi] and the
+    //    dividers between their children, until there are enough (the
+    //    leaves themselves are never read)
+    while (level > 0 && bounds.size() + 1 < partitions) {
+        std::vector<uint32_t> children;
+        for (uint32_t page_id : nodes) {
+            PageHandle page_handle = pager->read_page(page_id, LATCH_SHARED);
+            InternalNode node(page_handle.get(), page_id);
+            uint32_t count = node.get_key_count();
+
+            // Child k holds the keys between dividers k - 1 and k
+            for (uint32_t k = 0; k <= count; k++) {
+                if (k < count && Traits::less(node.get_key(k), lo)) continue;
+                if (k > 0) {
+                    KeyType divider = node.get_key(k - 1);
+                    if (Traits::less(hi, divider)) break;
+                    if (Traits::less(lo, divider) && Traits::less(divider, hi)) {
+                        bounds.push_back(divider);
+                    }
+                }
+                children.push_back(node.child_at(k));
+            }
+        }
+        // The dividers of the level above sit between these, and with
+        // duplicate keys a divider may show up twice
+        std::sort(bounds.begin(), bounds.end(), [](const KeyType& a, const KeyType& b) {
+            return Traits::less(a, b);
+        });
+        bounds.erase(std::unique(bounds.begin(), bounds.end(), [](const KeyType& a, const KeyType& b) {
+            return Traits::equal(a, b);
+        }), bounds.end());
+
+        nodes.swap(children);
+        level--;
+    }
+
+    // 2. The last level read usually has far too many: keep an even spread
+    if (bounds.size() + 1 > partitions) {
+        std::vector<KeyType> spread;
+        for (uint32_t i = 1; i < partitions; i++) {
+            spread.push_back(bounds[(size_t) i * bounds.size() / partitions]);
+        }
+        bounds.swap(spread);
+    }
+    return bounds;
+}
+
+
+template <typename Layout>
+VerifyReport BasicTable<Layout>::verify(uint32_t threads) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    VerifyReport report;
+
+    // 1. No writer until we are done, and every committed page on disk
+    std::unique_lock<std::shared_mutex> tree_guard(tree_latch);
+    {
+        std::unique_lock<std::shared_mutex> writers_guard = pager->exclude_writers();
+        pager->checkpoint();
+
+        // 2. Checksums, straight from the file (the pool is left alone,
+        //    and other tables in the file are held off, so nothing gets
+        //    written behind the reads)
+        if (pager->get_checksums() != CHECKSUM_OFF) {
+            report.checksums_checked = true;
+            report.corrupt_pages = pager->scrub_file(threads, &report.pages_scrubbed);
+        }
+    }
+
+    // 3. The tree, a level at a time. Each page comes with the key range
+    //    its parent allows (equal keys may sit on both sides of a divider).
+    struct Item {
+        uint32_t page_id;
+        std::optional<KeyType> low;
+        std::optional<KeyType> high;
+    };
+    std::vector<Item> level = { { root_page_id, std::nullopt, std::nullopt } };
+    std::mutex report_mutex;
+    std::atomic<uint64_t> rows{0};
+
+    auto problem = [&](uint32_t page_id, const std::string& what) {
+        std::lock_guard<std::mutex> guard(report_mutex);
+        if (report.tree_errors.size() < VERIFY_MAX_ERRORS) {
+            report.tree_errors.push_back("page " + std::to_string(page_id) + ": " + what);
+        }
+    };
+    auto in_range = [](const KeyType& key, const Item& item) {
+        return (!item.low || !Traits::less(key, *item.low)) && (!item.high || !Traits::less(*item.high, key));
+    };
+
+    for (uint32_t depth = tree_height + 1; depth-- > 0 && !level.empty(); ) {
+        bool leaf_level = depth == 0;
+        std::atomic<size_t> next_item{0};
+        std::vector<Item> next_level;
+
+        auto worker = [&]() {
+            std::vector<Item> children;
+            for (size_t i = next_item.fetch_add(1); i < level.size(); i = next_item.fetch_add(1)) {
+                const Item& item = level[i];
+                if (item.page_id == 0 || item.page_id >= pager->get_num_pages()) {
+                    problem(item.page_id, "child pointer out of range");
+                    continue;
+                }
+                try {
+                    PageHandle page_handle = pager->read_page(item.page_id, LATCH_SHARED);
+                    uint8_t type = page_handle->data[NODE_TYPE_OFFSET];
+
+                    if (leaf_level) {
+                        if (type != NODE_LEAF) {
+                            problem(item.page_id, "expected a leaf");
+                            continue;
+                        }
+                        LeafNode leaf(page_handle.get(), item.page_id);
+                        uint32_t count = leaf.get_key_count();
+                        for (uint32_t cell = 0; cell < count; cell++) {
+                            KeyType key = leaf.get_key(cell);
+                            if (!in_range(key, item) || (cell > 0 && Traits::less(key, leaf.get_key(cell - 1)))) {
+                                problem(item.page_id, "key " + std::to_string(cell) + " out of order");
+                                break;
+                            }
+                            if (leaf.is_overflow(cell)) {
+                                std::string value;
+                                leaf.read_value(cell, *pager, value);
+                                if (value.size() != leaf.get_value_size(cell)) {
+                                    problem(item.page_id, "overflow chain of cell " + std::to_string(cell) + " is short");
+                                }
+                            }
+                        }
+                        rows += count;
+                    } else {
+                        if (type != NODE_INTERNAL) {
+                            problem(item.page_id, "expected an internal node");
+                            continue;
+                        }
+                        InternalNode node(page_handle.get(), item.page_id);
+                        uint32_t count = node.get_key_count();
+                        if (count == 0 || count > Layout::INTERNAL_NODE_MAX_CELLS) {
+                            problem(item.page_id, "bad key count " + std::to_string(count));
+                            continue;
+                        }
+                        std::optional<KeyType> low = item.low;
+                        for (uint32_t k = 0; k <= count; k++) {
+                            std::optional<KeyType> high = k < count ? std::optional<KeyType>(node.get_key(k)) : item.high;
+                            if (k < count && (!in_range(*high, item) || (low && Traits::less(*high, *low)))) {
+                                problem(item.page_id, "divider " + std::to_string(k) + " out of order");
+                            }
+                            children.push_back({ node.child_at(k), low, high });
+                            low = high;
+                        }
+                    }
+                } catch (const std::exception& e) {
+                    problem(item.page_id, e.what());
+                }
+            }
+            std::lock_guard<std::mutex> guard(report_mutex);
+            next_level.insert(next_level.end(), children.begin(), children.end());
+        };
+
+        std::vector<std::thread> pool;
+        uint32_t level_threads = std::min<size_t>(threads, level.size());
+        for (uint32_t i = 1; i < level_threads; i++) {
+            pool.emplace_back(worker);
+        }
+        worker();
+        for (std::thread& thread : pool) {
+            thread.join();
+        }
+
+        report.pages_walked += level.size();
+        level.swap(next_level);
+    }
+    report.rows = rows;
+
+    // 4. The count kept in memory should agree with the leaves
+    if (row_count_known) {
+        std::shared_lock<std::shared_mutex> memtable_guard(memtable_latch);
+        uint64_t expected = row_count - (memtable ? memtable->size() : 0);
+        if (expected != report.rows) {
+            problem(superblock_page_id, "row count says " + std::to_string(expected) + ", the leaves hold "
+                                        + std::to_string(report.rows));
+        }
+    }
+    return report;
+}
+
+
+template <typename Layout>
+void BasicTable<Layout>::update_parent(WritePath& path, uint32_t split_page_id, SplitResult result) {
+    // The handles stay in path: every page changed here remains latched
+    // until the caller commits
+    for (size_t level = path.ancestors.size(); level-- > 0; ) {
+        PageHandle& parent_handle = path.ancestors[level];
+        uint32_t parent_id = parent_handle.get_page_id();
+        InternalNode parent(parent_handle.get(), parent_id);
+
+        // Check if the internal node has room for one or more [ChildID + Key]
+        if(parent.get_key_count() < Layout::INTERNAL_NODE_MAX_CELLS) {
+            parent.insert_child(result.split_key, result.new_page_id, split_page_id);
+            parent_handle.mark_dirty();
+            return;
+        }
+
+        result = parent.split_and_insert(result, split_page_id, *pager);
+        split_page_id = parent_id;
+    }
+
+    // 2. The split ran past the top of the path, so that was the root (the
+    // descent kept the root latch for exactly this case)
+    create_new_root(split_page_id, result.split_key, result.new_page_id);
+}
+
+
+template <typename Layout>
+void BasicTable<Layout>::create_new_root(uint32_t left_child_id, const KeyType& split_key, uint32_t right_child_id) {
+    metrics_count(METRIC_ROOT_SPLITS);
+    uint32_t new_root_id = pager->allocate_page();
     auto new_root_handle =  pager->read_page(new_root_id);
 
     InternalNode new_root(new_root_handle.get(), new_root_id);
@@ -38,26 +466,484 @@ void Table::process_internal_root_split(InternalNode old_root, SplitResult inter
     new_root.set_key_count(1);
 
 
-    // link the children
-    new_root.set_child(0, old_root.get_page_id());
-    new_root.set_key(0, internal_split.split_key);
-    new_root.set_right_child(internal_split.new_page_id);
+    // link the children: [Child 0] [Key 0] [Right Child]
+    new_root.set_child(0, left_child_id);
+    new_root.set_key(0, split_key);
+    new_root.set_right_child(right_child_id);
+    new_root_handle.mark_dirty();
 
-    // 4. Update the old root's metadata
+    // Update the old root's metadata. The caller still has it latched and
+    // nobody else can reach the sibling yet, so neither is latched again.
+    auto old_root_handle = pager->read_page(left_child_id);
+    InternalNode old_root(old_root_handle.get(), left_child_id);
     old_root.set_is_root(false);
     old_root.set_parent(new_root_id);
+    old_root_handle.mark_dirty();
 
-    // 5. Update the Sibling's metadata (It needs to know who its new father is)
-    auto sibling_handle = pager->read_page(internal_split.new_page_id);
-    InternalNode sibling(sibling_handle.get(), internal_split.new_page_id);
+    // Update the Sibling's metadata (It needs to know who its new father is)
+    auto sibling_handle = pager->read_page(right_child_id);
+    InternalNode sibling(sibling_handle.get(), right_child_id);
     sibling.set_parent(new_root_id);
+    sibling_handle.mark_dirty();
 
-    // 6. Persist everything
-    pager->write_page(new_root_id, *new_root_handle);
-    pager->write_page(old_root.get_page_id(), *(old_root.get_page()));
-    pager->write_page(internal_split.new_page_id, *sibling_handle);
+    // The superblock goes into the same WAL group as the split, or a crash
+    // could bring back the split without the root that covers it. It stays
+    // latched until the commit, like the free list changes in it.
+    Superblock superblock(pager->latch_until_commit(superblock_page_id));
+    superblock.set_root_page_id(new_root_id);
+    superblock.set_tree_height(tree_height + 1);
+    pager->mark_dirty(superblock_page_id);
 
-    // 7. Update the table pointer
+    // Update the table pointer (under the exclusive root latch or the tree latch)
     this->root_page_id = new_root_id;
+    this->tree_height++;
+
+}
+
+
+template <typename Layout>
+void BasicTable<Layout>::insert_batch(std::span<const Row> rows) {
+    if (rows.empty()) return;
+
+    // Merges rebuild leaves and link siblings one at a time, which readers
+    // must not see half done
+    std::unique_lock<std::shared_mutex> tree_guard(tree_latch);
+    std::shared_lock<std::shared_mutex> write_guard = begin_write();
+
+    // 1. Sort so rows bound for the same leaf end up next to each other
+    std::vector<Row> sorted(rows.begin(), rows.end());
+    std::stable_sort(sorted.begin(), sorted.end(),
+        [](const Row& a, const Row& b) { return Traits::less(a.first, b.first); });
+
+    // 2. Merge them into the leaves and count them
+    merge_sorted(sorted, 0);
+
+    write_guard.unlock();
+    maybe_checkpoint();
+}
+
+
+template <typename Layout>
+void BasicTable<Layout>::merge_sorted(std::span<const Row> sorted, uint64_t memtable_lsn) {
+    // Rows of the groups logged so far, and of the one being built
+    size_t committed = 0;
+    size_t uncommitted = 0;
+    auto commit = [&]() {
+        if (memtable_lsn != 0) {
+            Superblock superblock(pager->latch_until_commit(superblock_page_id));
+            superblock.set_memtable_flush(memtable_lsn, committed + uncommitted);
+            pager->mark_dirty(superblock_page_id);
+        } else {
+            row_count.fetch_add(uncommitted);
+        }
+        pager->commit_write();
+        committed += uncommitted;
+        uncommitted = 0;
+    };
+
+    // One descent per group: the leaf covers every key below its fence
+    size_t i = 0;
+    while (i < sorted.size()) {
+        // Uncommitted pages cannot be evicted, so a huge batch is logged in
+        // several groups before it fills the pool
+        if (pager->get_write_set_size() > pager->get_pool_frames() / 2) {
+            commit();
+        }
+
+        PinnedPath pinned;
+        std::optional<KeyType> fence;
+        PageHandle leaf_handle = find_leaf_pinned(sorted[i].first, pinned, &fence);
+        WritePath path;
+        path.ancestors = std::move(pinned.ancestors);
+
+        // Cap the run so a single merge never creates more than a few
+        // dozen leaves, nor more overflow pages than the pool can hold
+        size_t j = i + 1;
+        size_t run_limit = std::min<size_t>(sorted.size(), i + 8 * Layout::LEAF_NODE_MAX_CELLS);
+        size_t run_bytes = sorted[i].second.size();
+        size_t byte_limit = (size_t) pager->get_pool_frames() / 4 * PAGE_SIZE;
+        while (j < run_limit && (!fence || Traits::less(sorted[j].first, *fence))) {
+            run_bytes += sorted[j].second.size();
+            if (run_bytes > byte_limit) break;
+            j++;
+        }
+
+        merge_into_leaf(std::move(leaf_handle), path, sorted.data() + i, j - i);
+        uncommitted += j - i;
+        i = j;
+    }
+    commit();
+}
+
+
+template <typename Layout>
+void BasicTable<Layout>::merge_into_leaf(PageHandle page_handle, WritePath& path,
+                                         const Row* rows, uint32_t row_count) {
+    uint32_t leaf_id = page_handle.get_page_id();
+
+    // 1. Merge the leaf's cells with the new rows into one sorted run. The
+    // old cells are read from a snapshot since the page gets rebuilt.
+    Page snapshot = *page_handle;
+    LeafNode old_leaf(&snapshot, leaf_id);
+
+    struct PendingCell {
+        KeyType key;
+        const char* content;
+        uint16_t raw_length;
+    };
+
+    uint32_t existing = old_leaf.get_key_count();
+    std::vector<PendingCell> cells;
+    cells.reserve(existing + row_count);
+    std::vector<char> stubs((size_t) row_count * LEAF_NODE_OVERFLOW_STUB_SIZE);
+
+    uint32_t total_content = 0;
+    uint32_t a = 0;
+    uint32_t b = 0;
+    while (a < existing || b < row_count) {
+        PendingCell cell;
+        if (b >= row_count || (a < existing && !Traits::less(rows[b].first, old_leaf.get_key(a)))) {
+            cell = { old_leaf.get_key(a), old_leaf.cell_content(a), old_leaf.get_cell_length_raw(a) };
+            a++;
+        } else {
+            char* stub = stubs.data() + ((size_t) b * LEAF_NODE_OVERFLOW_STUB_SIZE);
+            cell.key = rows[b].first;
+            cell.raw_length = LeafNode::prepare_cell(*pager, rows[b].second.data(), rows[b].second.size(),
+                                                     stub, &cell.content);
+            b++;
+        }
+        total_content += cell.raw_length & ~LEAF_SLOT_OVERFLOW_FLAG;
+        cells.push_back(cell);
+    }
+    uint32_t total_bytes = LeafNode::cells_bytes(cells.size(), total_content, cells.front().key, cells.back().key);
+
+    // 2. Spread the run evenly over as many leaves as it needs. The first
+    // one is the original leaf, the rest become new right siblings.
+    uint32_t leaf_count = (total_bytes + LEAF_NODE_SPACE_FOR_CELLS - 1) / LEAF_NODE_SPACE_FOR_CELLS;
+    uint32_t target_bytes = (total_bytes + leaf_count - 1) / leaf_count;
+
+    LeafNode(page_handle.get(), leaf_id).clear_cells();
+    page_handle.mark_dirty();
+
+    std::vector<SplitResult> new_siblings;
+    uint32_t leaf_cells = 0;
+    uint32_t leaf_content = 0;
+    KeyType leaf_first_key{};
+
+    // The leaf being filled stays pinned until the next one is linked behind it
+    PageHandle current_handle = std::move(page_handle);
+
+    for (const PendingCell& cell : cells) {
+        uint32_t length = cell.raw_length & ~LEAF_SLOT_OVERFLOW_FLAG;
+        LeafNode current(current_handle.get(), current_handle.get_page_id());
+
+        if (leaf_cells > 0
+            && (LeafNode::cells_bytes(leaf_cells + 1, leaf_content + length, leaf_first_key, cell.key) > target_bytes
+                || !current.has_room(length, cell.key))) {
+            uint32_t new_page_num = pager->allocate_page();
+            auto new_page = pager->read_page(new_page_num);
+            LeafNode right_node(new_page.get(), new_page_num);
+
+            right_node.initialize();
+            right_node.set_is_root(0);
+            right_node.set_next_page(current.get_next_page());
+            current.set_next_page(new_page_num);
+            new_page.mark_dirty();
+
+            new_siblings.push_back({ cell.key, new_page_num });
+            metrics_count(METRIC_LEAF_SPLITS);
+            current_handle = std::move(new_page);
+            current = LeafNode(current_handle.get(), new_page_num);
+            leaf_cells = 0;
+            leaf_content = 0;
+        }
+
+        if (leaf_cells == 0) {
+            leaf_first_key = cell.key;
+        }
+        current.append_cell(cell.key, cell.content, cell.raw_length);
+        leaf_cells++;
+        leaf_content += length;
+    }
+    current_handle.release();
+
+    // 3. Hand the new siblings to the parent, left to right. After the first
+    // one the parent may have split, so look the parent up again each time:
+    // a descent for the sibling's first key lands on its left neighbour.
+    // (The previous path is let go first; insert_batch has the tree to itself.)
+    for (size_t n = 0; n < new_siblings.size(); n++) {
+        uint32_t left_id = leaf_id;
+        if (n > 0) {
+            PinnedPath pinned;
+            find_leaf_pinned(new_siblings[n].split_key, pinned, nullptr);
+            path = WritePath();
+            path.ancestors = std::move(pinned.ancestors);
+            left_id = new_siblings[n - 1].new_page_id;
+        }
+
+        update_parent(path, left_id, new_siblings[n]);
+    }
+}
+
+
+template <typename Layout>
+bool BasicTable<Layout>::erase(const KeyType& key) {
+    LatencyTimer timer(METRIC_ERASE_LATENCY);
+
+    // A row that has not been flushed yet is simply taken back
+    if (memtable) {
+        std::unique_lock<std::shared_mutex> guard(memtable_latch);
+        if (memtable->erase(key)) {
+            row_count.fetch_sub(1);
+            return true;
+        }
+    }
+
+    bool erased = false;
+    bool needs_rebalance = false;
+    {
+        std::shared_lock<std::shared_mutex> tree_guard(tree_latch);
+        std::shared_lock<std::shared_mutex> write_guard = begin_write();
+
+        // 1. Optimistic: most deletes leave the leaf full enough and only
+        // touch the leaf (and the free list, for an overflow value)
+        PageHandle page_handle = find_leaf(key, LATCH_EXCLUSIVE);
+        LeafNode leaf(page_handle.get(), page_handle.get_page_id());
+
+        uint32_t cell = leaf.find_cell(key);
+        if (cell >= leaf.get_key_count() || !Traits::equal(leaf.get_key(cell), key)) {
+            return false;
+        }
+
+        uint32_t cell_bytes = leaf.get_cell_bytes(cell);
+        if (leaf.is_root() || leaf.get_used_bytes() - cell_bytes >= LEAF_NODE_MIN_BYTES) {
+            leaf.erase_cell(cell, *pager);
+            page_handle.mark_dirty();
+            pager->commit_write();
+            erased = true;
+        } else {
+            needs_rebalance = true;
+        }
+    }
+
+    // 2. The leaf would underflow: start over with the tree to ourselves,
+    // the key may be gone by now
+    if (needs_rebalance) {
+        std::unique_lock<std::shared_mutex> tree_guard(tree_latch);
+        std::shared_lock<std::shared_mutex> write_guard = begin_write();
+
+        PinnedPath path;
+        PageHandle leaf_handle = find_leaf_pinned(key, path, nullptr);
+        LeafNode leaf(leaf_handle.get(), leaf_handle.get_page_id());
+
+        uint32_t cell = leaf.find_cell(key);
+        if (cell < leaf.get_key_count() && Traits::equal(leaf.get_key(cell), key)) {
+            leaf.erase_cell(cell, *pager);
+            leaf_handle.mark_dirty();
+            rebalance(path, std::move(leaf_handle), 0);
+            erased = true;
+        }
+        path = PinnedPath();
+        pager->commit_write();
+    }
+
+    if (erased) {
+        row_count.fetch_sub(1);
+        maybe_checkpoint();
+    }
+    return erased;
+}
+
+
+template <typename Layout>
+uint64_t BasicTable<Layout>::erase_range(const KeyType& lo, const KeyType& hi) {
+    if (Traits::less(hi, lo)) return 0;
+
+    // Only the tree needs looking at then
+    flush_memtable();
+
+    std::unique_lock<std::shared_mutex> tree_guard(tree_latch);
+    std::shared_lock<std::shared_mutex> write_guard = begin_write();
+
+    uint64_t erased = 0;
+    uint64_t uncommitted = 0;
+    KeyType from = lo;
+    while (true) {
+        // Same as insert_batch: log in several groups before the pool fills up
+        if (pager->get_write_set_size() > pager->get_pool_frames() / 2) {
+            pager->commit_write();
+            row_count.fetch_sub(uncommitted);
+            uncommitted = 0;
+        }
+
+        // 1. Empty the part of this leaf that falls in the range, back to
+        // front so every removal is at the end of the slot array
+        PinnedPath path;
+        std::optional<KeyType> fence;
+        PageHandle leaf_handle = find_leaf_pinned(from, path, &fence);
+        LeafNode leaf(leaf_handle.get(), leaf_handle.get_page_id());
+
+        uint32_t num_cells = leaf.get_key_count();
+        uint32_t first = leaf.find_cell(from);
+        uint32_t last = first;
+        while (last < num_cells && !Traits::less(hi, leaf.get_key(last))) {
+            last++;
+        }
+        for (uint32_t cell = last; cell-- > first; ) {
+            leaf.erase_cell(cell, *pager);
+        }
+        uncommitted += last - first;
+        erased += last - first;
+
+        // 2. The rest of the range starts at the leaf's fence, if it got that far
+        bool more = last == num_cells && fence.has_value() && !Traits::less(hi, *fence);
+
+        if (last > first) {
+            leaf_handle.mark_dirty();
+            rebalance(path, std::move(leaf_handle), 0);
+        }
+        if (!more) break;
+        from = *fence;
+    }
+
+    pager->commit_write();
+    row_count.fetch_sub(uncommitted);
+
+    write_guard.unlock();
+    maybe_checkpoint();
+    return erased;
+}
+
+
+template <typename Layout>
+PageHandle BasicTable<Layout>::find_leaf_pinned(const KeyType& key, PinnedPath& path,
+                                                std::optional<KeyType>* upper_fence) {
+    if (upper_fence != nullptr) {
+        upper_fence->reset();
+    }
+
+    // (Latching would not buy anything here, and a rebalance latches
+    // siblings right to left as often as left to right.)
+    uint32_t page_id = root_page_id;
+    for (uint32_t level = tree_height; level > 0; level--) {
+        PageHandle page_handle = pager->read_page(page_id);
+        InternalNode internal(page_handle.get(), page_id);
+
+        uint32_t idx = internal.child_index_for_key(key);
+        if (upper_fence != nullptr && idx < internal.get_key_count()) {
+            // Dividers further down are always below the ones above
+            *upper_fence = internal.get_key(idx);
+        }
+        page_id = internal.child_at(idx);
+
+        path.ancestors.push_back(std::move(page_handle));
+        path.child_indexes.push_back(idx);
+    }
+    return pager->read_page(page_id);
+}
+
+
+template <typename Layout>
+void BasicTable<Layout>::rebalance(PinnedPath& path, PageHandle node_handle, uint32_t level) {
+    while (!path.ancestors.empty()) {
+        if (!is_underfull(node_handle.get(), level)) return;
+
+        // Leaves may be freed or their key ranges moved, the append hint
+        // cannot be trusted any more
+        append_leaf_id = INVALID_PAGE_ID;
+
+        PageHandle& parent_handle = path.ancestors.back();
+        InternalNode parent(parent_handle.get(), parent_handle.get_page_id());
+        uint32_t idx = path.child_indexes.back();
+
+        // 1. Pair up with the left sibling, or the right one for the first
+        // child. divider is the key between the two.
+        uint32_t divider = (idx > 0) ? idx - 1 : 0;
+        uint32_t sibling_id = parent.child_at(idx > 0 ? idx - 1 : idx + 1);
+        PageHandle sibling_handle = pager->read_page(sibling_id);
+        PageHandle& left_handle = (idx > 0) ? sibling_handle : node_handle;
+        PageHandle& right_handle = (idx > 0) ? node_handle : sibling_handle;
+        uint32_t left_id = left_handle.get_page_id();
+        uint32_t right_id = right_handle.get_page_id();
+
+        // 2. Merge when both fit in one node, otherwise even them out
+        bool merged;
+        if (level == 0) {
+            LeafNode left(left_handle.get(), left_id);
+            LeafNode right(right_handle.get(), right_id);
+            merged = left.can_absorb(right);
+            if (merged) {
+                left.absorb(right);
+            } else {
+                parent.set_key(divider, left.redistribute(right));
+            }
+        } else {
+            InternalNode left(left_handle.get(), left_id);
+            InternalNode right(right_handle.get(), right_id);
+            KeyType divider_key = parent.get_key(divider);
+            merged = left.get_key_count() + 1 + right.get_key_count() <= Layout::INTERNAL_NODE_MAX_CELLS;
+            if (merged) {
+                left.absorb(right, divider_key);
+            } else {
+                parent.set_key(divider, left.redistribute(right, divider_key));
+            }
+        }
+        left_handle.mark_dirty();
+        right_handle.mark_dirty();
+        parent_handle.mark_dirty();
+
+        if (!merged) {
+            metrics_count(METRIC_NODE_REDISTRIBUTIONS);
+            return;
+        }
+
+        // 3. The right node is empty now: unhook it and free it, then see
+        // whether the parent lost too much
+        metrics_count(METRIC_NODE_MERGES);
+        parent.remove_entry(divider);
+        hash_index.clear();
+        pager->free_page(right_id);
+
+        node_handle = std::move(parent_handle);
+        sibling_handle.release();
+        path.ancestors.pop_back();
+        path.child_indexes.pop_back();
+        level++;
+    }
+
+    // Ran off the top: node_handle is the root
+    if (level > 0 && InternalNode(node_handle.get(), node_handle.get_page_id()).get_key_count() == 0) {
+        collapse_root(std::move(node_handle));
+    }
+}
+
+
+template <typename Layout>
+void BasicTable<Layout>::collapse_root(PageHandle root_handle) {
+    uint32_t old_root_id = root_handle.get_page_id();
+    uint32_t child_id = InternalNode(root_handle.get(), old_root_id).get_right_child();
+
+    // The child page type does not matter for the flag, both share the header
+    auto child_handle = pager->read_page(child_id);
+    InternalNode(child_handle.get(), child_id).set_is_root(true);
+    child_handle.mark_dirty();
+
+    // Same WAL group as the merge that emptied the old root
+    Superblock superblock(pager->latch_until_commit(superblock_page_id));
+    superblock.set_root_page_id(child_id);
+    superblock.set_tree_height(tree_height - 1);
+    pager->mark_dirty(superblock_page_id);
+
+    pager->free_page(old_root_id);
+
+    this->root_page_id = child_id;
+    this->tree_height--;
+}
+
 
-}
\ No newline at end of file
+template class BasicTable<DefaultLayout>;
+template class BasicTable<Layout64>;
+template class BasicTable<CompositeLayout>;
+template class BasicTable<UuidLayout>;
+template class BasicTable<NameLayout>;
+template class BasicTable<PackedLayout>;
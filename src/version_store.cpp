@@ -0,0 +1,102 @@
+#include "../pages/version_store.hpp"
+#include "../pages/metrics.hpp"
+#include <algorithm>
+#include <cstring>
+
+
+void VersionStore::open(uint64_t lsn, uint32_t page_count) {
+    std::lock_guard<std::mutex> guard(mutex);
+    snapshots.insert(lsn);
+    page_limit = std::max(page_limit, page_count);
+    active.store(true, std::memory_order_release);
+}
+
+
+void VersionStore::close(uint64_t lsn) {
+    std::lock_guard<std::mutex> guard(mutex);
+    auto it = snapshots.find(lsn);
+    if (it != snapshots.end()) {
+        snapshots.erase(it);
+    }
+
+    if (snapshots.empty()) {
+        active.store(false, std::memory_order_release);
+        chains.clear();
+        page_limit = 0;
+        return;
+    }
+
+    for (auto chain = chains.begin(); chain != chains.end();) {
+        prune(chain->second);
+        chain = chain->second.empty() ? chains.erase(chain) : std::next(chain);
+    }
+}
+
+
+// A version covers the snapshots from the end of the one before it up to
+// its own end. Ends only grow along a chain, so dropping one never changes
+// which version a snapshot still in the tree finds first.
+void VersionStore::prune(std::vector<Version>& chain) {
+    uint64_t start = 0;
+    auto keep = chain.begin();
+    for (auto it = chain.begin(); it != chain.end(); ++it) {
+        auto first = snapshots.lower_bound(start);
+        bool needed = first != snapshots.end() && *first < it->end;
+        start = it->end;
+        if (needed) {
+            if (keep != it) {
+                *keep = std::move(*it);
+            }
+            ++keep;
+        }
+    }
+    chain.erase(keep, chain.end());
+}
+
+
+void VersionStore::preserve(uint32_t page_id, const Page& page) {
+    std::lock_guard<std::mutex> guard(mutex);
+    if (snapshots.empty() || page_id >= page_limit) return;
+
+    // 1. Already kept since its last commit (the page has not changed), or
+    //    its last commit came after every snapshot, which all read an
+    //    older copy
+    std::vector<Version>& chain = chains[page_id];
+    if (!chain.empty()) {
+        uint64_t last_end = chain.back().end;
+        if (last_end == UNCOMMITTED || snapshots.lower_bound(last_end) == snapshots.end()) return;
+    }
+
+    // 2. Make room first, a long snapshot next to a hot page would
+    //    otherwise collect a copy per commit
+    prune(chain);
+    Version version;
+    version.image = std::make_unique<Page>(page);
+    chain.push_back(std::move(version));
+    metrics_count(METRIC_PAGE_VERSIONS_KEPT);
+}
+
+
+void VersionStore::seal(uint32_t page_id, uint64_t lsn) {
+    std::lock_guard<std::mutex> guard(mutex);
+    auto it = chains.find(page_id);
+    if (it != chains.end() && it->second.back().end == UNCOMMITTED) {
+        it->second.back().end = lsn;
+    }
+}
+
+
+bool VersionStore::find(uint32_t page_id, uint64_t lsn, Page& out) {
+    std::lock_guard<std::mutex> guard(mutex);
+    auto it = chains.find(page_id);
+    if (it == chains.end()) return false;
+
+    for (const Version& version : it->second) {
+        if (version.end > lsn) {
+            std::memcpy(out.data, version.image->data, PAGE_SIZE);
+            metrics_count(METRIC_SNAPSHOT_VERSION_READS);
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,285 @@
+#include "../pages/wal.hpp"
+#include "../pages/io_backend.hpp"
+#include <iostream>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+
+
+// FNV-1a over the record, enough to spot a torn tail after a crash
+static uint32_t wal_checksum(const WalRecordHeader& header, const char* payload, uint32_t length) {
+    uint32_t hash = 2166136261u;
+    auto mix = [&hash](const char* bytes, size_t n) {
+        for (size_t i = 0; i < n; i++) {
+            hash ^= (uint8_t) bytes[i];
+            hash *= 16777619u;
+        }
+    };
+
+    WalRecordHeader copy = header;
+    copy.checksum = 0;
+    mix((const char*) &copy, sizeof(copy));
+    mix(payload, length);
+    return hash;
+}
+
+
+static void write_fully(int fd, const char* data, size_t length, uint64_t offset) {
+    while (length > 0) {
+        ssize_t written = ::pwrite(fd, data, length, offset);
+        if (written < 0) {
+            throw std::runtime_error("WAL: write failed");
+        }
+        data += written;
+        length -= written;
+        offset += written;
+    }
+}
+
+
+Wal::Wal(const std::string& filename, const WalOptions& opts): options(opts) {
+    fd = ::open(filename.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("WAL: cannot open " + filename);
+    }
+
+    char header[WAL_FILE_HEADER_SIZE];
+    uint32_t magic = 0;
+    uint64_t start_lsn = 1;
+
+    if (::pread(fd, header, WAL_FILE_HEADER_SIZE, 0) == WAL_FILE_HEADER_SIZE) {
+        std::memcpy(&magic, header, sizeof(uint32_t));
+    }
+
+    if (magic == WAL_MAGIC) {
+        std::memcpy(&start_lsn, header + 8, sizeof(uint64_t));
+        file_end = ::lseek(fd, 0, SEEK_END);
+    } else {
+        // Brand new (or unusable) log
+        write_header(start_lsn);
+        ::ftruncate(fd, WAL_FILE_HEADER_SIZE);
+        sync_file(fd);
+        file_end = WAL_FILE_HEADER_SIZE;
+    }
+
+    next_lsn = start_lsn;
+    durable_lsn = start_lsn - 1;
+}
+
+Wal::~Wal() {
+    if (fd >= 0) {
+        sync();
+        ::close(fd);
+    }
+}
+
+
+void Wal::write_header(uint64_t start_lsn) {
+    char header[WAL_FILE_HEADER_SIZE] = {0};
+    std::memcpy(header, &WAL_MAGIC, sizeof(uint32_t));
+    std::memcpy(header + 8, &start_lsn, sizeof(uint64_t));
+    write_fully(fd, header, WAL_FILE_HEADER_SIZE, 0);
+}
+
+
+uint64_t Wal::append_record(uint32_t type, uint32_t page_id, const char* payload, uint32_t length) {
+    WalRecordHeader header;
+    header.lsn = next_lsn++;
+    header.type = type;
+    header.page_id = page_id;
+    header.length = length;
+    header.checksum = wal_checksum(header, payload, length);
+
+    size_t old_size = buffer.size();
+    buffer.resize(old_size + sizeof(header) + length);
+    std::memcpy(buffer.data() + old_size, &header, sizeof(header));
+    if (length > 0) {
+        std::memcpy(buffer.data() + old_size + sizeof(header), payload, length);
+    }
+
+    buffered_lsn = header.lsn;
+    return header.lsn;
+}
+
+
+uint64_t Wal::log_group(const std::vector<std::pair<uint32_t, Page*>>& pages) {
+    uint64_t lsn;
+    bool needs_sync;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        // Each image has to carry its own LSN, so stamp before copying
+        for (const auto& entry : pages) {
+            set_page_lsn(*entry.second, next_lsn);
+            append_record(WAL_PAGE_IMAGE, entry.first, entry.second->data, PAGE_SIZE);
+        }
+
+        lsn = append_record(WAL_COMMIT, 0, nullptr, 0);
+        pending_commits++;
+        needs_sync = !options.async_commit || pending_commits >= options.group_commit_size;
+    }
+
+    if (needs_sync) {
+        flush_to(lsn);
+    }
+    return lsn;
+}
+
+
+uint64_t Wal::log_record(const char* payload, uint32_t length) {
+    uint64_t lsn;
+    bool needs_sync;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        lsn = append_record(WAL_LOGICAL, 0, payload, length);
+        pending_commits++;
+        needs_sync = !options.async_commit || pending_commits >= options.group_commit_size;
+    }
+
+    if (needs_sync) {
+        flush_to(lsn);
+    }
+    return lsn;
+}
+
+
+void Wal::flush_to(uint64_t lsn) {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (durable_lsn < lsn) {
+        if (flushing) {
+            // Somebody else is already writing, ride along with their fsync
+            flushed.wait(lock);
+            continue;
+        }
+        if (buffer.empty()) {
+            // Nothing buffered means every LSN handed out is already on disk
+            durable_lsn = next_lsn - 1;
+            break;
+        }
+
+        flushing = true;
+        std::vector<char> batch;
+        batch.swap(buffer);
+        uint64_t batch_lsn = buffered_lsn;
+        uint64_t offset = file_end;
+        pending_commits = 0;
+        lock.unlock();
+
+        write_fully(fd, batch.data(), batch.size(), offset);
+        sync_file(fd, true);
+
+        lock.lock();
+        file_end = offset + batch.size();
+        durable_lsn = batch_lsn;
+        flushing = false;
+        flushed.notify_all();
+    }
+}
+
+
+void Wal::sync() {
+    uint64_t lsn;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        lsn = buffered_lsn;
+    }
+    flush_to(lsn);
+}
+
+
+uint64_t Wal::size() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return file_end + buffer.size();
+}
+
+
+uint64_t Wal::get_last_lsn() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return next_lsn - 1;
+}
+
+
+uint32_t Wal::recover(const std::function<void(uint32_t, const Page&)>& apply,
+                      const std::function<void(uint64_t, const char*, uint32_t)>& apply_record) {
+    uint64_t offset = WAL_FILE_HEADER_SIZE;
+    uint64_t committed_end = offset;
+    uint32_t pages_applied = 0;
+
+    // Images of the group we are inside of, applied once its commit shows up
+    std::vector<std::pair<uint32_t, Page>> group;
+    Page image;
+    std::vector<char> record;
+
+    while (true) {
+        WalRecordHeader header;
+        if (::pread(fd, &header, sizeof(header), offset) != (ssize_t) sizeof(header)) break;
+
+        char* payload = image.data;
+        if (header.type == WAL_LOGICAL) {
+            if (header.length > WAL_MAX_LOGICAL_RECORD) break;
+            record.resize(header.length);
+            payload = record.data();
+        } else if (header.type != WAL_PAGE_IMAGE && header.type != WAL_COMMIT) {
+            break;
+        } else if (header.length != 0 && header.length != PAGE_SIZE) {
+            break;
+        }
+
+        if (header.length > 0
+            && ::pread(fd, payload, header.length, offset + sizeof(header)) != (ssize_t) header.length) {
+            break;
+        }
+        if (wal_checksum(header, payload, header.length) != header.checksum) {
+            // Torn tail from a crash mid-write: everything after it is garbage
+            break;
+        }
+
+        if (header.type == WAL_PAGE_IMAGE) {
+            group.emplace_back(header.page_id, image);
+        } else if (header.type == WAL_LOGICAL) {
+            if (apply_record) {
+                apply_record(header.lsn, payload, header.length);
+            }
+            committed_end = offset + sizeof(header) + header.length;
+        } else {
+            for (auto& entry : group) {
+                apply(entry.first, entry.second);
+                pages_applied++;
+            }
+            group.clear();
+            committed_end = offset + sizeof(header);
+        }
+
+        next_lsn = header.lsn + 1;
+        offset += sizeof(header) + header.length;
+    }
+
+    if (!group.empty()) {
+        std::cerr << "WAL: discarded " << group.size() << " page(s) of an unfinished write" << std::endl;
+    }
+
+    // Cut off the unsealed tail so new groups never get glued onto it
+    if (committed_end < file_end) {
+        ::ftruncate(fd, committed_end);
+    }
+    durable_lsn = next_lsn - 1;
+    file_end = committed_end;
+    return pages_applied;
+}
+
+
+void Wal::reset() {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // Only called once the data file holds every logged page
+    write_header(next_lsn);
+    ::ftruncate(fd, WAL_FILE_HEADER_SIZE);
+    sync_file(fd);
+
+    buffer.clear();
+    pending_commits = 0;
+    file_end = WAL_FILE_HEADER_SIZE;
+    durable_lsn = next_lsn - 1;
+}
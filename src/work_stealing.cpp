@@ -0,0 +1,112 @@
+#include "pages/work_stealing.hpp"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+// The tasks a worker has left: [begin, end). The owner takes from the
+// front, thieves from the back. One cache line each, the owners poll them.
+struct alignas(64) WorkShare {
+    std::mutex mutex;
+    size_t begin = 0;
+    size_t end = 0;
+};
+
+
+WorkStealingPool::WorkStealingPool(uint32_t thread_count): threads(thread_count) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+}
+
+
+void WorkStealingPool::run(size_t task_count, const std::function<void(uint32_t, size_t)>& task) {
+    if (task_count == 0) return;
+
+    // 1. Contiguous shares, as even as they come
+    uint32_t workers = (uint32_t) std::min<size_t>(threads, task_count);
+    std::unique_ptr<WorkShare[]> shares(new WorkShare[workers]);
+    for (uint32_t w = 0; w < workers; w++) {
+        shares[w].begin = task_count * w / workers;
+        shares[w].end = task_count * (w + 1) / workers;
+    }
+
+    std::atomic<bool> failed{false};
+    std::exception_ptr first_error;
+    std::mutex error_mutex;
+
+    // Moves the back half of the largest share into ours, false once
+    // nothing is left anywhere
+    auto steal = [&](uint32_t worker) {
+        while (true) {
+            uint32_t victim = workers;
+            size_t most = 0;
+            for (uint32_t w = 0; w < workers; w++) {
+                std::lock_guard<std::mutex> guard(shares[w].mutex);
+                size_t left = shares[w].end - shares[w].begin;
+                if (left > most) {
+                    most = left;
+                    victim = w;
+                }
+            }
+            if (victim == workers) return false;
+
+            size_t begin, end;
+            {
+                std::lock_guard<std::mutex> guard(shares[victim].mutex);
+                size_t left = shares[victim].end - shares[victim].begin;
+                if (left == 0) continue;    // emptied meanwhile, look again
+                end = shares[victim].end;
+                begin = end - (left + 1) / 2;
+                shares[victim].end = begin;
+            }
+            std::lock_guard<std::mutex> guard(shares[worker].mutex);
+            shares[worker].begin = begin;
+            shares[worker].end = end;
+            return true;
+        }
+    };
+
+    // 2. Own share first, then whatever can be stolen
+    auto work = [&](uint32_t worker) {
+        WorkShare& own = shares[worker];
+        while (!failed.load(std::memory_order_relaxed)) {
+            size_t index;
+            {
+                std::lock_guard<std::mutex> guard(own.mutex);
+                index = own.begin < own.end ? own.begin++ : task_count;
+            }
+            if (index == task_count) {
+                if (!steal(worker)) return;
+                continue;
+            }
+
+            try {
+                task(worker, index);
+            } catch (...) {
+                std::lock_guard<std::mutex> guard(error_mutex);
+                if (!first_error) {
+                    first_error = std::current_exception();
+                }
+                failed = true;
+            }
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (uint32_t w = 1; w < workers; w++) {
+        pool.emplace_back(work, w);
+    }
+    work(0);
+    for (std::thread& thread : pool) {
+        thread.join();
+    }
+
+    if (first_error) {
+        std::rethrow_exception(first_error);
+    }
+}
@@ -0,0 +1,113 @@
+// Concurrent appends followed by a crash: every insert that returned must
+// come back from the WAL when the table is opened again. Runs the writers
+// in a child process that exits without closing the table, so the pages
+// only reach the file through recovery.
+
+#include "pages/table.hpp"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static const uint32_t THREADS = 8;
+static const uint32_t ROWS = 20000;
+static const uint32_t ROUNDS = 5;
+
+static std::string value_for(uint32_t key) {
+    return "row-" + std::to_string(key) + std::string(200 + key % 700, 'x');
+}
+
+static void remove_table(const std::string& path) {
+    std::remove((path + ".db").c_str());
+    std::remove((path + ".db.wal").c_str());
+}
+
+// Child: ascending keys from several threads at once, so most inserts take
+// the append path and the last leaf keeps splitting under them
+static void append_and_crash(const std::string& path) {
+    Table table(path);
+    std::atomic<uint32_t> next_key{0};
+    std::vector<std::thread> writers;
+    for (uint32_t t = 0; t < THREADS; t++) {
+        writers.emplace_back([&]() {
+            for (uint32_t key = next_key++; key < ROWS; key = next_key++) {
+                std::string value = value_for(key);
+                table.insert(key, value.data(), value.size());
+            }
+        });
+    }
+    for (std::thread& writer : writers) {
+        writer.join();
+    }
+    std::_Exit(0);
+}
+
+// Parent: what recovery brought back
+static int check_recovered(const std::string& path) {
+    Table table(path);
+    int errors = 0;
+    uint32_t expected = 0;
+    std::string value;
+    for (Cursor cursor = table.scan(0, UINT32_MAX); cursor.is_valid(); cursor.next()) {
+        uint32_t key = cursor.get_key();
+        if (key != expected) {
+            std::fprintf(stderr, "expected key %u, found %u\n", expected, key);
+            errors++;
+            expected = key;
+        }
+        cursor.read_value(value);
+        if (value != value_for(key)) {
+            std::fprintf(stderr, "key %u has the wrong value\n", key);
+            errors++;
+        }
+        expected++;
+    }
+    if (expected != ROWS) {
+        std::fprintf(stderr, "recovered rows end at %u, expected %u\n", expected, ROWS);
+        errors++;
+    }
+
+    VerifyReport report = table.verify(1);
+    for (const std::string& error : report.tree_errors) {
+        std::fprintf(stderr, "verify: %s\n", error.c_str());
+    }
+    return errors + (report.ok() ? 0 : 1);
+}
+
+int main() {
+    std::string path = "append_crash_test";
+    int failures = 0;
+
+    for (uint32_t round = 0; round < ROUNDS; round++) {
+        remove_table(path);
+        pid_t child = fork();
+        if (child < 0) {
+            std::perror("fork");
+            return 1;
+        }
+        if (child == 0) {
+            append_and_crash(path);
+        }
+
+        int status = 0;
+        waitpid(child, &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            std::fprintf(stderr, "round %u: writer process failed\n", round);
+            failures++;
+            continue;
+        }
+        int errors = check_recovered(path);
+        if (errors != 0) {
+            std::fprintf(stderr, "round %u: %d errors after recovery\n", round, errors);
+            failures++;
+        }
+    }
+
+    remove_table(path);
+    std::printf("%u rounds, %d failed\n", ROUNDS, failures);
+    return failures == 0 ? 0 : 1;
+}
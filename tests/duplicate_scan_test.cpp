@@ -0,0 +1,126 @@
+// Range scans over keys that repeat across many leaves: a scan from lo must
+// start at the first row equal to lo, not in the leaf a lookup of lo lands
+// on. Checks every [lo, hi] over a small key space against what was
+// inserted, through scan and the parallel aggregate, once with one
+// internal level and once with two.
+
+#include "pages/table.hpp"
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <string>
+
+static const uint32_t MAX_KEY = 10;
+static const uint32_t HOT_KEY = 5;
+
+// Field at offset 0 is the row number, the rest pads the row out so a run
+// of duplicates covers many leaves
+static std::string value_for(uint32_t row) {
+    std::string value(100, 'v');
+    std::memcpy(value.data(), &row, sizeof(row));
+    return value;
+}
+
+static void remove_table(const std::string& path) {
+    std::remove((path + ".db").c_str());
+    std::remove((path + ".db.wal").c_str());
+}
+
+static int check_scans(Table& table, const std::map<uint32_t, uint32_t>& counts) {
+    int errors = 0;
+    std::string value;
+    for (uint32_t lo = 0; lo <= MAX_KEY; lo++) {
+        for (uint32_t hi = lo; hi <= MAX_KEY; hi++) {
+            uint64_t expected = 0;
+            for (uint32_t key = lo; key <= hi; key++) {
+                auto it = counts.find(key);
+                expected += it == counts.end() ? 0 : it->second;
+            }
+
+            uint64_t rows = 0;
+            uint32_t prev = lo;
+            for (Cursor cursor = table.scan(lo, hi); cursor.is_valid(); cursor.next()) {
+                uint32_t key = cursor.get_key();
+                if (key < prev || key > hi) {
+                    std::fprintf(stderr, "scan(%u, %u): key %u out of order or range\n", lo, hi, key);
+                    errors++;
+                }
+                prev = key;
+                rows++;
+            }
+            if (rows != expected) {
+                std::fprintf(stderr, "scan(%u, %u): %lu rows, expected %lu\n", lo, hi,
+                             (unsigned long) rows, (unsigned long) expected);
+                errors++;
+            }
+        }
+    }
+    return errors;
+}
+
+// parallel_scan splits the range at dividers that may equal lo or each
+// other; aggregate must still see every row exactly once
+static int check_aggregates(Table& table, const std::map<uint32_t, std::pair<uint32_t, uint32_t>>& rows) {
+    int errors = 0;
+    for (uint32_t lo = 0; lo <= MAX_KEY; lo++) {
+        for (uint32_t hi = lo; hi <= MAX_KEY; hi++) {
+            ScanAggregate<uint32_t> expected;
+            for (uint32_t key = lo; key <= hi; key++) {
+                auto it = rows.find(key);
+                if (it == rows.end()) continue;
+                for (uint32_t row = it->second.first; row < it->second.second; row++) {
+                    expected.rows++;
+                    expected.add(row);
+                }
+            }
+
+            ScanAggregate<uint32_t> got = table.aggregate<uint32_t>(lo, hi, 0, 4);
+            if (got.rows != expected.rows || got.count != expected.count || got.sum != expected.sum
+                || (expected.count > 0 && (got.min != expected.min || got.max != expected.max))) {
+                std::fprintf(stderr, "aggregate(%u, %u): %lu rows sum %lu, expected %lu rows sum %lu\n", lo, hi,
+                             (unsigned long) got.rows, (unsigned long) got.sum,
+                             (unsigned long) expected.rows, (unsigned long) expected.sum);
+                errors++;
+            }
+        }
+    }
+    return errors;
+}
+
+static int run(const std::string& path, uint32_t hot_rows) {
+    remove_table(path);
+    Table table(path);
+
+    // A few rows of every key, and a long run of one of them, inserted in
+    // key order so the run really spans leaves
+    std::map<uint32_t, uint32_t> counts;
+    std::map<uint32_t, std::pair<uint32_t, uint32_t>> rows;     // key -> [first, last) row number
+    uint32_t row = 0;
+    for (uint32_t key = 0; key <= MAX_KEY; key++) {
+        if (key == 3) continue;      // a hole in the key space
+        uint32_t copies = key == HOT_KEY ? hot_rows : 20;
+        rows[key] = { row, row + copies };
+        for (uint32_t i = 0; i < copies; i++) {
+            std::string value = value_for(row++);
+            table.insert(key, value.data(), value.size());
+        }
+        counts[key] = copies;
+    }
+
+    int errors = check_scans(table, counts) + check_aggregates(table, rows);
+    VerifyReport report = table.verify(0);
+    if (!report.ok()) {
+        std::fprintf(stderr, "%s: verify failed\n", path.c_str());
+        errors++;
+    }
+    std::printf("%s: height %u, %d errors\n", path.c_str(), table.get_tree_height(), errors);
+    remove_table(path);
+    return errors;
+}
+
+int main() {
+    int errors = 0;
+    errors += run("duplicate_scan_test", 3000);
+    errors += run("duplicate_scan_test_tall", 60000);
+    return errors == 0 ? 0 : 1;
+}
@@ -0,0 +1,64 @@
+// A file in the layout from before superblocks (page 0 a leaf with a
+// 20-byte header and 36-byte cells) must be refused with an error, and
+// left as it was, instead of being read as slotted pages.
+
+#include "pages/table.hpp"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+static const uint32_t OLD_HEADER_SIZE = 20;
+static const uint32_t OLD_CELL_SIZE = 36;      // key 4 + value 32
+
+static std::vector<char> read_file(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::vector<char>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+int main() {
+    std::string path = "legacy_file_test";
+    std::remove((path + ".db").c_str());
+    std::remove((path + ".db.wal").c_str());
+
+    // Root leaf at page 0: [type 1][is_root 1][pad 2][row count 4]...,
+    // cells of key and fixed-size value after the header
+    std::vector<char> page(PAGE_SIZE, 0);
+    uint32_t rows = 10;
+    page[NODE_TYPE_OFFSET] = NODE_LEAF;
+    page[IS_ROOT_OFFSET] = 1;
+    std::memcpy(page.data() + 4, &rows, sizeof(rows));
+    for (uint32_t key = 0; key < rows; key++) {
+        char* cell = page.data() + OLD_HEADER_SIZE + key * OLD_CELL_SIZE;
+        std::memcpy(cell, &key, sizeof(key));
+        std::memset(cell + 4, 'a' + key, OLD_CELL_SIZE - 4);
+    }
+    {
+        std::ofstream out(path + ".db", std::ios::binary);
+        out.write(page.data(), page.size());
+    }
+
+    int errors = 0;
+    try {
+        Table table(path);
+        std::fprintf(stderr, "a file without a superblock was opened\n");
+        errors++;
+    } catch (const std::runtime_error& e) {
+        if (std::string(e.what()).find("superblock") == std::string::npos) {
+            std::fprintf(stderr, "unclear error: %s\n", e.what());
+            errors++;
+        }
+    }
+    if (read_file(path + ".db") != page) {
+        std::fprintf(stderr, "the file was changed\n");
+        errors++;
+    }
+
+    std::remove((path + ".db").c_str());
+    std::remove((path + ".db.wal").c_str());
+    std::printf("%d errors\n", errors);
+    return errors == 0 ? 0 : 1;
+}
@@ -0,0 +1,152 @@
+// A snapshot keeps reading the table as it was when it opened: inserts and
+// erases made afterwards (overflow chains freed, leaves split and merged)
+// stay invisible to it, while the table itself and any later snapshot see
+// them. Also checks that snapshot scans return every row of a key that
+// repeats across leaves. Runs with and without buffered writes.
+
+#include "pages/table.hpp"
+#include <cstdio>
+#include <map>
+#include <set>
+#include <string>
+
+using Rows = std::multiset<std::pair<uint32_t, std::string>>;
+
+static const uint32_t MAX_DUP_KEY = 10;
+static const uint32_t HOT_KEY = 5;
+static const uint32_t FIRST_UNIQUE_KEY = 100;
+static const uint32_t UNIQUE_KEYS = 200;
+
+// Every fourth unique key gets a value that needs overflow pages
+static std::string value_for(uint32_t key, uint32_t copy) {
+    std::string value = std::to_string(key) + "-" + std::to_string(copy);
+    value.resize(key >= FIRST_UNIQUE_KEY && key % 4 == 0 ? 9000 : 100, 'p');
+    return value;
+}
+
+static void remove_table(const std::string& path) {
+    std::remove((path + ".db").c_str());
+    std::remove((path + ".db.wal").c_str());
+    std::remove((path + ".db.mem").c_str());
+}
+
+static void insert(Table& table, Rows& rows, uint32_t key, uint32_t copy) {
+    std::string value = value_for(key, copy);
+    table.insert(key, value.data(), value.size());
+    rows.emplace(key, value);
+}
+
+template <typename Source>
+static Rows read_all(Source& source) {
+    Rows rows;
+    std::string value;
+    for (auto cursor = source.scan(0, UINT32_MAX); cursor.is_valid(); cursor.next()) {
+        cursor.read_value(value);
+        rows.emplace(cursor.get_key(), value);
+    }
+    return rows;
+}
+
+// Every [lo, hi] over the duplicated keys, counted against rows
+static int check_dup_scans(Snapshot& snapshot, const Rows& rows, const char* tag) {
+    int errors = 0;
+    for (uint32_t lo = 0; lo <= MAX_DUP_KEY; lo++) {
+        for (uint32_t hi = lo; hi <= MAX_DUP_KEY; hi++) {
+            uint64_t expected = 0;
+            for (const auto& row : rows) {
+                expected += row.first >= lo && row.first <= hi;
+            }
+            uint64_t got = 0;
+            for (SnapshotCursor cursor = snapshot.scan(lo, hi); cursor.is_valid(); cursor.next()) {
+                got++;
+            }
+            if (got != expected) {
+                std::fprintf(stderr, "%s: scan(%u, %u) saw %lu rows, expected %lu\n", tag, lo, hi,
+                             (unsigned long) got, (unsigned long) expected);
+                errors++;
+            }
+        }
+    }
+    return errors;
+}
+
+static int check_rows(const Rows& got, const Rows& expected, const char* tag) {
+    if (got == expected) return 0;
+    std::fprintf(stderr, "%s: %lu rows, expected %lu\n", tag, (unsigned long) got.size(),
+                 (unsigned long) expected.size());
+    return 1;
+}
+
+static int run(const std::string& path, bool buffered_writes) {
+    remove_table(path);
+    TableOptions options;
+    options.buffered_writes = buffered_writes;
+    options.memtable_bytes = 64 * 1024;     // flushes into the tree on the way, snapshot open or not
+    Table table(path, options);
+    int errors = 0;
+
+    // 1. Duplicates spanning many leaves, then unique keys, some large
+    Rows before;
+    for (uint32_t key = 0; key <= MAX_DUP_KEY; key++) {
+        uint32_t copies = key == HOT_KEY ? 3000 : 20;
+        for (uint32_t copy = 0; copy < copies; copy++) {
+            insert(table, before, key, copy);
+        }
+    }
+    for (uint32_t key = FIRST_UNIQUE_KEY; key < FIRST_UNIQUE_KEY + UNIQUE_KEYS; key++) {
+        insert(table, before, key, 0);
+    }
+
+    Snapshot snapshot = table.snapshot();
+
+    // 2. Change the table under it: more duplicates, new keys, and half of
+    // the unique keys erased (freeing their overflow chains)
+    Rows after = before;
+    for (uint32_t copy = 3000; copy < 6000; copy++) {
+        insert(table, after, HOT_KEY, copy);
+    }
+    for (uint32_t key = 1000; key < 1500; key++) {
+        insert(table, after, key, 0);
+    }
+    for (uint32_t key = FIRST_UNIQUE_KEY; key < FIRST_UNIQUE_KEY + UNIQUE_KEYS; key += 2) {
+        if (!table.erase(key)) {
+            std::fprintf(stderr, "%s: erase(%u) found nothing\n", path.c_str(), key);
+            errors++;
+        }
+        after.erase(after.find({ key, value_for(key, 0) }));
+    }
+
+    // 3. The snapshot still has exactly the old rows
+    errors += check_rows(read_all(snapshot), before, "old snapshot");
+    errors += check_dup_scans(snapshot, before, "old snapshot");
+    for (uint32_t key = FIRST_UNIQUE_KEY; key < FIRST_UNIQUE_KEY + UNIQUE_KEYS; key++) {
+        std::string value;
+        if (!snapshot.find(key, value) || value != value_for(key, 0)) {
+            std::fprintf(stderr, "old snapshot: find(%u) lost the row\n", key);
+            errors++;
+        }
+    }
+    std::string value;
+    if (snapshot.find(1000, value)) {
+        std::fprintf(stderr, "old snapshot: find(1000) sees a later insert\n");
+        errors++;
+    }
+
+    // 4. The table and a new snapshot see the changes
+    errors += check_rows(read_all(table), after, "table");
+    Snapshot later = table.snapshot();
+    errors += check_rows(read_all(later), after, "new snapshot");
+    errors += check_dup_scans(later, after, "new snapshot");
+
+    std::printf("%s: height %u, %d errors\n", path.c_str(), table.get_tree_height(), errors);
+    return errors;
+}
+
+int main() {
+    int errors = 0;
+    errors += run("snapshot_test", false);
+    errors += run("snapshot_test_buffered", true);
+    remove_table("snapshot_test");
+    remove_table("snapshot_test_buffered");
+    return errors == 0 ? 0 : 1;
+}
@@ -0,0 +1,171 @@
+// Redo recovery after a crash before any checkpoint: a writer process
+// inserts and erases rows, then exits without closing the table, so the
+// data file is still empty and everything comes back from the WAL.
+//   - Every insert that returned is there, with no explicit sync.
+//   - A torn last group (the log cut off mid-record, garbage after it) is
+//     dropped, and a writer that recovers from it logs new groups after
+//     the cut, not after the garbage.
+//   - With async_commit only the last group_commit_size commits may go,
+//     and what is left is a prefix of them.
+
+#include "pages/table.hpp"
+#include <cstdio>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+static const uint32_t ROWS = 2000;
+static const uint32_t MORE_ROWS = 500;
+
+// Every 50th value needs overflow pages
+static std::string value_for(uint32_t key) {
+    return std::to_string(key) + std::string(key % 50 == 0 ? 6000 : 40 + key % 200, 'w');
+}
+
+// With durable commits, every tenth key is erased again a few inserts later
+static bool erased(uint32_t key) {
+    return key % 10 == 3;
+}
+
+static void remove_table(const std::string& path) {
+    std::remove((path + ".db").c_str());
+    std::remove((path + ".db.wal").c_str());
+}
+
+static TableOptions options_for(bool async_commit) {
+    TableOptions options;
+    options.async_commit = async_commit;
+    return options;
+}
+
+// Child: keys [from, to) in order, ending on an insert, then a crash
+static void write_and_crash(const std::string& path, bool async_commit, uint32_t from, uint32_t to) {
+    Table table(path, options_for(async_commit));
+    for (uint32_t key = from; key < to; key++) {
+        std::string value = value_for(key);
+        table.insert(key, value.data(), value.size());
+        if (!async_commit && key >= from + 5 && erased(key - 5)) {
+            table.erase(key - 5);
+        }
+    }
+    std::_Exit(0);
+}
+
+static bool run_child(const std::function<void()>& body) {
+    std::fflush(stdout);
+    pid_t child = fork();
+    if (child < 0) {
+        std::perror("fork");
+        return false;
+    }
+    if (child == 0) {
+        try {
+            body();
+        } catch (const std::exception& e) {
+            std::fprintf(stderr, "writer: %s\n", e.what());
+        }
+        std::_Exit(1);
+    }
+    int status = 0;
+    waitpid(child, &status, 0);
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+// Cuts the log inside its last group (an insert that did not split logs
+// one image and a commit) and appends garbage where the rest would be
+static void tear_log(const std::string& path) {
+    std::string wal = path + ".db.wal";
+    struct stat st;
+    stat(wal.c_str(), &st);
+    truncate(wal.c_str(), st.st_size - 100);
+
+    int fd = open(wal.c_str(), O_WRONLY | O_APPEND);
+    std::string garbage(300, '\x5a');
+    ssize_t written = write(fd, garbage.data(), garbage.size());
+    (void) written;
+    close(fd);
+}
+
+// The rows of [0, end) that should be there, with key `missing` lost
+static int check_rows(const std::string& path, bool async_commit, uint32_t end, uint32_t missing,
+                      uint32_t* found_end = nullptr) {
+    Table table(path, options_for(async_commit));
+    int errors = 0;
+    uint32_t expected = 0;
+    auto skip_gone = [&]() {
+        while (expected < end
+               && (expected == missing || (!async_commit && erased(expected) && expected + 5 < end))) {
+            expected++;
+        }
+    };
+    std::string value;
+    for (Cursor cursor = table.scan(0, UINT32_MAX); cursor.is_valid(); cursor.next()) {
+        skip_gone();
+        uint32_t key = cursor.get_key();
+        if (key != expected) {
+            std::fprintf(stderr, "%s: expected key %u, found %u\n", path.c_str(), expected, key);
+            return errors + 1;
+        }
+        cursor.read_value(value);
+        if (value != value_for(key)) {
+            std::fprintf(stderr, "%s: key %u has the wrong value\n", path.c_str(), key);
+            errors++;
+        }
+        expected++;
+    }
+
+    if (found_end != nullptr) {
+        *found_end = expected;
+    } else if (skip_gone(), expected != end) {
+        std::fprintf(stderr, "%s: recovered rows end at %u, expected %u\n", path.c_str(), expected, end);
+        errors++;
+    }
+    if (!table.verify(1).ok()) {
+        std::fprintf(stderr, "%s: verify failed\n", path.c_str());
+        errors++;
+    }
+    return errors;
+}
+
+// Durable commits: everything survives, then a torn tail costs only the
+// insert it belonged to
+static int test_durable(const std::string& path) {
+    remove_table(path);
+    if (!run_child([&]() { write_and_crash(path, false, 0, ROWS); })) return 1;
+    tear_log(path);
+
+    // Recovers from the torn log and crashes again on top of it
+    if (!run_child([&]() { write_and_crash(path, false, ROWS, ROWS + MORE_ROWS); })) return 1;
+    int errors = check_rows(path, false, ROWS + MORE_ROWS, ROWS - 1);
+    std::printf("durable commits: %d errors\n", errors);
+    return errors;
+}
+
+// Async commits: a crash loses at most the commits since the last fsync
+static int test_async(const std::string& path) {
+    remove_table(path);
+    if (!run_child([&]() { write_and_crash(path, true, 0, ROWS); })) return 1;
+
+    uint32_t found_end = 0;
+    int errors = check_rows(path, true, ROWS, UINT32_MAX, &found_end);
+    uint32_t lost = ROWS - found_end;
+    if (lost > WalOptions().group_commit_size) {
+        std::fprintf(stderr, "%s: lost %u inserts\n", path.c_str(), lost);
+        errors++;
+    }
+    std::printf("async commits: %u inserts lost, %d errors\n", lost, errors);
+    return errors;
+}
+
+int main() {
+    int errors = 0;
+    errors += test_durable("wal_recovery_test");
+    errors += test_async("wal_recovery_test_async");
+    remove_table("wal_recovery_test");
+    remove_table("wal_recovery_test_async");
+    return errors == 0 ? 0 : 1;
+}